@@ -1,128 +1,178 @@
-#ifndef __SMART_SMARTDEFS_H__
-#define __SMART_SMARTDEFS_H__
-
-#ifndef RTAPI
-#  define RTAPI
-#endif
-
-#define RTAPIENTRY 
-
-// -------------------------------------------------------------------------- //
-// Typedefs
-// -------------------------------------------------------------------------- //
-typedef unsigned int    RTenum;
-typedef unsigned char   RTboolean;
-typedef unsigned int    RTbitfield;
-typedef void            RTvoid;
-typedef signed char     RTbyte;
-typedef short           RTshort;
-typedef int             RTint;
-typedef unsigned char   RTubyte;
-typedef unsigned short  RTushort;
-typedef unsigned int    RTuint;
-typedef int             RTsizei;
-typedef float           RTfloat;
-typedef float           RTclampf; /**< single precision float in [0,1] */
-typedef double          RTdouble;
-typedef double          RTclampd; /**< double precision float in [0,1] */
-typedef unsigned long   RTulong;
-typedef long            RTlong;
-
-typedef RTboolean       RTbool;
-typedef RTubyte         RTuchar;
-
-
-// -------------------------------------------------------------------------- //
-// Enums
-// -------------------------------------------------------------------------- //
-#define RT_TYPE_COMBINE(TYPE, VALUE) ((TYPE) | (VALUE))
-#define RT_TYPE_OF(VALUE)            ((VALUE) & 0xFFFFFF00)
-
-enum {
-  RT_TYPE_GEOMETRY_MODE      = 0x00000100,
-  RT_TYPE_NEWOBJECT_MODE     = 0x00000200,
-  RT_TYPE_FB_FORMAT          = 0x00000300,
-  RT_TYPE_SHADERTYPE         = 0x00000400, 
-  RT_TYPE_DATATYPE           = 0x00001400,
-  RT_TYPE_ERROR              = 0xFFFFFE00,
-  RT_TYPE_INVALID            = 0xFFFFFF00
-};
-
-enum {
-  RT_TRIANGLES               = RT_TYPE_COMBINE(RT_TYPE_GEOMETRY_MODE, 0x00),
-  RT_TRIANGLE_STRIP          = RT_TYPE_COMBINE(RT_TYPE_GEOMETRY_MODE, 0x01),
-  RT_TRIANGLE_FAN            = RT_TYPE_COMBINE(RT_TYPE_GEOMETRY_MODE, 0x02),
-  RT_QUADS                   = RT_TYPE_COMBINE(RT_TYPE_GEOMETRY_MODE, 0x03),
-  RT_QUAD_STRIP              = RT_TYPE_COMBINE(RT_TYPE_GEOMETRY_MODE, 0x04),
-  RT_POLYGON                 = RT_TYPE_COMBINE(RT_TYPE_GEOMETRY_MODE, 0x05)
-};
-
-enum {
-  RT_DEFINE                  = RT_TYPE_COMBINE(RT_TYPE_NEWOBJECT_MODE, 0x00),
-  RT_DEFINE_AND_INSTANTIATE  = RT_TYPE_COMBINE(RT_TYPE_NEWOBJECT_MODE, 0x01),
-  RT_COMPILE = RT_DEFINE
-};
-
-enum {
-  RT_BYTE                    = RT_TYPE_COMBINE(RT_TYPE_DATATYPE, 0x00),
-  RT_UNSIGNED_BYTE           = RT_TYPE_COMBINE(RT_TYPE_DATATYPE, 0x01),
-  RT_SHORT                   = RT_TYPE_COMBINE(RT_TYPE_DATATYPE, 0x02),
-  RT_UNSIGNED_SHORT          = RT_TYPE_COMBINE(RT_TYPE_DATATYPE, 0x03),
-  RT_INT                     = RT_TYPE_COMBINE(RT_TYPE_DATATYPE, 0x04),
-  RT_UNSIGNED_INT            = RT_TYPE_COMBINE(RT_TYPE_DATATYPE, 0x05),
-  RT_FLOAT                   = RT_TYPE_COMBINE(RT_TYPE_DATATYPE, 0x06),
-  RT_DOUBLE                  = RT_TYPE_COMBINE(RT_TYPE_DATATYPE, 0x0A),
-  RT_2_BYTES                 = RT_TYPE_COMBINE(RT_TYPE_DATATYPE, 0x07),
-  RT_3_BYTES                 = RT_TYPE_COMBINE(RT_TYPE_DATATYPE, 0x08),
-  RT_4_BYTES                 = RT_TYPE_COMBINE(RT_TYPE_DATATYPE, 0x09)
-};
-
-enum {
-  RT_INVALID                 = RT_TYPE_COMBINE(RT_TYPE_INVALID, 0xFF)
-};
-
-enum {
-  RT_BGR_32                  = RT_TYPE_COMBINE(RT_TYPE_FB_FORMAT, 0x00)
-};
-
-enum {
-  /** No error has been recorded. The value of this symbolic constant is 
-   * guaranteed to be zero. */
-  RT_NO_ERROR                = 0,
-  
-  /** An unacceptable value is specified for an enumerated argument. The 
-   * offending function is ignored, having no side effect other than to set 
-   * the error flag. */
-  RT_INVALID_ENUM            = RT_TYPE_COMBINE(RT_TYPE_ERROR, 0x01),
-
-  /** A numeric argument is out of range. The offending function is ignored, 
-   * having no side effect other than to set the error flag. */
-  RT_INVALID_VALUE           = RT_TYPE_COMBINE(RT_TYPE_ERROR, 0x02),
-
-  /** The specified operation is not allowed in the current state. The 
-   * offending function is ignored, having no side effect other than to set the 
-   * error flag. */
-  RT_INVALID_OPERATION       = RT_TYPE_COMBINE(RT_TYPE_ERROR, 0x03),
-
-  /** This function would cause a stack overflow. The offending function is 
-   * ignored, having no side effect other than to set the error flag. */
-  RT_STACK_OVERFLOW          = RT_TYPE_COMBINE(RT_TYPE_ERROR, 0x04),
-
-  /** This function would cause a stack underflow. The offending function is 
-   * ignored, having no side effect other than to set the error flag. */
-  RT_STACK_UNDERFLOW         = RT_TYPE_COMBINE(RT_TYPE_ERROR, 0x05),
-
-  /** There is not enough memory left to execute the function. The state of 
-   * SMART is undefined, except for the state of the error flags, after this 
-   * error is recorded. */
-  RT_OUT_OF_MEMORY           = RT_TYPE_COMBINE(RT_TYPE_ERROR, 0x06)
-};
-
-enum {
-  RT_SURFACE_SHADER          = RT_TYPE_COMBINE(RT_TYPE_SHADERTYPE, 0x00),
-  RT_ENV_SHADER              = RT_TYPE_COMBINE(RT_TYPE_SHADERTYPE, 0x01),
-  RT_LIGHT_SHADER            = RT_TYPE_COMBINE(RT_TYPE_SHADERTYPE, 0x02),
-  RT_CAMERA_SHADER           = RT_TYPE_COMBINE(RT_TYPE_SHADERTYPE, 0x03),
-};
-
-#endif // __SMART_SMARTDEFS_H__
+#ifndef __SMART_SMARTDEFS_H__
+#define __SMART_SMARTDEFS_H__
+
+#ifndef RTAPI
+#  define RTAPI
+#endif
+
+#define RTAPIENTRY 
+
+// -------------------------------------------------------------------------- //
+// Typedefs
+// -------------------------------------------------------------------------- //
+typedef unsigned int    RTenum;
+typedef unsigned char   RTboolean;
+typedef unsigned int    RTbitfield;
+typedef void            RTvoid;
+typedef signed char     RTbyte;
+typedef short           RTshort;
+typedef int             RTint;
+typedef unsigned char   RTubyte;
+typedef unsigned short  RTushort;
+typedef unsigned int    RTuint;
+typedef int             RTsizei;
+typedef float           RTfloat;
+typedef float           RTclampf; /**< single precision float in [0,1] */
+typedef double          RTdouble;
+typedef double          RTclampd; /**< double precision float in [0,1] */
+typedef unsigned long   RTulong;
+typedef long            RTlong;
+
+typedef RTboolean       RTbool;
+typedef RTubyte         RTuchar;
+
+
+// -------------------------------------------------------------------------- //
+// Enums
+// -------------------------------------------------------------------------- //
+#define RT_TYPE_COMBINE(TYPE, VALUE) ((TYPE) | (VALUE))
+#define RT_TYPE_OF(VALUE)            ((VALUE) & 0xFFFFFF00)
+
+enum {
+  RT_TYPE_GEOMETRY_MODE      = 0x00000100,
+  RT_TYPE_NEWOBJECT_MODE     = 0x00000200,
+  RT_TYPE_FB_FORMAT          = 0x00000300,
+  RT_TYPE_SHADERTYPE         = 0x00000400, 
+  RT_TYPE_OBJECT_PARAM       = 0x00000500,
+  RT_TYPE_BSP_BUILD_METHOD   = 0x00000600,
+  RT_TYPE_DATATYPE           = 0x00001400,
+  RT_TYPE_ERROR              = 0xFFFFFE00,
+  RT_TYPE_INVALID            = 0xFFFFFF00
+};
+
+enum {
+  RT_TRIANGLES               = RT_TYPE_COMBINE(RT_TYPE_GEOMETRY_MODE, 0x00),
+  RT_TRIANGLE_STRIP          = RT_TYPE_COMBINE(RT_TYPE_GEOMETRY_MODE, 0x01),
+  RT_TRIANGLE_FAN            = RT_TYPE_COMBINE(RT_TYPE_GEOMETRY_MODE, 0x02),
+  RT_QUADS                   = RT_TYPE_COMBINE(RT_TYPE_GEOMETRY_MODE, 0x03),
+  RT_QUAD_STRIP              = RT_TYPE_COMBINE(RT_TYPE_GEOMETRY_MODE, 0x04),
+  RT_POLYGON                 = RT_TYPE_COMBINE(RT_TYPE_GEOMETRY_MODE, 0x05)
+};
+
+enum {
+  RT_DEFINE                  = RT_TYPE_COMBINE(RT_TYPE_NEWOBJECT_MODE, 0x00),
+  RT_DEFINE_AND_INSTANTIATE  = RT_TYPE_COMBINE(RT_TYPE_NEWOBJECT_MODE, 0x01),
+  RT_COMPILE = RT_DEFINE
+};
+
+enum {
+  RT_BYTE                    = RT_TYPE_COMBINE(RT_TYPE_DATATYPE, 0x00),
+  RT_UNSIGNED_BYTE           = RT_TYPE_COMBINE(RT_TYPE_DATATYPE, 0x01),
+  RT_SHORT                   = RT_TYPE_COMBINE(RT_TYPE_DATATYPE, 0x02),
+  RT_UNSIGNED_SHORT          = RT_TYPE_COMBINE(RT_TYPE_DATATYPE, 0x03),
+  RT_INT                     = RT_TYPE_COMBINE(RT_TYPE_DATATYPE, 0x04),
+  RT_UNSIGNED_INT            = RT_TYPE_COMBINE(RT_TYPE_DATATYPE, 0x05),
+  RT_FLOAT                   = RT_TYPE_COMBINE(RT_TYPE_DATATYPE, 0x06),
+  RT_DOUBLE                  = RT_TYPE_COMBINE(RT_TYPE_DATATYPE, 0x0A),
+  RT_2_BYTES                 = RT_TYPE_COMBINE(RT_TYPE_DATATYPE, 0x07),
+  RT_3_BYTES                 = RT_TYPE_COMBINE(RT_TYPE_DATATYPE, 0x08),
+  RT_4_BYTES                 = RT_TYPE_COMBINE(RT_TYPE_DATATYPE, 0x09)
+};
+
+enum {
+  RT_FALSE                   = 0,
+  RT_TRUE                    = 1
+};
+
+enum {
+  RT_INVALID                 = RT_TYPE_COMBINE(RT_TYPE_INVALID, 0xFF)
+};
+
+enum {
+  RT_BGR_32                  = RT_TYPE_COMBINE(RT_TYPE_FB_FORMAT, 0x00)
+};
+
+enum {
+  /** No error has been recorded. The value of this symbolic constant is 
+   * guaranteed to be zero. */
+  RT_NO_ERROR                = 0,
+  
+  /** An unacceptable value is specified for an enumerated argument. The 
+   * offending function is ignored, having no side effect other than to set 
+   * the error flag. */
+  RT_INVALID_ENUM            = RT_TYPE_COMBINE(RT_TYPE_ERROR, 0x01),
+
+  /** A numeric argument is out of range. The offending function is ignored, 
+   * having no side effect other than to set the error flag. */
+  RT_INVALID_VALUE           = RT_TYPE_COMBINE(RT_TYPE_ERROR, 0x02),
+
+  /** The specified operation is not allowed in the current state. The 
+   * offending function is ignored, having no side effect other than to set the 
+   * error flag. */
+  RT_INVALID_OPERATION       = RT_TYPE_COMBINE(RT_TYPE_ERROR, 0x03),
+
+  /** This function would cause a stack overflow. The offending function is 
+   * ignored, having no side effect other than to set the error flag. */
+  RT_STACK_OVERFLOW          = RT_TYPE_COMBINE(RT_TYPE_ERROR, 0x04),
+
+  /** This function would cause a stack underflow. The offending function is 
+   * ignored, having no side effect other than to set the error flag. */
+  RT_STACK_UNDERFLOW         = RT_TYPE_COMBINE(RT_TYPE_ERROR, 0x05),
+
+  /** There is not enough memory left to execute the function. The state of 
+   * SMART is undefined, except for the state of the error flags, after this 
+   * error is recorded. */
+  RT_OUT_OF_MEMORY           = RT_TYPE_COMBINE(RT_TYPE_ERROR, 0x06)
+};
+
+enum {
+  RT_SURFACE_SHADER          = RT_TYPE_COMBINE(RT_TYPE_SHADERTYPE, 0x00),
+  RT_ENV_SHADER              = RT_TYPE_COMBINE(RT_TYPE_SHADERTYPE, 0x01),
+  RT_LIGHT_SHADER            = RT_TYPE_COMBINE(RT_TYPE_SHADERTYPE, 0x02),
+  RT_CAMERA_SHADER           = RT_TYPE_COMBINE(RT_TYPE_SHADERTYPE, 0x03),
+};
+
+enum {
+  /** BSP tree construction algorithm, RT_BSP_AUTO (default), 
+   * RT_BSP_EXACT_SAH, RT_BSP_BINNED_SAH, RT_BSP_LAZY_BINNED_SAH or 
+   * RT_BSP_LEAF. */
+  RT_BSP_BUILD_METHOD          = RT_TYPE_COMBINE(RT_TYPE_OBJECT_PARAM, 0x00),
+
+  /** SAH cost of traversing an inner node, positive. */
+  RT_BSP_TRAVERSAL_COST        = RT_TYPE_COMBINE(RT_TYPE_OBJECT_PARAM, 0x01),
+
+  /** SAH cost of intersecting a triangle, positive. */
+  RT_BSP_INTERSECTION_COST     = RT_TYPE_COMBINE(RT_TYPE_OBJECT_PARAM, 0x02),
+
+  /** Fraction by which SAH cost of a split that cuts off empty space is 
+   * reduced, in [0, 1). */
+  RT_BSP_EMPTY_SPACE_BONUS     = RT_TYPE_COMBINE(RT_TYPE_OBJECT_PARAM, 0x03),
+
+  /** Maximal depth of a BSP tree leaf, in [0, SMART_MAX_BSPTREE_DEPTH]. */
+  RT_BSP_MAX_DEPTH             = RT_TYPE_COMBINE(RT_TYPE_OBJECT_PARAM, 0x04),
+
+  /** Nodes with more triangles are split even if SAH suggests a leaf. */
+  RT_BSP_MAX_LEAF_SIZE         = RT_TYPE_COMBINE(RT_TYPE_OBJECT_PARAM, 0x05),
+
+  /** Node is split only if the best split costs less than this many times
+   * the cost of a leaf, positive. */
+  RT_BSP_TERMINATION_THRESHOLD = RT_TYPE_COMBINE(RT_TYPE_OBJECT_PARAM, 0x06),
+
+  /** With RT_BSP_AUTO, models with at most this many triangles are not 
+   * split at all, non-negative. */
+  RT_BSP_AUTO_LEAF_SIZE        = RT_TYPE_COMBINE(RT_TYPE_OBJECT_PARAM, 0x07),
+
+  /** With RT_BSP_AUTO, models with at most this many triangles are built 
+   * with binned SAH, and bigger ones with exact SAH, non-negative. */
+  RT_BSP_AUTO_BINNED_SIZE      = RT_TYPE_COMBINE(RT_TYPE_OBJECT_PARAM, 0x08)
+};
+
+enum {
+  RT_BSP_EXACT_SAH             = RT_TYPE_COMBINE(RT_TYPE_BSP_BUILD_METHOD, 0x00),
+  RT_BSP_BINNED_SAH            = RT_TYPE_COMBINE(RT_TYPE_BSP_BUILD_METHOD, 0x01),
+  RT_BSP_LAZY_BINNED_SAH       = RT_TYPE_COMBINE(RT_TYPE_BSP_BUILD_METHOD, 0x02),
+  RT_BSP_AUTO                  = RT_TYPE_COMBINE(RT_TYPE_BSP_BUILD_METHOD, 0x03),
+  RT_BSP_LEAF                  = RT_TYPE_COMBINE(RT_TYPE_BSP_BUILD_METHOD, 0x04)
+};
+
+#endif // __SMART_SMARTDEFS_H__
@@ -0,0 +1,111 @@
+#ifndef __SMART_ATOMIC_H__
+#define __SMART_ATOMIC_H__
+
+#include "common.h"
+#include <arx/Utility.h>
+
+#ifdef ARX_MSVC
+#  include <intrin.h>
+#  pragma intrinsic(_InterlockedExchangeAdd)
+#  pragma intrinsic(_InterlockedCompareExchange)
+#endif
+
+namespace smart {
+// -------------------------------------------------------------------------- //
+// AtomicInt
+// -------------------------------------------------------------------------- //
+  /** Integer with atomic read-modify-write operations. All the operations
+   * are full memory barriers. */
+  class AtomicInt: private arx::noncopyable {
+  public:
+    AtomicInt(int value = 0): mValue(value) {}
+
+    /** @returns current value. */
+    int load() const {
+      return fetchAdd(0);
+    }
+
+    /** Adds the given value.
+     *
+     * @returns value before the addition. */
+    int fetchAdd(int value) const {
+#ifdef ARX_MSVC
+      return _InterlockedExchangeAdd(const_cast<volatile long*>(&mValue), value);
+#else
+      return __sync_fetch_and_add(const_cast<volatile int*>(&mValue), value);
+#endif
+    }
+
+    /** @returns value after the increment. */
+    int increment() {
+      return fetchAdd(1) + 1;
+    }
+
+    /** @returns value after the decrement. */
+    int decrement() {
+      return fetchAdd(-1) - 1;
+    }
+
+    /** Sets value to newValue if it is equal to expected.
+     *
+     * @returns true if the value was changed. */
+    bool compareExchange(int expected, int newValue) {
+#ifdef ARX_MSVC
+      return _InterlockedCompareExchange(&mValue, newValue, expected) == expected;
+#else
+      return __sync_bool_compare_and_swap(&mValue, expected, newValue);
+#endif
+    }
+
+    /** Sets value to the given one. */
+    void store(int value) {
+      while(true) {
+        int oldValue = load();
+        if(compareExchange(oldValue, value))
+          return;
+      }
+    }
+
+  private:
+#ifdef ARX_MSVC
+    volatile long mValue;
+#else
+    volatile int mValue;
+#endif
+  };
+
+
+// -------------------------------------------------------------------------- //
+// loadAcquire
+// -------------------------------------------------------------------------- //
+  /** Loads the given value with acquire semantics: memory accesses that 
+   * follow the load are not moved before it, so a thread that sees a value
+   * stored after a memoryBarrier also sees everything written before that 
+   * barrier. */
+  inline intptr_t loadAcquire(const intptr_t* ptr) {
+#ifdef ARX_MSVC
+    /* Volatile reads have acquire semantics with MSVC. */
+    return *const_cast<const volatile intptr_t*>(ptr);
+#else
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#endif
+  }
+
+
+// -------------------------------------------------------------------------- //
+// memoryBarrier
+// -------------------------------------------------------------------------- //
+  /** Full memory barrier. Neither the compiler nor the processor moves 
+   * memory accesses across it. */
+  inline void memoryBarrier() {
+#ifdef ARX_MSVC
+    long dummy = 0;
+    _InterlockedExchangeAdd(&dummy, 0);
+#else
+    __sync_synchronize();
+#endif
+  }
+
+} // namespace smart
+
+#endif // __SMART_ATOMIC_H__
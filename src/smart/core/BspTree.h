@@ -1,827 +1,2491 @@
-#ifndef __SMART_BSPTREE_H__
-#define __SMART_BSPTREE_H__
-
-#include "common.h"
-#include <cassert>
-#include <algorithm>
-#include <arx/Collections.h>
-#include <arx/Utility.h>
-#include <arx/static_assert.h>
-#include <arx/Memory.h>
-#include "BoundingBox.h"
-#include "MemoryArena.h"
-
-namespace smart {
-// -------------------------------------------------------------------------- //
-// NodeTriangleIdList
-// -------------------------------------------------------------------------- //
-  /** Wrapper class for list of triangle ids stored in a leaf node. */
-  class NodeTriangleIdList {
-  public:
-    int operator[] (int index) const {
-      assert(0 <= index && index < mSize);
-      return mIndices[index];
-    }
-
-    int size() const {
-      return mSize;
-    }
-
-  private:
-    friend class BspNode;
-
-    NodeTriangleIdList(int size, const int* indices):
-      mSize(size), mIndices(indices) {}
-
-    int mSize;
-    const int* mIndices;
-  };
-
-
-// -------------------------------------------------------------------------- //
-// BspNode
-// -------------------------------------------------------------------------- //
-  /** Single node of a BSP tree. 
-   *
-   * Always aligned on 8-byte boundaries. Aligned on 16-bytes boundaries when 
-   * allocated with operator new (as required by structure used in BspTree).
-   * Brother nodes are always placed near each other, with the left one located
-   * on the 16-bytes boundary. */
-  ALIGN(8) class BspNode {
-  private:
-    /* My bithacks rely on this. */
-    STATIC_ASSERT((sizeof(intptr_t) == sizeof(int)));
-
-  public:
-    struct LEAF {};
-    struct INNER {};
-
-    BspNode() {}
-
-    BspNode(const LEAF& /* type */, int triangleListSize, const int* triangleList) {
-      assert((reinterpret_cast<intptr_t>(triangleList) & MASK_FLAG) == 0);
-      mAxisFlagPtr = reinterpret_cast<intptr_t>(triangleList);
-      mIndexListSize = triangleListSize;
-    }
-
-    BspNode(const INNER& /* type */, int splitAxis, float splitPosition, BspNode* leftChild) {
-      assert((reinterpret_cast<intptr_t>(leftChild) & (MASK_FLAG | MASK_SPLIT_DIM)) == 0);
-      assert(splitAxis >= 0 && splitAxis <= 2);
-      mAxisFlagPtr = 
-        reinterpret_cast<intptr_t>(leftChild) | (splitAxis << 1) | 1;
-      mSplitPosition = splitPosition;
-    }
-
-
-    /** @returns true if this node is a leaf, false otherwise. */
-    bool isLeaf() const {
-      return (mAxisFlagPtr & MASK_FLAG) == 0;
-    }
-
-    /** @returns splitting dimension of this inner node plus shift modulo 3.
-     * Note that splitting dimension is returned as an index of the axis,
-     * perpendicular to the splitting plane, i.e. 0 for yz, 1 for xz, 2 for xy. */
-    template<int shift>
-    int getDim() const {
-      STATIC_ASSERT((shift >= 0 && shift <= 2));
-      assert(!isLeaf());
-
-      /* A quick note on this black magic. We don't want to perform shifts here,
-       * so instead we use shifted dimension indices to access our lookup table.
-       * The only thing left is to build such a table, and think of how to 
-       * access it.
-       *
-       * When accessing a table, since the original dimension index is stored
-       * shifted, we get index 0 for original 0, 2 for original 1, and 4 for 
-       * original 2. It gives the following layout:
-       *
-       * <code>{0,  , 1,  , 2,  ,  ,  }</code>
-       *
-       * We need to handle shift values from 0 to 2. On original shift of 0
-       * we can take array shift as zero. Taking array shift of 2 for
-       * original shift of 1 is also correct, if we add one element to our
-       * array:
-       *
-       * <code>{0,  , 1,  , 2,  , 0,  }</code>
-       *
-       * Then the only one shift left to handle is the shift of 2. We can use
-       * array shift of 1 for it, since we have free elements in our array
-       * on that shift. It gives the following layout:
-       *
-       * <code>{0, 2, 1, 0, 2, 1, 0,  }</code>
-       *
-       * So, we have the following mapping for shift:
-       *
-       * <tt>
-       * 0 -> 0
-       * 1 -> 2
-       * 2 -> 1
-       * </tt>
-       *
-       * If we replace here <tt>0 -> 0</tt> with <tt>0 -> 3</tt>, then this
-       * mapping could be expressed with simple expression 
-       * <code>shift - 3</code>. Looking on the structure of our array we 
-       * see, that we can do it. This gives the following layout:
-       *
-       * <code>{ , 2, 1, 0, 2, 1, 0, 2}</code>
-       *
-       * That's exactly the layout you see below. */
-      ALIGN(SMART_CACHELINE) static const unsigned int sSplitLookup[8] = 
-        {0xFFFFFFFF, 2, 1, 0, 2, 1, 0, 2};
-      return sSplitLookup[(mAxisFlagPtr & MASK_SPLIT_DIM) + (3 - shift)];
-    }
-
-    /** @returns splitting dimension of this inner node. */
-    int getSplitDim() const {
-      return getDim<0>();
-    }
-
-    /** @returns a split plane coordinate of this inner node. */
-    float getSplitCoord() const {
-      assert(!isLeaf());
-      return mSplitPosition;
-    }
-
-    /** @returns the left child of this inner node. */
-    const BspNode* getLeftChild() const {
-      assert(!isLeaf());
-      return reinterpret_cast<const BspNode*>(mAxisFlagPtr & MASK_POINTER);
-    }
-
-    /** @returns the right child of this inner node. */
-    const BspNode* getRightChild() const {
-      return getLeftChild() + 1;
-    }
-
-    /** @returns a triangle indices list corresponding to this leaf node. */
-    NodeTriangleIdList getTriangleIndexList() const {
-      assert(isLeaf());
-      return NodeTriangleIdList(mIndexListSize, reinterpret_cast<const int*>(mAxisFlagPtr));
-    }
-
-  private:
-    enum {
-      MASK_FLAG = 0x1,
-      MASK_SPLIT_DIM = 0x6,
-      MASK_POINTER = 0xFFFFFFF8
-    };
-
-    /** This field has different structure for leaf and inner nodes.
-     *
-     * For inner nodes:
-     * bit 0      : 1;
-     * bits 1..2  : splitting dimension;
-     * bits 3..31 : pointer to first child.
-     *
-     * For leaf nodes:
-     * bits 0..1  : 0;
-     * bits 2..31 : pointer to triangle list.
-     *
-     * Bit 0 is obviously a flag, which determines the type of the node. 
-     *
-     * Now I guess I need to explain, why this magic works. 
-     *
-     * For inner nodes we store a pointer to another node, which is always 
-     * 8-byte aligned, therefore three lowermost bits of such a pointer are 
-     * always zeros. That's why we can use them for our purposes.
-     *
-     * For leaf nodes we store a pointer to triangle list, which is always
-     * 4-byte aligned, i.e. its two lowermost bits are always zeros. Since 
-     * we've picked zero for leaf node flag, we don't even need to apply a bit 
-     * mask - what is stored in this field is exactly the pointer.
-     *
-     * We store splitting dimension by shifting it one bit. Therefore, we get
-     * 0 for x, 2 for y, and 4 for z. We can transform them into normal 0-1-2 
-     * indexes using a static array - we were going to use it anyway for fast 
-     * modulo 3 division. The only problem is that such a trick adds one 
-     * additional indirection for computing the actual splitting plane 
-     * dimension. This needs more testing.
-     *
-     * Another thing - we probably want to call prefetch as soon as possible.
-     * Even before we know the actual type of the node. The problem is that
-     * bit mask for pointer extraction differs for different node types. But 
-     * even if we use bitmask for inner node, we won't miss for more that 
-     * 4 bytes, which is not a miss actually. Therefore, prefetch is not 
-     * affected by such a bit layout.
-     *
-     * TODO: try using Wald's structure. */
-    intptr_t mAxisFlagPtr;
-
-    union {
-      /** Coordinate of the splitting plane. Valid only for inner nodes. */
-      float mSplitPosition;
-
-      /** Number of triangles in the list corresponding to this leaf node. */
-      int mIndexListSize;
-    };
-
-    /** Lookup table for splitting plane extraction */
-    ALIGN(SMART_CACHELINE) static const unsigned int sSplitLookup[];
-  };
-
-
-// -------------------------------------------------------------------------- //
-// BspTree
-// -------------------------------------------------------------------------- //
-  /** Binary Space Partitioning tree with axis-aligned splitting planes, 
-   * optimized for fast tracing. */
-  class BspTree: private arx::noncopyable {
-  public:
-#if 0
-    class ClipperInterface {
-    public:
-      /* This one should return a bounding box of an intersection of the
-       * given object with the given bounding box. */
-      template<class Object>
-      BoundingBox operator()(const Object&, const BoundingBox&);
-
-      template<class Object>
-      BoundingBox operator()(const Object&);
-    };
-#endif
-
-    /** Default Constructor.
-     * Constructs an uninitialized BSP Tree, which cannot be used. */
-    BspTree() {
-      mNodePairAllocator.setArena(mArena);
-      mIntAllocator.setArena(mArena);
-      mCompiled = false;
-    }
-
-    /** Compiles the BSP Tree. */
-    template<class ObjectArray, class Clipper>
-    void compile(const ObjectArray& objects, Clipper clipper) {
-      compile(objects, clipper, FakeBbArray<ObjectArray, Clipper>(objects, clipper));
-    }
-
-    template<class ObjectArray, class Clipper, class BoundingBoxArray>
-    void compile(const ObjectArray& objects, Clipper clipper, const BoundingBoxArray& boundingBoxes) {
-      assert(objects.size() > 0);
-      assert(objects.size() == boundingBoxes.size());
-
-      /* Reserve memory for tree structure. */
-      int minMemoryNeeded = sahEstimateMinMemoryNeeded(objects.size());
-      int maxMemoryNeeded = sahEstimateMaxMemoryNeeded(objects.size());
-      mArena.reserve(minMemoryNeeded);
-      mArena.setNextBlockCapacity(
-        std::min(1024 * 1024, (maxMemoryNeeded - minMemoryNeeded) / 4 + 1)
-      );
-
-      /* Build context. */
-      SahContext<ObjectArray, Clipper> ctx(objects, clipper);
-      ctx.classes.resize(objects.size());
-      arx::FastArray<Event> events;
-      events.reserve(sahEstimateEventListSize(objects.size()));
-
-      /* Build event list and global bounding box. */
-      mBoundingBox = BoundingBox::empty();
-      for(int i = 0; i < objects.size(); i++) {
-        BoundingBox boundingBox = boundingBoxes[i];
-        mBoundingBox.extend(boundingBox);
-
-        sahGenerateEvents(events, boundingBox, i);
-      }
-      std::sort(events.begin(), events.end(), EventSahComparer());
-
-      /* Allocate root. */
-      mRoot = &mNodePairAllocator.allocate(1)->child[CLASS_R];
-
-      /* Recurse. Note that we cannot pass the bounding box which is stored in
-       * a field of our class, since node construction routine modifies the
-       * given one. */
-      BoundingBox boundingBox = mBoundingBox;
-      constructNode(
-        ctx, mRoot, arx::ArrayTail<arx::FastArray<Event> >(events, 0), 
-        objects.size(), boundingBox, 0
-      );
-
-      /* We're done. */
-      mCompiled = true;
-    }
-
-    /** @returns root node of this BSP tree. */
-    const BspNode* getRoot() const {
-      return mRoot;
-    }
-
-    /** @returns root node of this BSP tree. */
-    BspNode* getRoot() {
-      return mRoot;
-    }
-
-    /** @returns bounding box of the triangle structure that this BSP tree was 
-     *    built upon. */
-    const BoundingBox& getBoundingBox() const {
-      assert(mCompiled);
-      return mBoundingBox;
-    }
-
-  private:
-    /* TODO: check whether align(16) is really needed here... */
-    ALIGN(16) struct NodePair {
-      BspNode child[2]; /* Indexed by ObjectClass */
-    };
-
-    /** ObjectClass enumeration is used for object classification during SAH
-     * BSP tree compilation. It represents the side relative to the split
-     * plane, on which an object will be after the split is performed. */
-    enum ObjectClass {
-      CLASS_L = 0,
-      CLASS_R = 1,
-      CLASS_B,
-    };
-
-    /** Event structure represents a single event used in SAH BSP tree 
-     * construction. An event is basically a potential split plane position,
-     * with some additional information attached to it. This additional 
-     * information include the index of an object from which the event was
-     * generated, and the type of an event - whether it was generated at
-     * the point of that object with the minimal coordinate (BEGIN event),
-     * or with the maximal coordinate (END event). For flat objects only
-     * one event of type FLAT is generated instead of BEGIN & END pair. */
-    struct Event {
-      /* Type of an event. */
-      enum EventType {
-        END,
-        FLAT,
-        BEGIN
-      };
-
-      Event() {}
-
-      Event(int dim, EventType type, float pos, int index):
-        dim(dim), type(type), pos(pos), index(index) {}
-
-      int dim;        /**< Index of the potential split plane dimension. */
-      float pos;      /**< Position of the potential split plane dimension. */
-      EventType type; /**< Event type. */
-      int index;      /**< Index of an object from which this event was generated. */
-    };
-
-    /** Comparer class used in sorting of event lists in SAH compilation
-     * implementation. */
-    struct EventSahComparer {
-      bool operator()(const Event& a, const Event& b) {
-        if(a.pos == b.pos) {
-          if(a.dim == b.dim) {
-            return a.type < b.type;
-          } else
-            return a.dim < b.dim;
-        } else
-          return a.pos < b.pos;
-      }
-    };
-
-    /** FakeBbArray class provides an array-like interface to access bounding
-     * boxes of the list of given objects, for which bounding boxes are
-     * calculated dynamically.
-     *
-     * This class allows to use the same code for tree building in case the
-     * list of bounding boxes is not provided to the compilation routine 
-     * without allocation of any additional storage for these bounding boxes. */
-    template<class ObjectArray, class Clipper> class FakeBbArray {
-    public:
-      typedef typename ObjectArray::size_type size_type;
-
-      FakeBbArray(const ObjectArray& objects, const Clipper& clipper):
-        mObjects(objects), mClipper(clipper) {}
-
-      BoundingBox operator[] (int index) const {
-        return mClipper(mObjects[index]);
-      }
-
-      size_type size() const {
-        return mObjects.size();
-      }
-
-    private:
-      const ObjectArray& mObjects;
-      const Clipper mClipper;
-    };
-
-
-    /** Single structure holding all the temporaries used during SAH BSP tree
-     * construction. */
-    template<class ObjectArray, class Clipper>
-    struct SahContext {
-      SahContext(const ObjectArray& objects, Clipper clipper):
-        objects(objects), clipper(clipper) {}
-
-      const ObjectArray& objects;
-      Clipper clipper;
-      arx::FastArray<ObjectClass> classes;
-      arx::FastArray<Event> oldEvents[2];
-      arx::FastArray<Event> newEvents[2];
-    };
-
-    /**
-     * @param nodeCount count of nodes in BSP tree.
-     * @param nonEmptyLeafCount number of non-empty leaf nodes in BSP tree.
-     * @param objectsPerNonEmptyLeaf average number of objects per non-empty leaf node.
-     * @returns an estimated amount of memory needed to store a compiled BSP 
-     *   tree with the given parameters. */
-    int estimateMemoryNeeded(int nodeCount, int nonEmptyLeafCount, float objectsPerNonEmptyLeaf) {
-      int indexListSize = static_cast<int>(nonEmptyLeafCount * objectsPerNonEmptyLeaf);
-      return
-        nodeCount * sizeof(BspNode) + 
-        indexListSize * sizeof(int) + 
-        nonEmptyLeafCount * arx::alignment_of<NodePair>::value / 2;
-    }
-
-    /** 
-     * @param n number of objects.
-     * @returns an estimated minimal amount of memory needed to store a
-     *   SAH compiled BSP tree for given number of objects.*/
-    int sahEstimateMinMemoryNeeded(int n) {
-      return estimateMemoryNeeded(3 * n, n, 2);
-    }
-
-    /** 
-     * @param n number of objects.
-     * @returns an estimated maximal amount of memory needed to store a
-     *   SAH compiled BSP tree for given number of objects.*/
-    int sahEstimateMaxMemoryNeeded(int n) {
-      return estimateMemoryNeeded(10 * n, 3 * n, 3);
-    }
-
-    /**
-     * @param n number of objects.
-     * @returns an estimated size of event list stack, used during SAH
-     *   compilation of BSP tree. */
-    int sahEstimateEventListSize(int n) {
-      /* Every object spawns no more than six events. Then, event list 
-       * is processed recursively, being split in two on every next 
-       * recursion level. Our hope is that the longest list chain will be 
-       * no longer than twice the size of the initial list. */
-      return 6 * 2 * n;
-    }
-/*
-    template<class A>
-    void out(const A& events, int cnt) {
-      std::cout << "size = " << events.size() << std::endl;
-      for(int i = 0; i < events.size(); i++)
-        std::cout << (events[i].dim == 0 ? "x" : (events[i].dim == 1 ? "y" : "z")) << " " <<
-        (events[i].type == Event::BEGIN ? "<" : (events[i].type == Event::END ? ">" : "|")) << " " <<
-        events[i].pos << " " << events[i].index << "-" << cnt << std::endl;
-      std::cout << std::endl;
-      std::cout << std::endl;
-    }
-*/
-    template<class ObjectArray, class Clipper>
-    void constructNode(SahContext<ObjectArray, Clipper>& ctx, BspNode* node, 
-                       arx::ArrayTail<arx::FastArray<Event> > events, 
-                       int objectCount, BoundingBox& boundingBox, int currentDepth) {
-      /* Check depth first. */
-      if(currentDepth >= SMART_MAX_BSPTREE_DEPTH) {
-        constructLeaf(node, events, objectCount);
-        return;
-      }
-
-      /* Precompute parameters for sah test. 
-       * Note that there is no "2" term here, because the only way these values
-       * are used is multiplication, and therefore these "2" terms would have
-       * been eaten by each other anyway %). */
-      Vector3f extent = boundingBox.getExtent();
-      float invSurfaceArea = 
-        1 / (extent[0] * extent[1] + extent[1] * extent[2] + extent[2] * extent[0]);
-      Vector3f sideLengths = 
-        Vector3f(extent[1] + extent[2], extent[2] + extent[0], extent[0] + extent[1]);
-
-      /* Count of objects to the left and to the right of current plane 
-       * respectively. One number for each dimension. Note that single object 
-       * may contribute to both of these numbers. */
-      Vector3i nL, nR;
-
-      /* Initially all objects are to the right. */
-      nL.setZero();
-      nR.setConstant(objectCount);
-
-#ifdef DEBUG
-      int realCount = 0;
-      for(int i = 0; i < events.size(); i++)
-        if(events[i].dim == 0 && events[i].type != Event::END)
-          realCount++;
-      assert(realCount == objectCount);
-#endif
-
-      /* Are we dealing with "flat" node? */
-      bool isFlatNode = 
-        ((boundingBox.getMax() - boundingBox.getMin()).cwise() < SMART_BSPSAH_SAMEPOS_EPS).any();
-
-      /* Best split parameters. */
-      float bestPos;
-      int bestDim;
-      ObjectClass bestFlatClass;
-      float bestCost = std::numeric_limits<float>::max();
-      int bestN[2]; /* Indexed by class. */
-
-      /* Find best split. */
-      for(int i = 0; i < events.size();) {
-        /* Current splitting plane position. */
-        int dim = events[i].dim;
-        float pos = events[i].pos;
-
-        /* Count number of events of three different kinds on the current plane. */
-        int pL = 0, pF = 0, pR = 0;
-        while(i < events.size() && events[i].dim == dim && events[i].pos == pos && events[i].type == Event::END)
-          { pL++; i++; }
-        while(i < events.size() && events[i].dim == dim && events[i].pos == pos && events[i].type == Event::FLAT)
-          { pF++; i++; }
-        while(i < events.size() && events[i].dim == dim && events[i].pos == pos && events[i].type == Event::BEGIN)
-          { pR++; i++; }
-
-        /* Then update corresponding object counts - every object that ends
-         * on the current plane, or lies on the current plane, doesn't lie
-         * on the right anymore. */
-        nR[dim] -= pF + pL;
-
-        /* We don't need long thin noodles, as well as we don't want to slice
-         * flat cells into the ones which are even flatter. */
-        if(!isFlatNode || (pos - boundingBox.getMin(dim) > SMART_BSPSAH_SAMEPOS_EPS && boundingBox.getMax(dim) - pos > SMART_BSPSAH_SAMEPOS_EPS)) {
-          /* Apply SAH. */
-          ObjectClass flatClass;
-          float cost = sahCost(boundingBox.getMin(dim), boundingBox.getMax(dim), pos, 
-            nL[dim], pF, nR[dim], invSurfaceArea, sideLengths[dim], flatClass);
-
-          /* Store best. */
-          if(cost < bestCost) {
-            bestCost = cost;
-            bestDim = dim;
-            bestPos = pos;
-            bestFlatClass = flatClass;
-            bestN[CLASS_L] = nL[dim];
-            bestN[CLASS_R] = nR[dim];
-            bestN[bestFlatClass] += pF;
-          }
-        }
-
-        /* Update object counts for the next step - every object that lies
-         * on the current plane or begins on the current plane, from now on 
-         * also lies on the left. */
-        nL[dim] += pR + pF;
-      }
-
-      /* We have best split, but maybe it's too expensive and it's better to
-       * terminate instead? */
-      if(sahCostLeaf(objectCount) < bestCost) {
-        constructLeaf(node, events, objectCount);
-        return;
-      }
-
-      /* Ok, we have to split more. Time to classify objects. */
-      for(int i = 0;;) {
-        for(; i < events.size() && events[i].pos < bestPos; i++) {
-          if(events[i].dim == bestDim) {
-            if(events[i].type == Event::BEGIN) {
-              ctx.classes[events[i].index] = CLASS_B;
-            } else {
-              ctx.classes[events[i].index] = CLASS_L;
-            }
-          }
-        }
-        for(; i < events.size() && events[i].pos == bestPos; i++) {
-          if(events[i].dim == bestDim) {
-            if(events[i].type == Event::END) {
-              ctx.classes[events[i].index] = CLASS_L;
-            } else if(events[i].type == Event::FLAT) {
-              ctx.classes[events[i].index] = bestFlatClass;
-            } else { /* It's BEGIN event. */
-              ctx.classes[events[i].index] = CLASS_R;
-            }
-          }
-        }
-        for(; i < events.size(); i++)
-          if(events[i].dim == bestDim)
-            if(events[i].type != Event::END) /* i.e. FLAT or BEGIN. */
-              ctx.classes[events[i].index] = CLASS_R;
-        break;
-      }
-
-      /* Build bounding boxes for child nodes - we'll use them soon. */
-      BoundingBox& leftBoundingBox = boundingBox;
-      BoundingBox rightBoundingBox = boundingBox;
-      leftBoundingBox.setMax(bestDim, bestPos);
-      rightBoundingBox.setMin(bestDim, bestPos);
-
-      /* Then it's time to split events in left and right ones, splitting old
-       * ones where it's needed. 
-       *
-       * Note that we multiply count by six in reserve calls here because each 
-       * triangle may have at most six associated events. */
-      int splittingObjectCount = bestN[CLASS_L] + bestN[CLASS_R] - objectCount;
-      ctx.oldEvents[CLASS_L].reserve(6 * (bestN[CLASS_L] - splittingObjectCount));
-      ctx.oldEvents[CLASS_R].reserve(6 * (bestN[CLASS_R] - splittingObjectCount));
-      ctx.newEvents[CLASS_L].reserve(6 * splittingObjectCount);
-      ctx.newEvents[CLASS_R].reserve(6 * splittingObjectCount);
-
-      for(int i = 0; i < events.size(); i++) {
-        if(ctx.classes[events[i].index] == CLASS_B) {
-          if(events[i].dim == 0 && events[i].type != Event::END) {
-            /* If object is on both sides, then it must be split.
-             * Note that only BEGIN events can get here since FLAT events 
-             * cannot be of CLASS_B */
-            sahGenerateEvents(
-              ctx.newEvents[CLASS_L], 
-              ctx.clipper(ctx.objects[events[i].index], leftBoundingBox), 
-              events[i].index
-            );
-            sahGenerateEvents(
-              ctx.newEvents[CLASS_R], 
-              ctx.clipper(ctx.objects[events[i].index], rightBoundingBox), 
-              events[i].index
-            );
-          }
-        } else {
-          /* If object is on one of the sides - than we don't touch it. */
-          ctx.oldEvents[ctx.classes[events[i].index]].push_back(events[i]);
-        }
-      }
-
-      /* Sort lists of newly created events as they are unsorted now. */
-      std::sort(ctx.newEvents[CLASS_L].begin(), ctx.newEvents[CLASS_L].end(), EventSahComparer());
-      std::sort(ctx.newEvents[CLASS_R].begin(), ctx.newEvents[CLASS_R].end(), EventSahComparer());
-
-      /* OK, now it's time for some magic. We're using a stack-like structure
-       * of arrays of events, but instead of using a real stack, we operate
-       * on one big array and access it via tail objects. 
-       * Since we don't want our big array to grow really big, we merge
-       * a bigger resulting array in it first, and a smaller one second,
-       * so that we can run the handling of a smaller one first.
-       * Smaller one will be handled faster, and when finished, it will free
-       * some place for the bigger one. This branching tactics is optimal. */
-      int eventCounts[2] = {
-        ctx.oldEvents[CLASS_L].size() + ctx.newEvents[CLASS_L].size(),
-        ctx.oldEvents[CLASS_R].size() + ctx.newEvents[CLASS_R].size()
-      };
-      events.reserve(eventCounts[CLASS_L] + eventCounts[CLASS_R]);
-      NodePair* children = mNodePairAllocator.allocate(1);
-
-      BoundingBox *childrenBoundingBoxes[2] = {&leftBoundingBox, &rightBoundingBox};
-      ObjectClass childOrder[2];
-      if(eventCounts[CLASS_L] < eventCounts[CLASS_R]) {
-        childOrder[0] = CLASS_L;
-        childOrder[1] = CLASS_R;
-      } else {
-        childOrder[0] = CLASS_R;
-        childOrder[1] = CLASS_L;
-      }
-
-      /* Resize events to the needed size first. */
-      events.resize(eventCounts[CLASS_L] + eventCounts[CLASS_R]);
-
-      /* Merge events of second-to-process child first, and vice-versa. */
-      for(int i = 1; i >= 0; i--) {
-        std::merge(
-          ctx.newEvents[childOrder[i]].begin(), 
-          ctx.newEvents[childOrder[i]].end(),
-          ctx.oldEvents[childOrder[i]].begin(), 
-          ctx.oldEvents[childOrder[i]].end(),
-          events.begin() + ((i == 0) ? eventCounts[childOrder[1]] : 0), 
-          EventSahComparer()
-        );
-      }
-
-      /* We don't need old & new event arrays anymore. */
-      ctx.newEvents[CLASS_L].clear();
-      ctx.oldEvents[CLASS_L].clear();
-      ctx.newEvents[CLASS_R].clear();
-      ctx.oldEvents[CLASS_R].clear();
-
-      /* Construct node. */
-      new (node) BspNode(BspNode::INNER(), bestDim, bestPos, &children->child[CLASS_L]);
-
-      /* Recurse. */
-      for(int i = 0; i <= 1; i++) {
-        constructNode(
-          ctx, 
-          &children->child[childOrder[i]], 
-          events.tail((i == 0) ? eventCounts[childOrder[1]] : 0), 
-          bestN[childOrder[i]], 
-          *childrenBoundingBoxes[childOrder[i]],
-          currentDepth + 1
-        );
-      }
-    }
-
-    /** Constructs a leaf node.
-     * 
-     * @param node pointer to node to construct.
-     * @param events array of associated events.
-     * @param objectCount number of objects in this node. */
-    void constructLeaf(BspNode* node, arx::ArrayTail<arx::FastArray<Event> > events, int objectCount) {
-      if(objectCount != 0) {
-        int* indexList = mIntAllocator.allocate(objectCount);
-        int* indexListPtr = indexList;
-        for(int i = 0; i < events.size(); i++)
-          if(events[i].dim == 0 && events[i].type != Event::END)
-            *indexListPtr++ = events[i].index;
-        assert(indexListPtr - indexList == objectCount);
-        events.clear();
-        new (node) BspNode(BspNode::LEAF(), objectCount, indexList);
-      } else {
-        new (node) BspNode(BspNode::LEAF(), 0, NULL);
-      }
-    }
-
-    /** For the given bounding box of an objects, generates several events
-     * associated with it, outputting them into the given array. 
-     *
-     * @param dst array to output events to.
-     * @param boundingBox bounding box of an object. 
-     * @param objectIndex index of an object. */
-    template<class ArrayOfEvent>
-    void sahGenerateEvents(ArrayOfEvent& dst, const BoundingBox& boundingBox, int objectIndex) {
-      assert(!boundingBox.isEmpty());
-
-      for(int k = 0; k < 3; k++) {
-        if(boundingBox.getMin(k) == boundingBox.getMax(k)) {
-          dst.push_back(Event(k, Event::FLAT,  boundingBox.getMin(k), objectIndex));
-        } else {
-          dst.push_back(Event(k, Event::BEGIN, boundingBox.getMin(k), objectIndex));
-          dst.push_back(Event(k, Event::END,   boundingBox.getMax(k), objectIndex));
-        }
-      }
-    }
-
-    /** Cost function for surface area heuristic. Estimates SAH cost for the
-     * given split.
-     *
-     * @param min minimal coordinate of the current voxel.
-     * @param max maximal coordinate of the current voxel.
-     * @param pos coordinate of the split plane.
-     * @param nL number of objects to the left of the split plane.
-     * @param nF number of flat object lying on the split plane.
-     * @param nR number of objects to the right of the split plane.
-     * @param invSurfaceArea inverse of the surface area of the current voxel.
-     * @param sideLength sum of sides of the current voxel, which are
-     *   parallel to the splitting plane.
-     * @param flatClass (out) ObjectClass for flat objects lying on the split
-     *   plane which gives best SAH cost.
-     *
-     * @returns SAH cost. */
-    FORCEINLINE float sahCost(float min, float max, float pos, int nL, int nF, int nR, 
-                              float invSurfaceArea, float sideLength, ObjectClass& flatClass) {
-      bool favorEmptySpaceCutOff = (pos != min && pos != max);
-      float pL = 1 - sideLength * (max - pos) * invSurfaceArea;
-      float pR = 1 - sideLength * (pos - min) * invSurfaceArea;
-      float costL = sahCostInner(pL, pR, nL + nF, nR, favorEmptySpaceCutOff);
-      float costR = sahCostInner(pL, pR, nL, nF + nR, favorEmptySpaceCutOff);
-
-      if(costL < costR) {
-        flatClass = CLASS_L;
-        return costL;
-      } else {
-        flatClass = CLASS_R;
-        return costR;
-      }
-    }
-
-    enum {
-      sahTraversalCost = 15,
-      sahIntersetionCost = 20
-    };
-
-    /** Estimates SAH cost for inner, non-leaf node.
-     * 
-     * @param pL probability of a ray hitting the left child voxel provided
-     *   that the enclosing parent voxel is hit.
-     * @param pL probability of a ray hitting the right child voxel provided
-     *   that the enclosing parent voxel is hit.
-     * @param nL number of object in the left child voxel.
-     * @param nR number of object in the right child voxel.
-     *
-     * @returns SAH cost. */
-    FORCEINLINE float sahCostInner(float pL, float pR, int nL, int nR, bool favorEmptySpaceCutOff) {
-      float result = sahTraversalCost + sahIntersetionCost * (pL * nL + pR * nR);
-
-      /* Favor the splits which cut off empty space. */
-      if(favorEmptySpaceCutOff && (nL == 0 || nR == 0))
-        result *= 0.8f;
-
-      return result;
-    }
-
-    /** Estimates SAH cost for leaf node.
-     * 
-     * @param n number of object in this node.
-     * @returns SAH cost. */
-    FORCEINLINE float sahCostLeaf(int n) {
-      return sahIntersetionCost * static_cast<float>(n);
-    }
-
-    typedef MemoryArena<MulDivAdd<1, 1, 0> > ArenaType;
-
-    ArenaType mArena;
-    MemoryArenaAllocator<int, ArenaType> mIntAllocator;
-    MemoryArenaAllocator<NodePair, ArenaType> mNodePairAllocator;
-
-    BspNode* mRoot;
-
-    BoundingBox mBoundingBox;
-
-    bool mCompiled;
-  };
-
-} // namespace smart
-
-#endif // __SMART_BSPTREE_H__
+#ifndef __SMART_BSPTREE_H__
+#define __SMART_BSPTREE_H__
+
+#include "common.h"
+#include <cassert>
+#include <algorithm>
+#include <limits>
+#include <cstring>
+#include <ostream>
+#include <vector>
+#include <arx/Collections.h>
+#include <arx/Utility.h>
+#include <arx/static_assert.h>
+#include <arx/Memory.h>
+#include "BoundingBox.h"
+#include "MemoryArena.h"
+#include "Task.h"
+#include "Timer.h"
+#include "Atomic.h"
+
+namespace smart {
+// -------------------------------------------------------------------------- //
+// NodeTriangleIdList
+// -------------------------------------------------------------------------- //
+  /** Wrapper class for list of triangle ids stored in a leaf node. 
+   * 
+   * Indices are stored either as ints, or as unsigned shorts for trees 
+   * built over less than 65536 objects, see BspTree::relayout. */
+  class NodeTriangleIdList {
+  public:
+    int operator[] (int index) const {
+      assert(0 <= index && index < mSize);
+      return mShortIndices != NULL ? mShortIndices[index] : mIndices[index];
+    }
+
+    int size() const {
+      return mSize;
+    }
+
+    /** @returns pointer to the first element of this list. Must not be
+     * called for lists of short indices. */
+    const int* getIndices() const {
+      assert(mShortIndices == NULL);
+      return mIndices;
+    }
+
+  private:
+    friend class BspNode;
+
+    NodeTriangleIdList(int size, const int* indices):
+      mSize(size), mIndices(indices), mShortIndices(NULL) {}
+
+    NodeTriangleIdList(int size, const unsigned short* indices):
+      mSize(size), mIndices(NULL), mShortIndices(indices) {}
+
+    int mSize;
+    const int* mIndices;
+    const unsigned short* mShortIndices;
+  };
+
+
+// -------------------------------------------------------------------------- //
+// BspNode
+// -------------------------------------------------------------------------- //
+  /** Single node of a BSP tree. 
+   *
+   * Always aligned on 8-byte boundaries. Aligned on 16-bytes boundaries when 
+   * allocated with operator new (as required by structure used in BspTree).
+   * Brother nodes are always placed near each other, with the left one located
+   * on the 16-bytes boundary. */
+  ALIGN(8) class BspNode {
+  private:
+    /* My bithacks rely on this. */
+    STATIC_ASSERT((sizeof(intptr_t) == sizeof(int)));
+
+  public:
+    struct LEAF {};
+    struct SHORT_LEAF {};
+    struct INLINE_LEAF {};
+    struct INNER {};
+
+    BspNode() {}
+
+    BspNode(const LEAF& /* type */, int triangleListSize, const int* triangleList) {
+      assert((reinterpret_cast<intptr_t>(triangleList) & (MASK_FLAG | MASK_INLINE)) == 0);
+      assert(triangleListSize >= 0);
+      mAxisFlagPtr = reinterpret_cast<intptr_t>(triangleList);
+      mIndexListSize = triangleListSize;
+    }
+
+    BspNode(const SHORT_LEAF& /* type */, int triangleListSize, const unsigned short* triangleList) {
+      assert((reinterpret_cast<intptr_t>(triangleList) & (MASK_FLAG | MASK_INLINE)) == 0);
+      assert(triangleListSize > 0);
+      mAxisFlagPtr = reinterpret_cast<intptr_t>(triangleList);
+      mIndexListSize = -triangleListSize;
+    }
+
+    BspNode(const INLINE_LEAF& /* type */, int triangleIndex) {
+      mAxisFlagPtr = MASK_INLINE;
+      mTriangleIndex = triangleIndex;
+    }
+
+    BspNode(const INNER& /* type */, int splitAxis, float splitPosition, BspNode* leftChild) {
+      assert((reinterpret_cast<intptr_t>(leftChild) & (MASK_FLAG | MASK_SPLIT_DIM)) == 0);
+      assert(splitAxis >= 0 && splitAxis <= 2);
+      mAxisFlagPtr = 
+        reinterpret_cast<intptr_t>(leftChild) | (splitAxis << 1) | 1;
+      mSplitPosition = splitPosition;
+    }
+
+
+    /** @returns true if this node is a leaf, false otherwise. */
+    bool isLeaf() const {
+      return (mAxisFlagPtr & MASK_FLAG) == 0;
+    }
+
+    /** @returns true if this leaf node stands for a subtree that is not built
+     * yet. Such a node must be expanded with BspTree::expand before it can
+     * be traversed, see BSP_BUILD_LAZY_BINNED_SAH. */
+    bool isDeferred() const {
+      return (mAxisFlagPtr & (MASK_FLAG | MASK_INLINE)) == MASK_INLINE && mAxisFlagPtr != MASK_INLINE;
+    }
+
+    /** Same as isDeferred, but safe to call while another thread expands 
+     * this node. The tagged pointer is loaded with acquire semantics, so 
+     * if the node is not deferred anymore, the reads of the node and its 
+     * subtree that follow see what publish has written. Traversals of 
+     * lazily built trees must check each node with it before reading it. */
+    bool isDeferredAcquire() const {
+      intptr_t axisFlagPtr = loadAcquire(&mAxisFlagPtr);
+      return (axisFlagPtr & (MASK_FLAG | MASK_INLINE)) == MASK_INLINE && axisFlagPtr != MASK_INLINE;
+    }
+
+    /** @returns splitting dimension of this inner node plus shift modulo 3.
+     * Note that splitting dimension is returned as an index of the axis,
+     * perpendicular to the splitting plane, i.e. 0 for yz, 1 for xz, 2 for xy. */
+    template<int shift>
+    int getDim() const {
+      STATIC_ASSERT((shift >= 0 && shift <= 2));
+      assert(!isLeaf());
+
+      /* A quick note on this black magic. We don't want to perform shifts here,
+       * so instead we use shifted dimension indices to access our lookup table.
+       * The only thing left is to build such a table, and think of how to 
+       * access it.
+       *
+       * When accessing a table, since the original dimension index is stored
+       * shifted, we get index 0 for original 0, 2 for original 1, and 4 for 
+       * original 2. It gives the following layout:
+       *
+       * <code>{0,  , 1,  , 2,  ,  ,  }</code>
+       *
+       * We need to handle shift values from 0 to 2. On original shift of 0
+       * we can take array shift as zero. Taking array shift of 2 for
+       * original shift of 1 is also correct, if we add one element to our
+       * array:
+       *
+       * <code>{0,  , 1,  , 2,  , 0,  }</code>
+       *
+       * Then the only one shift left to handle is the shift of 2. We can use
+       * array shift of 1 for it, since we have free elements in our array
+       * on that shift. It gives the following layout:
+       *
+       * <code>{0, 2, 1, 0, 2, 1, 0,  }</code>
+       *
+       * So, we have the following mapping for shift:
+       *
+       * <tt>
+       * 0 -> 0
+       * 1 -> 2
+       * 2 -> 1
+       * </tt>
+       *
+       * If we replace here <tt>0 -> 0</tt> with <tt>0 -> 3</tt>, then this
+       * mapping could be expressed with simple expression 
+       * <code>shift - 3</code>. Looking on the structure of our array we 
+       * see, that we can do it. This gives the following layout:
+       *
+       * <code>{ , 2, 1, 0, 2, 1, 0, 2}</code>
+       *
+       * That's exactly the layout you see below. */
+      ALIGN(SMART_CACHELINE) static const unsigned int sSplitLookup[8] = 
+        {0xFFFFFFFF, 2, 1, 0, 2, 1, 0, 2};
+      return sSplitLookup[(mAxisFlagPtr & MASK_SPLIT_DIM) + (3 - shift)];
+    }
+
+    /** @returns splitting dimension of this inner node. */
+    int getSplitDim() const {
+      return getDim<0>();
+    }
+
+    /** @returns a split plane coordinate of this inner node. */
+    float getSplitCoord() const {
+      assert(!isLeaf());
+      return mSplitPosition;
+    }
+
+    /** @returns the left child of this inner node. */
+    const BspNode* getLeftChild() const {
+      assert(!isLeaf());
+      return reinterpret_cast<const BspNode*>(mAxisFlagPtr & MASK_POINTER);
+    }
+
+    /** @returns the right child of this inner node. */
+    const BspNode* getRightChild() const {
+      return getLeftChild() + 1;
+    }
+
+    /** @returns a triangle indices list corresponding to this leaf node. */
+    NodeTriangleIdList getTriangleIndexList() const {
+      assert(isLeaf() && !isDeferred());
+      if(mAxisFlagPtr & MASK_INLINE)
+        return NodeTriangleIdList(1, &mTriangleIndex);
+      else if(mIndexListSize < 0)
+        return NodeTriangleIdList(-mIndexListSize, reinterpret_cast<const unsigned short*>(mAxisFlagPtr));
+      else
+        return NodeTriangleIdList(mIndexListSize, reinterpret_cast<const int*>(mAxisFlagPtr));
+    }
+
+  private:
+    friend class BspTree;
+
+    struct DEFERRED {};
+
+    BspNode(const DEFERRED& /* type */, void* subtree) {
+      assert((reinterpret_cast<intptr_t>(subtree) & (MASK_FLAG | MASK_INLINE)) == 0 && subtree != NULL);
+      mAxisFlagPtr = reinterpret_cast<intptr_t>(subtree) | MASK_INLINE;
+      mIndexListSize = 0;
+    }
+
+    /** @returns record of the subtree this deferred node stands for. */
+    void* getDeferredSubtree() const {
+      assert(isDeferred());
+      return reinterpret_cast<void*>(mAxisFlagPtr & ~static_cast<intptr_t>(MASK_INLINE));
+    }
+
+    /** Replaces this node with the given one, so that a concurrent reader 
+     * that sees the new mAxisFlagPtr also sees the new second field, see
+     * isDeferredAcquire. */
+    void publish(const BspNode& other) {
+      mTriangleIndex = other.mTriangleIndex;
+      memoryBarrier();
+      *const_cast<volatile intptr_t*>(&mAxisFlagPtr) = other.mAxisFlagPtr;
+    }
+
+    /** Adds the given delta to the pointer stored in this node, if there is
+     * one. Delta must be a multiple of 8. */
+    void rebase(intptr_t delta) {
+      assert((delta & (MASK_FLAG | MASK_SPLIT_DIM)) == 0);
+      if(!isLeaf() || ((mAxisFlagPtr & MASK_INLINE) == 0 && mIndexListSize != 0))
+        mAxisFlagPtr += delta;
+    }
+
+    enum {
+      MASK_FLAG = 0x1,
+      MASK_INLINE = 0x2,
+      MASK_SPLIT_DIM = 0x6,
+      MASK_POINTER = 0xFFFFFFF8
+    };
+
+    /** This field has different structure for leaf and inner nodes.
+     *
+     * For inner nodes:
+     * bit 0      : 1;
+     * bits 1..2  : splitting dimension;
+     * bits 3..31 : pointer to first child.
+     *
+     * For leaf nodes:
+     * bit 0      : 0;
+     * bit 1      : 1 if the only triangle index is stored in the node itself,
+     *              or if the node is deferred;
+     * bits 2..31 : pointer to triangle list, 0 for inlined leaves, or 
+     *              pointer to subtree record for deferred nodes.
+     *
+     * Bit 0 is obviously a flag, which determines the type of the node. 
+     *
+     * Now I guess I need to explain, why this magic works. 
+     *
+     * For inner nodes we store a pointer to another node, which is always 
+     * 8-byte aligned, therefore three lowermost bits of such a pointer are 
+     * always zeros. That's why we can use them for our purposes.
+     *
+     * For leaf nodes we store a pointer to triangle list, which is always
+     * 4-byte aligned, i.e. its two lowermost bits are always zeros. Since 
+     * we've picked zero for leaf node flag, we don't even need to apply a bit 
+     * mask - what is stored in this field is exactly the pointer. Leaves 
+     * with a single triangle store its index in place of the list size and 
+     * set bit 1, so that no list is needed at all. Lists of short indices are
+     * allocated 4-byte aligned too, and are marked with negative size. 
+     * Deferred nodes are told from inlined leaves by a non-zero pointer.
+     *
+     * We store splitting dimension by shifting it one bit. Therefore, we get
+     * 0 for x, 2 for y, and 4 for z. We can transform them into normal 0-1-2 
+     * indexes using a static array - we were going to use it anyway for fast 
+     * modulo 3 division. The only problem is that such a trick adds one 
+     * additional indirection for computing the actual splitting plane 
+     * dimension. This needs more testing.
+     *
+     * Another thing - we probably want to call prefetch as soon as possible.
+     * Even before we know the actual type of the node. The problem is that
+     * bit mask for pointer extraction differs for different node types. But 
+     * even if we use bitmask for inner node, we won't miss for more that 
+     * 4 bytes, which is not a miss actually. Therefore, prefetch is not 
+     * affected by such a bit layout.
+     *
+     * TODO: try using Wald's structure. */
+    intptr_t mAxisFlagPtr;
+
+    union {
+      /** Coordinate of the splitting plane. Valid only for inner nodes. */
+      float mSplitPosition;
+
+      /** Number of triangles in the list corresponding to this leaf node,
+       * negated for lists of short indices. */
+      int mIndexListSize;
+
+      /** Index of the only triangle of an inlined leaf node. */
+      int mTriangleIndex;
+    };
+
+    /** Lookup table for splitting plane extraction */
+    ALIGN(SMART_CACHELINE) static const unsigned int sSplitLookup[];
+  };
+
+
+// -------------------------------------------------------------------------- //
+// BspBuildMethod
+// -------------------------------------------------------------------------- //
+  /** BSP tree construction algorithm. */
+  enum BspBuildMethod {
+    /** Exact SAH with sorted event lists, O(N log N). Builds the best trees,
+     * use it for static geometry. */
+    BSP_BUILD_EXACT_SAH,
+
+    /** SAH evaluated only at SMART_BSPSAH_BIN_COUNT bin boundaries per axis,
+     * O(N) per tree level. Builds somewhat worse trees several times faster,
+     * use it for geometry that is rebuilt every frame. */
+    BSP_BUILD_BINNED_SAH,
+
+    /** Binned SAH that builds only the upper part of the tree on compile.
+     * Subtrees of at most SMART_BSPTREE_LAZY_SUBTREE_SIZE objects are built
+     * when a ray first reaches them, so the parts of a model that are never 
+     * seen cost nothing. Use it for big models of which only a small part
+     * is visible. Trees built this way cannot be saved with saveImage. 
+     * Their traversal checks every node for being deferred, with an acquire
+     * load, which traversal of other trees doesn't. */
+    BSP_BUILD_LAZY_BINNED_SAH,
+
+    /** No tree at all, a single leaf holding all the objects. Cheapest to 
+     * build, and the fastest to trace for a handful of objects. */
+    BSP_BUILD_LEAF,
+
+    /** Picks one of the methods above by the number of objects, see 
+     * BspBuildParams::autoLeafSize and BspBuildParams::autoBinnedSize. 
+     * Models use it by default. */
+    BSP_BUILD_AUTO,
+
+    BSP_BUILD_METHOD_COUNT
+  };
+
+
+// -------------------------------------------------------------------------- //
+// BspBuildParams
+// -------------------------------------------------------------------------- //
+  /** Parameters of BSP tree construction. Defaults are tuned for typical
+   * static meshes. */
+  struct BspBuildParams {
+    BspBuildParams(): 
+      buildMethod(BSP_BUILD_EXACT_SAH), traversalCost(15.0f), intersectionCost(20.0f), 
+      emptySpaceBonus(0.2f), maxDepth(SMART_MAX_BSPTREE_DEPTH), 
+      maxLeafSize(std::numeric_limits<int>::max()), terminationThreshold(1.0f),
+      autoLeafSize(SMART_BSPTREE_AUTO_LEAF_SIZE), autoBinnedSize(SMART_BSPTREE_AUTO_BINNED_SIZE) {}
+
+    /** Construction algorithm. */
+    BspBuildMethod buildMethod;
+
+    /** SAH cost of traversing an inner node. */
+    float traversalCost;
+
+    /** SAH cost of intersecting an object. */
+    float intersectionCost;
+
+    /** Fraction by which SAH cost of a split that cuts off empty space is 
+     * reduced, in [0, 1). */
+    float emptySpaceBonus;
+
+    /** Maximal depth of a leaf, must not exceed SMART_MAX_BSPTREE_DEPTH. */
+    int maxDepth;
+
+    /** Nodes with more objects are split even if SAH suggests a leaf, unless 
+     * there is no split at all, the best split leaves all the objects in one
+     * of the children, or maxDepth is reached. */
+    int maxLeafSize;
+
+    /** Node is split only if the best split costs less than this many times 
+     * the cost of a leaf. Smaller values build shallower trees. */
+    float terminationThreshold;
+
+    /** With BSP_BUILD_AUTO, trees over at most this many objects are built 
+     * as a single leaf. */
+    int autoLeafSize;
+
+    /** With BSP_BUILD_AUTO, trees over at most this many objects, but more 
+     * than autoLeafSize, are built with binned SAH. Bigger ones are built
+     * with exact SAH. Values below autoLeafSize disable binned SAH. */
+    int autoBinnedSize;
+
+    /** @returns construction algorithm to use for a tree over the given 
+     * number of objects, never BSP_BUILD_AUTO. */
+    BspBuildMethod resolveBuildMethod(int objectCount) const {
+      if(buildMethod != BSP_BUILD_AUTO)
+        return buildMethod;
+      else if(objectCount <= autoLeafSize)
+        return BSP_BUILD_LEAF;
+      else if(objectCount <= autoBinnedSize)
+        return BSP_BUILD_BINNED_SAH;
+      else
+        return BSP_BUILD_EXACT_SAH;
+    }
+  };
+
+
+// -------------------------------------------------------------------------- //
+// BspTreeStats
+// -------------------------------------------------------------------------- //
+  /** Structure and quality statistics of a BSP tree, see BspTree::getStats.
+   * Statistics of several trees can be aggregated with add. */
+  struct BspTreeStats {
+    BspTreeStats():
+      treeCount(0), nodeCount(0), leafCount(0), emptyLeafCount(0), maxDepth(0), 
+      leafDepthSum(0), maxLeafSize(0), objectCount(0), objectReferenceCount(0), 
+      deferredLeafCount(0), sahCost(0.0f), buildTime(0.0), scratchSize(0) {
+      std::fill(buildMethodCounts, buildMethodCounts + BSP_BUILD_METHOD_COUNT, 0);
+    }
+
+    /** Aggregates statistics of another tree into this one. */
+    void add(const BspTreeStats& other) {
+      treeCount += other.treeCount;
+      nodeCount += other.nodeCount;
+      leafCount += other.leafCount;
+      emptyLeafCount += other.emptyLeafCount;
+      maxDepth = std::max(maxDepth, other.maxDepth);
+      leafDepthSum += other.leafDepthSum;
+      maxLeafSize = std::max(maxLeafSize, other.maxLeafSize);
+      objectCount += other.objectCount;
+      objectReferenceCount += other.objectReferenceCount;
+      deferredLeafCount += other.deferredLeafCount;
+      sahCost += other.sahCost;
+      buildTime += other.buildTime;
+      scratchSize = std::max(scratchSize, other.scratchSize);
+      for(int i = 0; i < BSP_BUILD_METHOD_COUNT; i++)
+        buildMethodCounts[i] += other.buildMethodCounts[i];
+    }
+
+    /** @returns fraction of leaves that are empty. */
+    float getEmptyLeafRatio() const {
+      return leafCount == 0 ? 0.0f : static_cast<float>(emptyLeafCount) / leafCount;
+    }
+
+    /** @returns average depth of a leaf. */
+    float getAverageDepth() const {
+      return leafCount == 0 ? 0.0f : static_cast<float>(leafDepthSum) / leafCount;
+    }
+
+    /** @returns average number of object references in a non-empty leaf. */
+    float getAverageLeafSize() const {
+      int nonEmptyLeafCount = leafCount - emptyLeafCount;
+      return nonEmptyLeafCount == 0 ? 0.0f : static_cast<float>(objectReferenceCount) / nonEmptyLeafCount;
+    }
+
+    /** @returns average number of leaves an object is referenced from. Values
+     * much greater than one mean that objects are heavily split by clipping. */
+    float getDuplicationFactor() const {
+      return objectCount == 0 ? 0.0f : static_cast<float>(objectReferenceCount) / objectCount;
+    }
+
+    int treeCount;            /**< Number of trees aggregated. */
+    int nodeCount;            /**< Total number of nodes, including leaves. */
+    int leafCount;            /**< Number of leaves. */
+    int emptyLeafCount;       /**< Number of empty leaves. */
+    int maxDepth;             /**< Maximal depth of a leaf, root has depth 0. */
+    int leafDepthSum;         /**< Sum of depths of all leaves. */
+    int maxLeafSize;          /**< Maximal number of object references in a leaf. */
+    int objectCount;          /**< Number of objects the tree was built upon. */
+    int objectReferenceCount; /**< Number of object references in all leaves. */
+
+    /** Number of leaves that stand for subtrees that are not built yet, see
+     * BSP_BUILD_LAZY_BINNED_SAH. Such leaves are counted as holding all the 
+     * objects of their subtrees. */
+    int deferredLeafCount;
+    
+    /** Expected cost of tracing a ray that hits the tree's bounding box, in
+     * the units of the SAH constants used for construction. For aggregated
+     * statistics it's a sum over the trees. */
+    float sahCost;
+    
+    /** Time spent in the last compile or refit, in seconds. Zero for trees 
+     * loaded from image. */
+    double buildTime;
+
+    /** Scratch memory taken by the last exact SAH compile, in bytes. Subtree
+     * tasks have scratch memory of their own, which is added in, so for
+     * parallel builds it's an upper bound of the peak footprint. Trees are
+     * usually compiled one after another, so for aggregated statistics it's
+     * a maximum over the trees. */
+    int scratchSize;
+
+    /** Number of trees built with each construction algorithm, indexed by
+     * BspBuildMethod. Trees built with BSP_BUILD_AUTO are counted under the
+     * method that was picked for them. */
+    int buildMethodCounts[BSP_BUILD_METHOD_COUNT];
+  };
+
+
+// -------------------------------------------------------------------------- //
+// BspTree
+// -------------------------------------------------------------------------- //
+  /** Binary Space Partitioning tree with axis-aligned splitting planes, 
+   * optimized for fast tracing. */
+  class BspTree: private arx::noncopyable {
+  public:
+#if 0
+    class ClipperInterface {
+    public:
+      /* This one should return a bounding box of an intersection of the
+       * given object with the given bounding box. */
+      template<class Object>
+      BoundingBox operator()(const Object&, const BoundingBox&);
+
+      template<class Object>
+      BoundingBox operator()(const Object&);
+    };
+#endif
+
+    /** Default Constructor.
+     * Constructs an uninitialized BSP Tree, which cannot be used. */
+    BspTree() {
+      mBuildMethod = BSP_BUILD_EXACT_SAH;
+      mLazyBuilder = NULL;
+      mLeafPacker = NULL;
+      mArenaIndex = 0;
+      mBuildTime = 0.0;
+      mScratchSize = 0;
+      mCompiled = false;
+    }
+
+    ~BspTree() {
+      clear();
+      delete mLeafPacker;
+    }
+
+    /** Destroys tree structure, so that the tree can be compiled again. */
+    void clear() {
+      mArenas[0].clear();
+      mArenas[1].clear();
+      for(int i = 0; i < mTaskArenas.size(); i++)
+        delete mTaskArenas[i];
+      mTaskArenas.clear();
+      for(int i = 0; i < mLazySubtrees.size(); i++)
+        delete mLazySubtrees[i];
+      mLazySubtrees.clear();
+      delete mLazyBuilder;
+      mLazyBuilder = NULL;
+      mCompiled = false;
+    }
+
+    /** Sets construction parameters to use in subsequent compile and refit 
+     * calls. */
+    void setBuildParams(const BspBuildParams& params) {
+      assert(params.traversalCost > 0 && params.intersectionCost > 0);
+      assert(params.emptySpaceBonus >= 0 && params.emptySpaceBonus < 1);
+      assert(params.maxDepth >= 0 && params.maxDepth <= SMART_MAX_BSPTREE_DEPTH);
+      assert(params.maxLeafSize >= 1 && params.terminationThreshold > 0);
+      assert(params.autoLeafSize >= 0 && params.autoBinnedSize >= 0);
+
+      mParams = params;
+    }
+
+    const BspBuildParams& getBuildParams() const {
+      return mParams;
+    }
+
+    /** Compiles the BSP Tree using the current build parameters. 
+     *
+     * With BSP_BUILD_AUTO, the construction algorithm is picked by the 
+     * number of objects, see BspBuildParams::resolveBuildMethod.
+     *
+     * If there is a global task runner, big subtrees of exact SAH trees are
+     * built in parallel on it, see getTaskRunner. */
+    template<class ObjectArray, class Clipper>
+    void compile(const ObjectArray& objects, Clipper clipper) {
+      compile(objects, clipper, FakeBbArray<ObjectArray, Clipper>(objects, clipper));
+    }
+
+    template<class ObjectArray, class Clipper, class BoundingBoxArray>
+    void compile(const ObjectArray& objects, Clipper clipper, const BoundingBoxArray& boundingBoxes) {
+      assert(objects.size() > 0);
+      assert(objects.size() == boundingBoxes.size());
+
+      /* Reserve memory for tree structure. */
+      int minMemoryNeeded = sahEstimateMinMemoryNeeded(objects.size());
+      int maxMemoryNeeded = sahEstimateMaxMemoryNeeded(objects.size());
+      ArenaType& arena = mArenas[mArenaIndex];
+      arena.reserve(minMemoryNeeded);
+      arena.setNextBlockCapacity(
+        std::min(1024 * 1024, (maxMemoryNeeded - minMemoryNeeded) / 4 + 1)
+      );
+
+      Timer timer;
+      mScratchSize = 0;
+      mBuildMethod = mParams.resolveBuildMethod(objects.size());
+      if(mBuildMethod == BSP_BUILD_EXACT_SAH)
+        compileExact(objects, clipper, boundingBoxes);
+      else if(mBuildMethod == BSP_BUILD_LEAF)
+        compileLeaf(objects, clipper, boundingBoxes);
+      else
+        compileBinned(objects, clipper, boundingBoxes);
+
+      /* We're done. */
+      mBuildTime = timer.getElapsed();
+      mObjectCount = objects.size();
+      mCompiled = true;
+    }
+
+    /** Updates the tree after the objects it was built upon have moved, 
+     * keeping split planes. Objects are redistributed among the existing
+     * leaves, and only the leaves that have grown more than 
+     * SMART_BSPTREE_REFIT_LEAF_GROWTH times are split further with binned SAH.
+     *
+     * This is much cheaper than compile, but tree quality degrades as the
+     * objects move away from the positions the tree was built for. The tree 
+     * is relaid out at the end, see relayout, so the leaf index lists and 
+     * nodes that were replaced are dropped, and repeated refits don't grow
+     * the memory taken by the tree.
+     *
+     * Lazily built trees are compiled anew instead, since their deferred 
+     * subtrees hold object lists of the old positions. */
+    template<class ObjectArray, class Clipper>
+    void refit(const ObjectArray& objects, Clipper clipper) {
+      refit(objects, clipper, FakeBbArray<ObjectArray, Clipper>(objects, clipper));
+    }
+
+    template<class ObjectArray, class Clipper, class BoundingBoxArray>
+    void refit(const ObjectArray& objects, Clipper clipper, const BoundingBoxArray& boundingBoxes) {
+      assert(mCompiled);
+      assert(objects.size() == boundingBoxes.size());
+
+      if(mBuildMethod == BSP_BUILD_LAZY_BINNED_SAH) {
+        clear();
+        compile(objects, clipper, boundingBoxes);
+        relayout();
+        return;
+      }
+
+      Timer timer;
+      SahContext<ObjectArray, Clipper> ctx(objects, clipper, mArenas[mArenaIndex], NULL);
+      arx::FastArray<BinnedObject> binnedObjects;
+      collectBinnedObjects(binnedObjects, boundingBoxes);
+
+      BoundingBox boundingBox = mBoundingBox;
+      refitNode(
+        ctx, mRoot, arx::ArrayTail<arx::FastArray<BinnedObject> >(binnedObjects, 0), 
+        boundingBox, 0
+      );
+      relayout();
+      mBuildTime = timer.getElapsed();
+      mScratchSize = 0;
+    }
+
+    /** @returns root node of this BSP tree. */
+    const BspNode* getRoot() const {
+      return mRoot;
+    }
+
+    /** @returns root node of this BSP tree. */
+    BspNode* getRoot() {
+      return mRoot;
+    }
+
+    /** @returns true if this tree may contain deferred nodes, which must be
+     * checked for during traversal, see BspNode::isDeferredAcquire. */
+    bool isLazy() const {
+      assert(mCompiled);
+      return mBuildMethod == BSP_BUILD_LAZY_BINNED_SAH;
+    }
+
+    /** Rearranges nodes and leaf index lists of this tree for better cache
+     * utilization. Should be called once the tree is built. Refit calls it
+     * by itself.
+     *
+     * Node pairs are grouped into cache line sized treelets of 
+     * SMART_CACHELINE / sizeof(NodePair) pairs each, taken breadth-first, 
+     * and the treelets are laid out depth-first, each followed by the index
+     * lists of its leaves. Single-object leaves are inlined into the nodes,
+     * and trees built over less than 65536 objects store short indices. 
+     * If a leaf packer is set, non-empty leaves are packed with it instead,
+     * see setLeafPacker. */
+    void relayout() {
+      assert(mCompiled);
+
+      int nodeCount, indexCount, packedSize;
+      countNodes(nodeCount, indexCount, packedSize);
+
+      ArenaType& arena = mArenas[mArenaIndex ^ 1];
+      arena.clear();
+      arena.reserve(nodeCount * sizeof(BspNode) * 2 + indexCount * sizeof(int) + packedSize + SMART_CACHELINE);
+      mRoot = relayoutTree(arena, mLeafPacker != NULL);
+
+      /* Old structure is not referenced anymore. */
+      mArenas[mArenaIndex].clear();
+      for(int i = 0; i < mTaskArenas.size(); i++)
+        delete mTaskArenas[i];
+      mTaskArenas.clear();
+      mArenaIndex ^= 1;
+    }
+
+    /** @returns structure and quality statistics of this tree. Walks the whole
+     * tree, so it's not for calling every frame. */
+    BspTreeStats getStats() const {
+      assert(mCompiled);
+
+      BspTreeStats stats;
+      stats.treeCount = 1;
+      stats.objectCount = mObjectCount;
+      stats.buildTime = mBuildTime;
+      stats.scratchSize = mScratchSize;
+      stats.buildMethodCounts[mBuildMethod]++;
+      stats.sahCost = collectStats(stats, mRoot, mBoundingBox, 0);
+      return stats;
+    }
+
+    /** Writes an image of this tree to the given stream. Image is a relaid 
+     * out copy of the tree, with all the pointers replaced by offsets from 
+     * the start of the image, see relayout and loadImage. 
+     *
+     * @returns number of bytes written, or zero if the image didn't fit into
+     *   a single memory block, in which case nothing is written. */
+    int saveImage(std::ostream& stream) const {
+      assert(mCompiled);
+      assert(mBuildMethod != BSP_BUILD_LAZY_BINNED_SAH);
+
+      int nodeCount, indexCount, packedSize;
+      countNodes(nodeCount, indexCount, packedSize);
+
+      /* Image must be contiguous, so we reserve enough memory for a single
+       * block: each treelet may waste up to a cache line on alignment, and 
+       * each short index list - up to two bytes. */
+      int capacity = (nodeCount / 2 + 2) * (sizeof(NodePair) + SMART_CACHELINE) + 
+        (nodeCount + indexCount) * sizeof(int);
+      ArenaType arena(capacity, capacity);
+      BspNode* root = relayoutTree(arena, false);
+      if(arena.blockCount() != 1)
+        return 0;
+
+      unsigned char* begin = reinterpret_cast<unsigned char*>(root - CLASS_R);
+      unsigned char* end = arena.allocate(0, 1);
+      rebaseNodes(root, -reinterpret_cast<intptr_t>(begin), true);
+
+      ImageHeader header;
+      header.size = static_cast<int>(end - begin);
+      header.rootOffset = static_cast<int>(reinterpret_cast<unsigned char*>(root) - begin);
+      header.objectCount = mObjectCount;
+      for(int i = 0; i < 3; i++) {
+        header.boundingBox[i] = mBoundingBox.getMin(i);
+        header.boundingBox[i + 3] = mBoundingBox.getMax(i);
+      }
+
+      char padding[imageHeaderSize] = {0};
+      stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      stream.write(padding, imageHeaderSize - sizeof(header));
+      stream.write(reinterpret_cast<const char*>(begin), header.size);
+      return imageHeaderSize + header.size;
+    }
+
+    /** Makes this tree a copy of an image written with saveImage. Every 
+     * offset of the image is checked against its size before the image is
+     * copied into the memory of the tree and rebased, so the image is not 
+     * modified, and is not referenced once this function returns.
+     *
+     * @param image pointer to the image.
+     * @param size number of available bytes at image.
+     * @param objectCount number of objects the tree is expected to be built
+     *   upon.
+     * @returns false if the image is malformed, in which case the tree is 
+     *   left intact, true otherwise. */
+    bool loadImage(const unsigned char* image, int size, int objectCount) {
+      if(size < imageHeaderSize)
+        return false;
+      ImageHeader header;
+      memcpy(&header, image, sizeof(header));
+      if(header.size <= 0 || header.size > size - imageHeaderSize || 
+         header.rootOffset != sizeof(BspNode) * CLASS_R || header.objectCount != objectCount || objectCount <= 0)
+        return false;
+      for(int i = 0; i < 3; i++)
+        if(!(header.boundingBox[i] <= header.boundingBox[i + 3]))
+          return false;
+      if(!checkImage(image + imageHeaderSize, header.size, header.objectCount))
+        return false;
+
+      clear();
+      unsigned char* begin = mArenas[mArenaIndex].allocate(header.size, SMART_CACHELINE);
+      memcpy(begin, image + imageHeaderSize, header.size);
+      mRoot = reinterpret_cast<BspNode*>(begin + header.rootOffset);
+      rebaseNodes(mRoot, reinterpret_cast<intptr_t>(begin), false);
+      mBoundingBox = BoundingBox(
+        Vector3f(header.boundingBox[0], header.boundingBox[1], header.boundingBox[2]),
+        Vector3f(header.boundingBox[3], header.boundingBox[4], header.boundingBox[5])
+      );
+      mObjectCount = header.objectCount;
+      mBuildMethod = mParams.resolveBuildMethod(mObjectCount);
+      mBuildTime = 0.0;
+      mScratchSize = 0;
+      mCompiled = true;
+
+      /* Tree images are never packed. */
+      if(mLeafPacker != NULL)
+        relayout();
+      return true;
+    }
+
+    /** Sets the functor that stores additional data of non-empty leaves, 
+     * like SoA blocks of their triangles, right before their index lists. 
+     * Packed leaves always store full 32-bit index lists, and are never 
+     * inlined. Leaves are packed by relayout, so that the data of a leaf 
+     * ends up next to its treelet, and, for lazily built trees, when the 
+     * deferred subtrees are built. Tree images are never packed. Packer is 
+     * kept until the tree is destroyed, and takes effect on the next 
+     * relayout.
+     *
+     * @param packer functor with two methods. int getSize(int objectCount)
+     *   const returns the number of bytes of data of a leaf with the given 
+     *   number of objects, which must be a multiple of packedLeafAlignment. 
+     *   void operator()(const NodeTriangleIdList& list, void* data) const 
+     *   writes the data of the leaf with the given list into the memory 
+     *   aligned on packedLeafAlignment. It may be called from several 
+     *   threads at once. */
+    template<class LeafPacker>
+    void setLeafPacker(LeafPacker packer) {
+      delete mLeafPacker;
+      mLeafPacker = new LeafPackerHolder<LeafPacker>(packer);
+    }
+
+    enum {
+      /** Alignment of the data of packed leaves, see setLeafPacker. */
+      packedLeafAlignment = 16
+    };
+
+    /** Builds the subtree the given deferred node stands for, and replaces
+     * the node with the root of the built subtree. Safe to call from several
+     * threads at once: a subtree is built only once, and the threads that 
+     * reach it while it's being built wait for it. Different subtrees are 
+     * built concurrently.
+     *
+     * @param node deferred node of a compiled tree, see BspNode::isDeferred. 
+     *   After the call the node is an ordinary node. */
+    static void expand(const BspNode* node) {
+      LazySubtree* subtree = static_cast<LazySubtree*>(node->getDeferredSubtree());
+
+      arx::mutex::scoped_lock lock(subtree->mutex);
+      if(!node->isDeferred())
+        return; /* Someone has built it while we were waiting. */
+
+      /* Nodes are allocated by the tree, so it's safe to cast constness away. */
+      BspNode root = *subtree->tree->mLazyBuilder->build(*subtree);
+      const_cast<BspNode*>(node)->publish(root);
+    }
+
+    /** @returns bounding box of the triangle structure that this BSP tree was 
+     *    built upon. */
+    const BoundingBox& getBoundingBox() const {
+      assert(mCompiled);
+      return mBoundingBox;
+    }
+
+  private:
+    /* TODO: check whether align(16) is really needed here... */
+    ALIGN(16) struct NodePair {
+      BspNode child[2]; /* Indexed by ObjectClass */
+    };
+
+    typedef MemoryArena<MulDivAdd<1, 1, 0> > ArenaType;
+
+    /** Record of a subtree whose construction is deferred until a ray first
+     * reaches it, see BSP_BUILD_LAZY_BINNED_SAH. Referenced from the 
+     * deferred node. */
+    struct LazySubtree: private arx::noncopyable {
+      LazySubtree(BspTree* tree, const BoundingBox& boundingBox, int depth):
+        tree(tree), boundingBox(boundingBox), depth(depth), arena(NULL) {}
+
+      ~LazySubtree() {
+        delete arena;
+      }
+
+      BspTree* tree;
+      BoundingBox boundingBox;
+      int depth;                   /**< Depth of the subtree root. */
+      arx::FastArray<int> objects; /**< Indices of the objects that overlap the subtree. */
+      arx::mutex mutex;            /**< Held while the subtree is being built. */
+      ArenaType* arena;            /**< Arena for the nodes of the subtree, sized when the subtree is deferred. */
+    };
+
+    /** Type-erased holder of the objects and the clipper the tree was 
+     * compiled with, used to build deferred subtrees. */
+    class AbstractLazyBuilder {
+    public:
+      virtual ~AbstractLazyBuilder() {}
+
+      /** Builds the given subtree.
+       *
+       * @returns root node of the built subtree. */
+      virtual const BspNode* build(LazySubtree& subtree) = 0;
+    };
+
+    template<class ObjectArray, class Clipper>
+    class LazyBuilder: public AbstractLazyBuilder {
+    public:
+      LazyBuilder(BspTree* tree, const ObjectArray& objects, Clipper clipper):
+        mTree(tree), mObjects(objects), mClipper(clipper) {}
+
+      virtual const BspNode* build(LazySubtree& subtree) {
+        return mTree->buildLazySubtree(mObjects, mClipper, subtree);
+      }
+
+    private:
+      BspTree* mTree;
+      ObjectArray mObjects;
+      Clipper mClipper;
+    };
+
+    /** Type-erased holder of a leaf packer, see setLeafPacker. */
+    class AbstractLeafPacker {
+    public:
+      virtual ~AbstractLeafPacker() {}
+
+      virtual int getSize(int objectCount) const = 0;
+
+      virtual void operator()(const NodeTriangleIdList& list, void* data) const = 0;
+    };
+
+    template<class LeafPacker>
+    class LeafPackerHolder: public AbstractLeafPacker {
+    public:
+      LeafPackerHolder(LeafPacker packer): mPacker(packer) {}
+
+      virtual int getSize(int objectCount) const {
+        return mPacker.getSize(objectCount);
+      }
+
+      virtual void operator()(const NodeTriangleIdList& list, void* data) const {
+        mPacker(list, data);
+      }
+
+    private:
+      LeafPacker mPacker;
+    };
+
+    /** Writes the given index list into the given arena, preceded by the
+     * data of the leaf packer, see setLeafPacker.
+     *
+     * @returns packed index list. */
+    const int* packLeaf(ArenaType& arena, const NodeTriangleIdList& list) const {
+      int dataSize = mLeafPacker->getSize(list.size());
+      assert(dataSize % packedLeafAlignment == 0);
+
+      unsigned char* data = arena.allocate(dataSize + list.size() * sizeof(int), packedLeafAlignment);
+      (*mLeafPacker)(list, data);
+
+      int* indexList = reinterpret_cast<int*>(data + dataSize);
+      for(int i = 0; i < list.size(); i++)
+        indexList[i] = list[i];
+      return indexList;
+    }
+
+    /** Packs all non-empty leaves in the subtree of the given node into the 
+     * given arena, see setLeafPacker. Deferred nodes are skipped. */
+    void packSubtree(BspNode* root, ArenaType& arena) const {
+      arx::FastArray<BspNode*> nodeStack;
+      nodeStack.push_back(root);
+      while(nodeStack.size() > 0) {
+        BspNode* node = nodeStack.back();
+        nodeStack.pop_back();
+
+        if(node->isDeferred()) {
+          continue;
+        } else if(node->isLeaf()) {
+          NodeTriangleIdList list = node->getTriangleIndexList();
+          if(list.size() != 0)
+            new (node) BspNode(BspNode::LEAF(), list.size(), packLeaf(arena, list));
+        } else {
+          /* Nodes are allocated by this tree, so it's safe to cast constness away. */
+          nodeStack.push_back(const_cast<BspNode*>(node->getRightChild()));
+          nodeStack.push_back(const_cast<BspNode*>(node->getLeftChild()));
+        }
+      }
+    }
+
+    /** ObjectClass enumeration is used for object classification during SAH
+     * BSP tree compilation. It represents the side relative to the split
+     * plane, on which an object will be after the split is performed. */
+    enum ObjectClass {
+      CLASS_L = 0,
+      CLASS_R = 1,
+      CLASS_B,
+    };
+
+    /** Event structure represents a single event used in SAH BSP tree 
+     * construction. An event is basically a potential split plane position,
+     * with some additional information attached to it. This additional 
+     * information include the index of an object from which the event was
+     * generated, and the type of an event - whether it was generated at
+     * the point of that object with the minimal coordinate (BEGIN event),
+     * or with the maximal coordinate (END event). For flat objects only
+     * one event of type FLAT is generated instead of BEGIN & END pair. */
+    struct Event {
+      /* Type of an event. */
+      enum EventType {
+        END,
+        FLAT,
+        BEGIN
+      };
+
+      Event() {}
+
+      Event(int dim, EventType type, float pos, int index):
+        dim(dim), type(type), pos(pos), index(index) {}
+
+      int dim;        /**< Index of the potential split plane dimension. */
+      float pos;      /**< Position of the potential split plane dimension. */
+      EventType type; /**< Event type. */
+      int index;      /**< Index of an object from which this event was generated. */
+    };
+
+    /** Comparer class used in sorting of event lists in SAH compilation
+     * implementation. */
+    struct EventSahComparer {
+      bool operator()(const Event& a, const Event& b) {
+        if(a.pos == b.pos) {
+          if(a.dim == b.dim) {
+            return a.type < b.type;
+          } else
+            return a.dim < b.dim;
+        } else
+          return a.pos < b.pos;
+      }
+    };
+
+    /** FakeBbArray class provides an array-like interface to access bounding
+     * boxes of the list of given objects, for which bounding boxes are
+     * calculated dynamically.
+     *
+     * This class allows to use the same code for tree building in case the
+     * list of bounding boxes is not provided to the compilation routine 
+     * without allocation of any additional storage for these bounding boxes. */
+    template<class ObjectArray, class Clipper> class FakeBbArray {
+    public:
+      typedef typename ObjectArray::size_type size_type;
+
+      FakeBbArray(const ObjectArray& objects, const Clipper& clipper):
+        mObjects(objects), mClipper(clipper) {}
+
+      BoundingBox operator[] (int index) const {
+        return mClipper(mObjects[index]);
+      }
+
+      size_type size() const {
+        return mObjects.size();
+      }
+
+    private:
+      const ObjectArray& mObjects;
+      const Clipper mClipper;
+    };
+
+
+    /** Object reference used in binned SAH construction. Stores the bounding
+     * box of the part of the object that lies inside the current node. */
+    struct BinnedObject {
+      BinnedObject() {}
+
+      BinnedObject(int index, const BoundingBox& boundingBox): 
+        index(index), boundingBox(boundingBox) {}
+
+      int index;               /**< Index of the object. */
+      BoundingBox boundingBox; /**< Clipped bounding box of the object. */
+    };
+
+    /** Scratch buffers of exact SAH construction. Event buffers are taken 
+     * from a single arena that is sized up front from the object count, so 
+     * that node construction doesn't touch the heap, see initSahScratch. 
+     * Classification buffer is indexed by object index, so it is as large as
+     * the whole object array. Subtree tasks borrow it from the tree together
+     * with the node arena, see SahWorker. */
+    struct SahScratch {
+      SahScratch(): 
+        arena(NULL), classes(NULL), splitEvents(NULL), events(NULL), eventCapacity(0), size(0) {}
+
+      ArenaType* arena;     /**< Arena the buffers are taken from. */
+      ObjectClass* classes; /**< Classes of objects, indexed by object index. */
+      Event* splitEvents;   /**< Events of the children of the node being split, before they're merged. */
+      Event* events;        /**< Stack of event lists of the nodes waiting to be built. */
+      int eventCapacity;    /**< Capacity of the event stack. */
+      int size;             /**< Number of bytes taken from the arena. */
+    };
+
+    /** Node waiting to be built on the work stack of exact SAH construction. */
+    struct SahWorkItem {
+      SahWorkItem() {}
+
+      SahWorkItem(BspNode* node, int eventOffset, int eventCount, int objectCount, 
+                  const BoundingBox& boundingBox, int depth):
+        node(node), eventOffset(eventOffset), eventCount(eventCount), objectCount(objectCount), 
+        boundingBox(boundingBox), depth(depth) {}
+
+      BspNode* node;
+      int eventOffset;         /**< Offset of the node's event list in the event stack. */
+      int eventCount;          /**< Number of events of the node. */
+      int objectCount;         /**< Number of objects of the node. */
+      BoundingBox boundingBox;
+      int depth;
+    };
+
+    /** Work stack of exact SAH construction. Smaller child is always built
+     * first, so there is at most one waiting sibling per tree level. */
+    typedef arx::StaticFastArray<SahWorkItem, SMART_MAX_BSPTREE_DEPTH + 2> SahWorkStack;
+
+    /** Memory a thread needs to build exact SAH subtrees: an arena for the
+     * nodes, and a classification buffer. Tree creates one of them per 
+     * worker in compileExact before the build starts, and subtree tasks 
+     * borrow them for the time they run, see acquireSahWorker. */
+    struct SahWorker {
+      SahWorker(): arena(NULL), classes(NULL) {}
+
+      SahWorker(ArenaType* arena, ObjectClass* classes): arena(arena), classes(classes) {}
+
+      ArenaType* arena;     /**< Arena for the nodes, owned by the tree, see mTaskArenas. */
+      ObjectClass* classes; /**< Classification buffer for the whole object array. */
+    };
+
+    /** Single structure holding all the temporaries used during SAH BSP tree
+     * construction. Each subtree task has its own context, and allocates its
+     * nodes from its own arena. */
+    template<class ObjectArray, class Clipper>
+    struct SahContext {
+      SahContext(const ObjectArray& objects, Clipper clipper, ArenaType& arena, TaskGroup* group):
+        objects(objects), clipper(clipper), group(group), lazy(false), intAllocator(arena), nodePairAllocator(arena) {}
+
+      const ObjectArray& objects;
+      Clipper clipper;
+      TaskGroup* group; /**< Group to spawn subtree tasks in, NULL if the tree is built serially. */
+      bool lazy;        /**< Whether small subtrees are to be deferred, see BSP_BUILD_LAZY_BINNED_SAH. */
+      MemoryArenaAllocator<int, ArenaType> intAllocator;
+      MemoryArenaAllocator<NodePair, ArenaType> nodePairAllocator;
+      SahScratch scratch;
+      arx::FastArray<BinnedObject> binnedObjects[2];
+      arx::FastArray<int> indices[2];
+    };
+
+    /** Task that constructs a subtree on the worker pool. Owns the event 
+     * buffers of its subtree, which are allocated when the task is spawned, 
+     * and borrows a node arena and a classification buffer while it runs. */
+    template<class ObjectArray, class Clipper>
+    class SahTask: public AbstractTask {
+    public:
+      SahTask(BspTree* tree, const SahContext<ObjectArray, Clipper>& parentCtx, BspNode* node, 
+              const Event* events, int eventCount, int objectCount, const BoundingBox& boundingBox, int depth):
+        mTree(tree), mObjects(parentCtx.objects), mClipper(parentCtx.clipper), mGroup(parentCtx.group), 
+        mNode(node), mEventCount(eventCount), mObjectCount(objectCount), mBoundingBox(boundingBox), mDepth(depth),
+        mScratchArena(tree->sahScratchSize(objectCount), 1) 
+      {
+        mTree->initSahScratch(mScratch, mScratchArena, objectCount);
+        assert(eventCount <= mScratch.eventCapacity);
+        std::copy(events, events + eventCount, mScratch.events);
+      }
+
+      virtual void run() {
+        SahWorker worker = mTree->acquireSahWorker(mObjects.size(), mObjectCount);
+        SahContext<ObjectArray, Clipper> ctx(mObjects, mClipper, *worker.arena, mGroup);
+        ctx.scratch = mScratch;
+        ctx.scratch.classes = worker.classes;
+        mTree->constructTree(ctx, mNode, mEventCount, mObjectCount, mBoundingBox, mDepth);
+        mTree->releaseSahWorker(worker);
+        mTree->addScratchSize(ctx.scratch.size);
+
+        /* Tree may be finished right after this call, so it must be the last one. */
+        mGroup->taskDone();
+      }
+
+    private:
+      BspTree* mTree;
+      const ObjectArray& mObjects;
+      Clipper mClipper;
+      TaskGroup* mGroup;
+      BspNode* mNode;
+      int mEventCount;
+      int mObjectCount;
+      BoundingBox mBoundingBox;
+      int mDepth;
+      ArenaType mScratchArena;
+      SahScratch mScratch;
+    };
+
+    template<class ObjectArray, class Clipper> friend class SahTask;
+    template<class ObjectArray, class Clipper> friend class LazyBuilder;
+
+    /** Compiles the BSP tree with exact SAH. */
+    template<class ObjectArray, class Clipper, class BoundingBoxArray>
+    void compileExact(const ObjectArray& objects, Clipper clipper, const BoundingBoxArray& boundingBoxes) {
+      /* Build context. Subtree tasks are spawned only for models that are big 
+       * enough to benefit from it. */
+      AbstractTaskRunner* runner = getTaskRunner();
+      bool parallel = runner != NULL && 6 * objects.size() >= 2 * SMART_BSPSAH_PARALLEL_MIN_EVENTS;
+      TaskGroup* group = NULL;
+      if(parallel) {
+        group = new TaskGroup(runner);
+
+        /* Memory for the subtree tasks is allocated before the build starts.
+         * Tasks are spread evenly among the workers, so are their nodes. */
+        int workerCount = runner->getWorkerCount();
+        for(int i = 0; i < workerCount; i++)
+          mSahWorkerPool.push_back(newSahWorker(objects.size(), objects.size() / workerCount + 1));
+      }
+      SahContext<ObjectArray, Clipper> ctx(objects, clipper, mArenas[mArenaIndex], group);
+      ArenaType scratchArena(sahScratchSize(objects.size()), 1);
+      initSahScratch(ctx.scratch, scratchArena, objects.size());
+      ctx.scratch.classes = new ObjectClass[objects.size()];
+      addScratchSize(objects.size() * sizeof(ObjectClass));
+
+      /* Build event list and global bounding box. */
+      mBoundingBox = BoundingBox::empty();
+      Event* eventsEnd = ctx.scratch.events;
+      for(int i = 0; i < objects.size(); i++) {
+        BoundingBox boundingBox = boundingBoxes[i];
+        mBoundingBox.extend(boundingBox);
+
+        eventsEnd = sahGenerateEvents(eventsEnd, boundingBox, i);
+      }
+      std::sort(ctx.scratch.events, eventsEnd, EventSahComparer());
+
+      /* Allocate root. */
+      mRoot = &ctx.nodePairAllocator.allocate(1)->child[CLASS_R];
+
+      /* Build. */
+      constructTree(ctx, mRoot, static_cast<int>(eventsEnd - ctx.scratch.events), objects.size(), mBoundingBox, 0);
+      delete[] ctx.scratch.classes;
+      addScratchSize(ctx.scratch.size);
+
+      /* Wait for the subtree tasks. */
+      if(group != NULL) {
+        group->wait();
+        delete group;
+      }
+
+      /* All the workers are back in the pool. Their arenas hold tree nodes, 
+       * so only the classification buffers go. */
+      for(int i = 0; i < mSahWorkerPool.size(); i++)
+        delete[] mSahWorkerPool[i].classes;
+      mSahWorkerPool.clear();
+    }
+
+    /** @param subtreeObjectCount number of objects in the subtree to build.
+     * @returns amount of memory needed for exact SAH event buffers, see
+     *   initSahScratch. */
+    int sahScratchSize(int subtreeObjectCount) {
+      return 
+        (12 * subtreeObjectCount + sahEstimateEventListSize(subtreeObjectCount)) * sizeof(Event) + 
+        2 * arx::alignment_of<Event>::value;
+    }
+
+    /** Takes exact SAH event buffers from the given arena, which must have
+     * at least sahScratchSize bytes available. 
+     *
+     * Objects of a node are never duplicated, and each of them has at most 
+     * six events, so the events of both children of a node never take more 
+     * than twelve events per object before they are merged. Event stack is
+     * sized with sahEstimateEventListSize, and grows in the unlikely case it
+     * is not enough, see growSahEventStack. */
+    void initSahScratch(SahScratch& scratch, ArenaType& arena, int subtreeObjectCount) {
+      scratch.arena = &arena;
+      scratch.classes = NULL;
+      scratch.splitEvents = reinterpret_cast<Event*>(arena.allocate<Event>(12 * subtreeObjectCount));
+      scratch.eventCapacity = sahEstimateEventListSize(subtreeObjectCount);
+      scratch.events = reinterpret_cast<Event*>(arena.allocate<Event>(scratch.eventCapacity));
+      scratch.size = sahScratchSize(subtreeObjectCount);
+    }
+
+    /** Creates memory for a thread that builds exact SAH subtrees. Arena is
+     * owned by the tree, classification buffer - by the caller.
+     *
+     * @param objectCount number of objects in the whole tree.
+     * @param subtreeObjectCount expected number of objects in the subtrees 
+     *   the thread is going to build. */
+    SahWorker newSahWorker(int objectCount, int subtreeObjectCount) {
+      int minMemoryNeeded = sahEstimateMinMemoryNeeded(subtreeObjectCount);
+      int maxMemoryNeeded = sahEstimateMaxMemoryNeeded(subtreeObjectCount);
+      ArenaType* arena = new ArenaType(minMemoryNeeded, std::min(1024 * 1024, (maxMemoryNeeded - minMemoryNeeded) / 4 + 1));
+      addScratchSize(objectCount * sizeof(ObjectClass));
+
+      arx::mutex::scoped_lock lock(mTaskArenasMutex);
+      mTaskArenas.push_back(arena);
+      return SahWorker(arena, new ObjectClass[objectCount]);
+    }
+
+    /** Borrows memory of one of the workers from the pool filled in 
+     * compileExact. The pool runs dry only if the task runner runs more 
+     * tasks at once than it has workers, then new memory is created for the
+     * extra task.
+     *
+     * @param objectCount number of objects in the whole tree.
+     * @param subtreeObjectCount number of objects in the subtree to build. */
+    SahWorker acquireSahWorker(int objectCount, int subtreeObjectCount) {
+      {
+        arx::mutex::scoped_lock lock(mTaskArenasMutex);
+        if(mSahWorkerPool.size() > 0) {
+          SahWorker worker = mSahWorkerPool.back();
+          mSahWorkerPool.pop_back();
+          return worker;
+        }
+      }
+
+      return newSahWorker(objectCount, subtreeObjectCount);
+    }
+
+    /** Returns memory taken with acquireSahWorker to the pool. */
+    void releaseSahWorker(const SahWorker& worker) {
+      arx::mutex::scoped_lock lock(mTaskArenasMutex);
+      mSahWorkerPool.push_back(worker);
+    }
+
+    /** Grows the event stack of the given scratch so that it can hold at 
+     * least the given number of events.
+     *
+     * @param liveCount number of events in use at the bottom of the stack. */
+    static void growSahEventStack(SahScratch& scratch, int capacity, int liveCount) {
+      int newCapacity = std::max(capacity, 2 * scratch.eventCapacity);
+      Event* events = reinterpret_cast<Event*>(scratch.arena->allocate<Event>(newCapacity));
+      std::copy(scratch.events, scratch.events + liveCount, events);
+      scratch.events = events;
+      scratch.eventCapacity = newCapacity;
+      scratch.size += newCapacity * sizeof(Event);
+    }
+
+    /** Adds the given amount of scratch memory to the statistics of the
+     * current build. */
+    void addScratchSize(int size) {
+      arx::mutex::scoped_lock lock(mTaskArenasMutex);
+      mScratchSize += size;
+    }
+
+    /** Compiles the BSP tree as a single leaf. */
+    template<class ObjectArray, class Clipper, class BoundingBoxArray>
+    void compileLeaf(const ObjectArray& objects, Clipper clipper, const BoundingBoxArray& boundingBoxes) {
+      SahContext<ObjectArray, Clipper> ctx(objects, clipper, mArenas[mArenaIndex], NULL);
+      arx::FastArray<BinnedObject> binnedObjects;
+      collectBinnedObjects(binnedObjects, boundingBoxes);
+
+      mRoot = &ctx.nodePairAllocator.allocate(1)->child[CLASS_R];
+      constructBinnedLeaf(ctx, mRoot, arx::ArrayTail<arx::FastArray<BinnedObject> >(binnedObjects, 0));
+    }
+
+    /** Compiles the BSP tree with binned SAH, lazy or not. */
+    template<class ObjectArray, class Clipper, class BoundingBoxArray>
+    void compileBinned(const ObjectArray& objects, Clipper clipper, const BoundingBoxArray& boundingBoxes) {
+      SahContext<ObjectArray, Clipper> ctx(objects, clipper, mArenas[mArenaIndex], NULL);
+      if(mBuildMethod == BSP_BUILD_LAZY_BINNED_SAH) {
+        ctx.lazy = true;
+        delete mLazyBuilder;
+        mLazyBuilder = new LazyBuilder<ObjectArray, Clipper>(this, objects, clipper);
+      }
+
+      arx::FastArray<BinnedObject> binnedObjects;
+      collectBinnedObjects(binnedObjects, boundingBoxes);
+
+      /* Allocate root. */
+      mRoot = &ctx.nodePairAllocator.allocate(1)->child[CLASS_R];
+
+      /* Recurse. */
+      BoundingBox boundingBox = mBoundingBox;
+      constructBinnedNode(
+        ctx, mRoot, arx::ArrayTail<arx::FastArray<BinnedObject> >(binnedObjects, 0), 
+        boundingBox, 0
+      );
+    }
+
+    /** Builds a deferred subtree, see expand. Objects are clipped to the 
+     * subtree's bounding box anew, so that deferred nodes don't have to keep
+     * clipped bounding boxes.
+     *
+     * @returns root node of the built subtree. */
+    template<class ObjectArray, class Clipper>
+    const BspNode* buildLazySubtree(const ObjectArray& objects, Clipper clipper, LazySubtree& subtree) {
+      int objectCount = subtree.objects.size();
+      SahContext<ObjectArray, Clipper> ctx(objects, clipper, *subtree.arena, NULL);
+
+      arx::FastArray<BinnedObject> binnedObjects;
+      binnedObjects.reserve(2 * objectCount);
+      for(int i = 0; i < objectCount; i++) {
+        BoundingBox clipped = clipper(objects[subtree.objects[i]], subtree.boundingBox);
+        if(!clipped.isEmpty())
+          binnedObjects.push_back(BinnedObject(subtree.objects[i], clipped));
+      }
+
+      BspNode* root = &ctx.nodePairAllocator.allocate(1)->child[CLASS_R];
+      BoundingBox boundingBox = subtree.boundingBox;
+      constructBinnedNode(
+        ctx, root, arx::ArrayTail<arx::FastArray<BinnedObject> >(binnedObjects, 0), 
+        boundingBox, subtree.depth
+      );
+
+      if(mLeafPacker != NULL)
+        packSubtree(root, *subtree.arena);
+      return root;
+    }
+
+    /** Builds initial object list for binned SAH construction and refitting,
+     * and computes global bounding box. */
+    template<class BoundingBoxArray>
+    void collectBinnedObjects(arx::FastArray<BinnedObject>& binnedObjects, const BoundingBoxArray& boundingBoxes) {
+      binnedObjects.reserve(2 * boundingBoxes.size());
+
+      mBoundingBox = BoundingBox::empty();
+      for(int i = 0; i < boundingBoxes.size(); i++) {
+        BoundingBox boundingBox = boundingBoxes[i];
+        mBoundingBox.extend(boundingBox);
+
+        binnedObjects.push_back(BinnedObject(i, boundingBox));
+      }
+    }
+
+    /**
+     * @param nodeCount count of nodes in BSP tree.
+     * @param nonEmptyLeafCount number of non-empty leaf nodes in BSP tree.
+     * @param objectsPerNonEmptyLeaf average number of objects per non-empty leaf node.
+     * @returns an estimated amount of memory needed to store a compiled BSP 
+     *   tree with the given parameters. */
+    int estimateMemoryNeeded(int nodeCount, int nonEmptyLeafCount, float objectsPerNonEmptyLeaf) {
+      int indexListSize = static_cast<int>(nonEmptyLeafCount * objectsPerNonEmptyLeaf);
+      return
+        nodeCount * sizeof(BspNode) + 
+        indexListSize * sizeof(int) + 
+        nonEmptyLeafCount * arx::alignment_of<NodePair>::value / 2;
+    }
+
+    /** 
+     * @param n number of objects.
+     * @returns an estimated minimal amount of memory needed to store a
+     *   SAH compiled BSP tree for given number of objects.*/
+    int sahEstimateMinMemoryNeeded(int n) {
+      return estimateMemoryNeeded(3 * n, n, 2);
+    }
+
+    /** 
+     * @param n number of objects.
+     * @returns an estimated maximal amount of memory needed to store a
+     *   SAH compiled BSP tree for given number of objects.*/
+    int sahEstimateMaxMemoryNeeded(int n) {
+      return estimateMemoryNeeded(10 * n, 3 * n, 3);
+    }
+
+    /**
+     * @param n number of objects.
+     * @returns an estimated size of event list stack, used during SAH
+     *   compilation of BSP tree. */
+    int sahEstimateEventListSize(int n) {
+      /* Every object spawns no more than six events. Then, event list 
+       * is processed recursively, being split in two on every next 
+       * recursion level. Our hope is that the longest list chain will be 
+       * no longer than twice the size of the initial list. */
+      return 6 * 2 * n;
+    }
+/*
+    template<class A>
+    void out(const A& events, int cnt) {
+      std::cout << "size = " << events.size() << std::endl;
+      for(int i = 0; i < events.size(); i++)
+        std::cout << (events[i].dim == 0 ? "x" : (events[i].dim == 1 ? "y" : "z")) << " " <<
+        (events[i].type == Event::BEGIN ? "<" : (events[i].type == Event::END ? ">" : "|")) << " " <<
+        events[i].pos << " " << events[i].index << "-" << cnt << std::endl;
+      std::cout << std::endl;
+      std::cout << std::endl;
+    }
+*/
+    /** Builds a subtree with exact SAH. Nodes are built one by one from an
+     * explicit work stack, see constructNode.
+     *
+     * @param root node to build the subtree at.
+     * @param eventCount number of events of the subtree, which are stored 
+     *   at the bottom of the event stack of the given context. 
+     * @param objectCount number of objects of the subtree. */
+    template<class ObjectArray, class Clipper>
+    void constructTree(SahContext<ObjectArray, Clipper>& ctx, BspNode* root, int eventCount, 
+                       int objectCount, const BoundingBox& boundingBox, int depth) {
+      SahWorkStack workStack;
+      workStack.push_back(SahWorkItem(root, 0, eventCount, objectCount, boundingBox, depth));
+      while(workStack.size() > 0) {
+        SahWorkItem item = workStack.back();
+        workStack.pop_back();
+        constructNode(ctx, workStack, item);
+      }
+    }
+
+    /** Builds a single node with exact SAH, pushing its children to the work
+     * stack.
+     *
+     * Event lists of the nodes on the work stack are stored in the event
+     * stack of the context in the same order, and the given node's list is 
+     * the topmost one. Therefore everything above its beginning is free. */
+    template<class ObjectArray, class Clipper>
+    void constructNode(SahContext<ObjectArray, Clipper>& ctx, SahWorkStack& workStack, SahWorkItem& item) {
+      SahScratch& scratch = ctx.scratch;
+      BspNode* node = item.node;
+      const Event* events = scratch.events + item.eventOffset;
+      int eventCount = item.eventCount;
+      int objectCount = item.objectCount;
+      BoundingBox& boundingBox = item.boundingBox;
+
+      /* Check depth first. */
+      if(item.depth >= mParams.maxDepth) {
+        constructLeaf(ctx, node, events, eventCount, objectCount);
+        return;
+      }
+
+      /* Precompute parameters for sah test. 
+       * Note that there is no "2" term here, because the only way these values
+       * are used is multiplication, and therefore these "2" terms would have
+       * been eaten by each other anyway %). */
+      Vector3f extent = boundingBox.getExtent();
+      float invSurfaceArea = 
+        1 / (extent[0] * extent[1] + extent[1] * extent[2] + extent[2] * extent[0]);
+      Vector3f sideLengths = 
+        Vector3f(extent[1] + extent[2], extent[2] + extent[0], extent[0] + extent[1]);
+
+      /* Count of objects to the left and to the right of current plane 
+       * respectively. One number for each dimension. Note that single object 
+       * may contribute to both of these numbers. */
+      Vector3i nL, nR;
+
+      /* Initially all objects are to the right. */
+      nL.setZero();
+      nR.setConstant(objectCount);
+
+#ifdef DEBUG
+      int realCount = 0;
+      for(int i = 0; i < eventCount; i++)
+        if(events[i].dim == 0 && events[i].type != Event::END)
+          realCount++;
+      assert(realCount == objectCount);
+#endif
+
+      /* Are we dealing with "flat" node? */
+      bool isFlatNode = 
+        ((boundingBox.getMax() - boundingBox.getMin()).cwise() < SMART_BSPSAH_SAMEPOS_EPS).any();
+
+      /* Best split parameters. */
+      float bestPos;
+      int bestDim;
+      ObjectClass bestFlatClass;
+      float bestCost = std::numeric_limits<float>::max();
+      int bestN[2]; /* Indexed by class. */
+
+      /* Find best split. */
+      for(int i = 0; i < eventCount;) {
+        /* Current splitting plane position. */
+        int dim = events[i].dim;
+        float pos = events[i].pos;
+
+        /* Count number of events of three different kinds on the current plane. */
+        int pL = 0, pF = 0, pR = 0;
+        while(i < eventCount && events[i].dim == dim && events[i].pos == pos && events[i].type == Event::END)
+          { pL++; i++; }
+        while(i < eventCount && events[i].dim == dim && events[i].pos == pos && events[i].type == Event::FLAT)
+          { pF++; i++; }
+        while(i < eventCount && events[i].dim == dim && events[i].pos == pos && events[i].type == Event::BEGIN)
+          { pR++; i++; }
+
+        /* Then update corresponding object counts - every object that ends
+         * on the current plane, or lies on the current plane, doesn't lie
+         * on the right anymore. */
+        nR[dim] -= pF + pL;
+
+        /* We don't need long thin noodles, as well as we don't want to slice
+         * flat cells into the ones which are even flatter. */
+        if(!isFlatNode || (pos - boundingBox.getMin(dim) > SMART_BSPSAH_SAMEPOS_EPS && boundingBox.getMax(dim) - pos > SMART_BSPSAH_SAMEPOS_EPS)) {
+          /* Apply SAH. */
+          ObjectClass flatClass;
+          float cost = sahCost(boundingBox.getMin(dim), boundingBox.getMax(dim), pos, 
+            nL[dim], pF, nR[dim], invSurfaceArea, sideLengths[dim], flatClass);
+
+          /* Store best. */
+          if(cost < bestCost) {
+            bestCost = cost;
+            bestDim = dim;
+            bestPos = pos;
+            bestFlatClass = flatClass;
+            bestN[CLASS_L] = nL[dim];
+            bestN[CLASS_R] = nR[dim];
+            bestN[bestFlatClass] += pF;
+          }
+        }
+
+        /* Update object counts for the next step - every object that lies
+         * on the current plane or begins on the current plane, from now on 
+         * also lies on the left. */
+        nL[dim] += pR + pF;
+      }
+
+      /* We have best split, but maybe it's too expensive and it's better to
+       * terminate instead? */
+      if(sahTerminate(objectCount, bestCost, bestN)) {
+        constructLeaf(ctx, node, events, eventCount, objectCount);
+        return;
+      }
+
+      /* Ok, we have to split more. Time to classify objects. */
+      for(int i = 0;;) {
+        for(; i < eventCount && events[i].pos < bestPos; i++) {
+          if(events[i].dim == bestDim) {
+            if(events[i].type == Event::BEGIN) {
+              scratch.classes[events[i].index] = CLASS_B;
+            } else {
+              scratch.classes[events[i].index] = CLASS_L;
+            }
+          }
+        }
+        for(; i < eventCount && events[i].pos == bestPos; i++) {
+          if(events[i].dim == bestDim) {
+            if(events[i].type == Event::END) {
+              scratch.classes[events[i].index] = CLASS_L;
+            } else if(events[i].type == Event::FLAT) {
+              scratch.classes[events[i].index] = bestFlatClass;
+            } else { /* It's BEGIN event. */
+              scratch.classes[events[i].index] = CLASS_R;
+            }
+          }
+        }
+        for(; i < eventCount; i++)
+          if(events[i].dim == bestDim)
+            if(events[i].type != Event::END) /* i.e. FLAT or BEGIN. */
+              scratch.classes[events[i].index] = CLASS_R;
+        break;
+      }
+
+      /* Build bounding boxes for child nodes - we'll use them soon. */
+      BoundingBox& leftBoundingBox = boundingBox;
+      BoundingBox rightBoundingBox = boundingBox;
+      leftBoundingBox.setMax(bestDim, bestPos);
+      rightBoundingBox.setMin(bestDim, bestPos);
+
+      /* Then it's time to split events in left and right ones, splitting old
+       * ones where it's needed. Old events of the children are placed in the
+       * split buffer first, followed by the new ones. Their exact counts are 
+       * known after a single pass over the events, and new events are bounded
+       * by six per splitting object. */
+      int oldCounts[2] = {0, 0};
+      int splittingObjectCount = 0;
+      for(int i = 0; i < eventCount; i++) {
+        ObjectClass objectClass = scratch.classes[events[i].index];
+        if(objectClass != CLASS_B)
+          oldCounts[objectClass]++;
+        else if(events[i].dim == 0 && events[i].type != Event::END)
+          splittingObjectCount++;
+      }
+
+      Event* oldEvents[2];
+      Event* newEvents[2];
+      oldEvents[CLASS_L] = scratch.splitEvents;
+      oldEvents[CLASS_R] = oldEvents[CLASS_L] + oldCounts[CLASS_L];
+      newEvents[CLASS_L] = oldEvents[CLASS_R] + oldCounts[CLASS_R];
+      newEvents[CLASS_R] = newEvents[CLASS_L] + 6 * splittingObjectCount;
+      Event* oldEventsEnd[2] = {oldEvents[CLASS_L], oldEvents[CLASS_R]};
+      Event* newEventsEnd[2] = {newEvents[CLASS_L], newEvents[CLASS_R]};
+
+      for(int i = 0; i < eventCount; i++) {
+        if(scratch.classes[events[i].index] == CLASS_B) {
+          if(events[i].dim == 0 && events[i].type != Event::END) {
+            /* If object is on both sides, then it must be split.
+             * Note that only BEGIN events can get here since FLAT events 
+             * cannot be of CLASS_B */
+            newEventsEnd[CLASS_L] = sahGenerateEvents(
+              newEventsEnd[CLASS_L], 
+              ctx.clipper(ctx.objects[events[i].index], leftBoundingBox), 
+              events[i].index
+            );
+            newEventsEnd[CLASS_R] = sahGenerateEvents(
+              newEventsEnd[CLASS_R], 
+              ctx.clipper(ctx.objects[events[i].index], rightBoundingBox), 
+              events[i].index
+            );
+          }
+        } else {
+          /* If object is on one of the sides - than we don't touch it. */
+          *oldEventsEnd[scratch.classes[events[i].index]]++ = events[i];
+        }
+      }
+      assert(newEventsEnd[CLASS_R] - scratch.splitEvents <= 12 * objectCount);
+
+      /* Sort lists of newly created events as they are unsorted now. */
+      std::sort(newEvents[CLASS_L], newEventsEnd[CLASS_L], EventSahComparer());
+      std::sort(newEvents[CLASS_R], newEventsEnd[CLASS_R], EventSahComparer());
+
+      /* OK, now it's time for some magic. Event lists of the children 
+       * replace the list of this node on the event stack. We merge a bigger
+       * resulting list in it first, and a smaller one second, so that the
+       * smaller one is handled first. Smaller one will be handled faster, 
+       * and when finished, it will free some place for the bigger one. 
+       * This branching tactics is optimal. */
+      int eventCounts[2] = {
+        static_cast<int>((oldEventsEnd[CLASS_L] - oldEvents[CLASS_L]) + (newEventsEnd[CLASS_L] - newEvents[CLASS_L])),
+        static_cast<int>((oldEventsEnd[CLASS_R] - oldEvents[CLASS_R]) + (newEventsEnd[CLASS_R] - newEvents[CLASS_R]))
+      };
+      NodePair* children = ctx.nodePairAllocator.allocate(1);
+
+      BoundingBox *childrenBoundingBoxes[2] = {&leftBoundingBox, &rightBoundingBox};
+      ObjectClass childOrder[2];
+      if(eventCounts[CLASS_L] < eventCounts[CLASS_R]) {
+        childOrder[0] = CLASS_L;
+        childOrder[1] = CLASS_R;
+      } else {
+        childOrder[0] = CLASS_R;
+        childOrder[1] = CLASS_L;
+      }
+
+      /* Make room on the event stack. Nothing above this node's list is in 
+       * use, and the list itself has already been copied. */
+      int eventOffset = item.eventOffset;
+      int eventStackSize = eventOffset + eventCounts[CLASS_L] + eventCounts[CLASS_R];
+      if(eventStackSize > scratch.eventCapacity)
+        growSahEventStack(scratch, eventStackSize, eventOffset);
+
+      /* Merge events of second-to-process child first, and vice-versa. */
+      int childEventOffsets[2];
+      childEventOffsets[childOrder[1]] = eventOffset;
+      childEventOffsets[childOrder[0]] = eventOffset + eventCounts[childOrder[1]];
+      for(int c = 0; c < 2; c++) {
+        std::merge(
+          newEvents[c], newEventsEnd[c],
+          oldEvents[c], oldEventsEnd[c],
+          scratch.events + childEventOffsets[c],
+          EventSahComparer()
+        );
+      }
+
+      /* Construct node. */
+      new (node) BspNode(BspNode::INNER(), bestDim, bestPos, &children->child[CLASS_L]);
+
+      /* Big subtree goes to the worker pool, together with a copy of its 
+       * events. Note that the bigger child is the second one to process, so
+       * it goes to the work stack first. */
+      BspNode* bigChild = &children->child[childOrder[1]];
+      if(ctx.group != NULL && eventCounts[childOrder[1]] >= SMART_BSPSAH_PARALLEL_MIN_EVENTS) {
+        ctx.group->spawn(new SahTask<ObjectArray, Clipper>(
+          this, ctx, bigChild, scratch.events + eventOffset, eventCounts[childOrder[1]], 
+          bestN[childOrder[1]], *childrenBoundingBoxes[childOrder[1]], item.depth + 1
+        ));
+      } else {
+        workStack.push_back(SahWorkItem(
+          bigChild, eventOffset, eventCounts[childOrder[1]], 
+          bestN[childOrder[1]], *childrenBoundingBoxes[childOrder[1]], item.depth + 1
+        ));
+      }
+      workStack.push_back(SahWorkItem(
+        &children->child[childOrder[0]], childEventOffsets[childOrder[0]], eventCounts[childOrder[0]], 
+        bestN[childOrder[0]], *childrenBoundingBoxes[childOrder[0]], item.depth + 1
+      ));
+    }
+
+    /** Constructs a leaf node.
+     * 
+     * @param node pointer to node to construct.
+     * @param events array of associated events.
+     * @param eventCount number of associated events.
+     * @param objectCount number of objects in this node. */
+    template<class ObjectArray, class Clipper>
+    void constructLeaf(SahContext<ObjectArray, Clipper>& ctx, BspNode* node, const Event* events, int eventCount, int objectCount) {
+      if(objectCount != 0) {
+        int* indexList = ctx.intAllocator.allocate(objectCount);
+        int* indexListPtr = indexList;
+        for(int i = 0; i < eventCount; i++)
+          if(events[i].dim == 0 && events[i].type != Event::END)
+            *indexListPtr++ = events[i].index;
+        assert(indexListPtr - indexList == objectCount);
+        new (node) BspNode(BspNode::LEAF(), objectCount, indexList);
+      } else {
+        new (node) BspNode(BspNode::LEAF(), 0, NULL);
+      }
+    }
+
+    /** Binned SAH counterpart of constructNode. Instead of sweeping over 
+     * sorted events, counts object bounds in SMART_BSPSAH_BIN_COUNT bins 
+     * per axis and evaluates SAH at bin boundaries only.
+     *
+     * @param objects objects of the node, with their bounding boxes clipped
+     *   to the node's bounding box. */
+    template<class ObjectArray, class Clipper>
+    void constructBinnedNode(SahContext<ObjectArray, Clipper>& ctx, BspNode* node, 
+                             arx::ArrayTail<arx::FastArray<BinnedObject> > objects, 
+                             BoundingBox& boundingBox, int currentDepth) {
+      enum { binCount = SMART_BSPSAH_BIN_COUNT };
+
+      int objectCount = objects.size();
+
+      /* Check depth first. */
+      if(currentDepth >= mParams.maxDepth || objectCount == 0) {
+        constructBinnedLeaf(ctx, node, objects);
+        return;
+      }
+
+      /* Small enough subtrees of lazy trees are built on demand. */
+      if(ctx.lazy && objectCount <= SMART_BSPTREE_LAZY_SUBTREE_SIZE) {
+        constructDeferredNode(node, objects, boundingBox, currentDepth);
+        return;
+      }
+
+      /* Precompute parameters for sah test, see constructNode. */
+      Vector3f extent = boundingBox.getExtent();
+      float invSurfaceArea = 
+        1 / (extent[0] * extent[1] + extent[1] * extent[2] + extent[2] * extent[0]);
+      Vector3f sideLengths = 
+        Vector3f(extent[1] + extent[2], extent[2] + extent[0], extent[0] + extent[1]);
+
+      /* Flat dimensions are never split. */
+      Vector3f binScale;
+      for(int k = 0; k < 3; k++)
+        binScale[k] = (extent[k] > SMART_BSPSAH_SAMEPOS_EPS) ? binCount / extent[k] : 0.0f;
+
+      /* Count objects starting and ending in each bin. */
+      int minBins[3][binCount];
+      int maxBins[3][binCount];
+      std::fill(&minBins[0][0], &minBins[0][0] + 3 * binCount, 0);
+      std::fill(&maxBins[0][0], &maxBins[0][0] + 3 * binCount, 0);
+      for(int i = 0; i < objectCount; i++) {
+        const BoundingBox& objectBoundingBox = objects[i].boundingBox;
+        for(int k = 0; k < 3; k++) {
+          minBins[k][binIndex(objectBoundingBox.getMin(k), boundingBox.getMin(k), binScale[k], binCount)]++;
+          maxBins[k][binIndex(objectBoundingBox.getMax(k), boundingBox.getMin(k), binScale[k], binCount)]++;
+        }
+      }
+
+      /* Find best split. */
+      float bestPos;
+      int bestDim;
+      int bestN[2];
+      float bestCost = std::numeric_limits<float>::max();
+      for(int k = 0; k < 3; k++) {
+        if(binScale[k] == 0.0f)
+          continue;
+
+        int nL = 0, nR = objectCount;
+        for(int b = 1; b < binCount; b++) {
+          /* Objects that start before the plane are on the left, objects that
+           * end before it are not on the right anymore. */
+          nL += minBins[k][b - 1];
+          nR -= maxBins[k][b - 1];
+
+          float pos = boundingBox.getMin(k) + b * extent[k] / binCount;
+          ObjectClass flatClass;
+          float cost = sahCost(boundingBox.getMin(k), boundingBox.getMax(k), pos, 
+            nL, 0, nR, invSurfaceArea, sideLengths[k], flatClass);
+
+          if(cost < bestCost) {
+            bestCost = cost;
+            bestDim = k;
+            bestPos = pos;
+            bestN[CLASS_L] = nL;
+            bestN[CLASS_R] = nR;
+          }
+        }
+      }
+
+      /* Maybe it's better to terminate? */
+      if(sahTerminate(objectCount, bestCost, bestN)) {
+        constructBinnedLeaf(ctx, node, objects);
+        return;
+      }
+
+      /* Build bounding boxes for child nodes. */
+      BoundingBox& leftBoundingBox = boundingBox;
+      BoundingBox rightBoundingBox = boundingBox;
+      leftBoundingBox.setMax(bestDim, bestPos);
+      rightBoundingBox.setMin(bestDim, bestPos);
+
+      /* Distribute objects between children. */
+      ObjectClass childOrder[2];
+      int counts[2];
+      splitBinnedObjects(ctx, objects, bestDim, bestPos, leftBoundingBox, rightBoundingBox, childOrder, counts);
+      NodePair* children = ctx.nodePairAllocator.allocate(1);
+      BoundingBox *childrenBoundingBoxes[2] = {&leftBoundingBox, &rightBoundingBox};
+
+      /* Construct node. */
+      new (node) BspNode(BspNode::INNER(), bestDim, bestPos, &children->child[CLASS_L]);
+
+      /* Recurse. */
+      for(int i = 0; i <= 1; i++) {
+        constructBinnedNode(
+          ctx, 
+          &children->child[childOrder[i]], 
+          objects.tail((i == 0) ? counts[childOrder[1]] : 0), 
+          *childrenBoundingBoxes[childOrder[i]],
+          currentDepth + 1
+        );
+      }
+    }
+
+    /** Distributes objects of a binned SAH node between its children, 
+     * clipping the ones that straddle the split plane. Child object lists
+     * are stored in the given one in the same stack-like manner constructNode
+     * stores events - the smaller list goes last and is processed first.
+     *
+     * @param childOrder (out) order in which children are to be processed.
+     * @param counts (out) numbers of objects in children, indexed by 
+     *   ObjectClass. */
+    template<class ObjectArray, class Clipper>
+    void splitBinnedObjects(SahContext<ObjectArray, Clipper>& ctx, arx::ArrayTail<arx::FastArray<BinnedObject> > objects,
+                            int dim, float pos, const BoundingBox& leftBoundingBox, const BoundingBox& rightBoundingBox,
+                            ObjectClass* childOrder, int* counts) {
+      for(int i = 0; i < objects.size(); i++) {
+        const BinnedObject& object = objects[i];
+        if(object.boundingBox.getMax(dim) <= pos) {
+          ctx.binnedObjects[CLASS_L].push_back(object);
+        } else if(object.boundingBox.getMin(dim) >= pos) {
+          ctx.binnedObjects[CLASS_R].push_back(object);
+        } else {
+          BoundingBox clipped = ctx.clipper(ctx.objects[object.index], leftBoundingBox);
+          if(!clipped.isEmpty())
+            ctx.binnedObjects[CLASS_L].push_back(BinnedObject(object.index, clipped));
+          clipped = ctx.clipper(ctx.objects[object.index], rightBoundingBox);
+          if(!clipped.isEmpty())
+            ctx.binnedObjects[CLASS_R].push_back(BinnedObject(object.index, clipped));
+        }
+      }
+
+      counts[CLASS_L] = ctx.binnedObjects[CLASS_L].size();
+      counts[CLASS_R] = ctx.binnedObjects[CLASS_R].size();
+      if(counts[CLASS_L] < counts[CLASS_R]) {
+        childOrder[0] = CLASS_L;
+        childOrder[1] = CLASS_R;
+      } else {
+        childOrder[0] = CLASS_R;
+        childOrder[1] = CLASS_L;
+      }
+
+      objects.resize(counts[CLASS_L] + counts[CLASS_R]);
+      std::copy(ctx.binnedObjects[childOrder[1]].begin(), ctx.binnedObjects[childOrder[1]].end(), objects.begin());
+      std::copy(ctx.binnedObjects[childOrder[0]].begin(), ctx.binnedObjects[childOrder[0]].end(), objects.begin() + counts[childOrder[1]]);
+      ctx.binnedObjects[CLASS_L].clear();
+      ctx.binnedObjects[CLASS_R].clear();
+    }
+
+    /** Refits a subtree, see refit.
+     *
+     * @param objects objects that overlap the node, with their bounding 
+     *   boxes clipped to the node's bounding box. */
+    template<class ObjectArray, class Clipper>
+    void refitNode(SahContext<ObjectArray, Clipper>& ctx, BspNode* node, 
+                   arx::ArrayTail<arx::FastArray<BinnedObject> > objects, 
+                   BoundingBox& boundingBox, int currentDepth) {
+      if(node->isLeaf()) {
+        NodeTriangleIdList list = node->getTriangleIndexList();
+        if(mBuildMethod != BSP_BUILD_LEAF && objects.size() > SMART_BSPTREE_REFIT_LEAF_GROWTH * std::max(list.size(), 1)) {
+          /* Leaf has grown too much, rebuild it as a subtree. Trees built as
+           * a single leaf stay that way. */
+          constructBinnedNode(ctx, node, objects, boundingBox, currentDepth);
+        } else if(!isSameObjectList(ctx, list, objects)) {
+          constructBinnedLeaf(ctx, node, objects);
+        } else {
+          objects.clear();
+        }
+        return;
+      }
+
+      /* Split planes are kept. */
+      int dim = node->getSplitDim();
+      float pos = node->getSplitCoord();
+      BoundingBox& leftBoundingBox = boundingBox;
+      BoundingBox rightBoundingBox = boundingBox;
+      leftBoundingBox.setMax(dim, pos);
+      rightBoundingBox.setMin(dim, pos);
+
+      ObjectClass childOrder[2];
+      int counts[2];
+      splitBinnedObjects(ctx, objects, dim, pos, leftBoundingBox, rightBoundingBox, childOrder, counts);
+
+      /* Recurse. Nodes are allocated by this tree, so it's safe to cast 
+       * constness away. */
+      BspNode* children = const_cast<BspNode*>(node->getLeftChild());
+      BoundingBox *childrenBoundingBoxes[2] = {&leftBoundingBox, &rightBoundingBox};
+      for(int i = 0; i <= 1; i++) {
+        refitNode(
+          ctx, 
+          &children[childOrder[i]], 
+          objects.tail((i == 0) ? counts[childOrder[1]] : 0), 
+          *childrenBoundingBoxes[childOrder[i]],
+          currentDepth + 1
+        );
+      }
+    }
+
+    /** @returns true if the given leaf index list holds exactly the given 
+     * objects, in any order. */
+    template<class ObjectArray, class Clipper>
+    bool isSameObjectList(SahContext<ObjectArray, Clipper>& ctx, const NodeTriangleIdList& list, 
+                          const arx::ArrayTail<arx::FastArray<BinnedObject> >& objects) {
+      if(list.size() != objects.size())
+        return false;
+
+      ctx.indices[0].resize(list.size());
+      ctx.indices[1].resize(list.size());
+      for(int i = 0; i < list.size(); i++) {
+        ctx.indices[0][i] = list[i];
+        ctx.indices[1][i] = objects[i].index;
+      }
+      std::sort(ctx.indices[0].begin(), ctx.indices[0].end());
+      std::sort(ctx.indices[1].begin(), ctx.indices[1].end());
+      return std::equal(ctx.indices[0].begin(), ctx.indices[0].end(), ctx.indices[1].begin());
+    }
+
+    /** @returns index of the bin the given coordinate falls into. */
+    static FORCEINLINE int binIndex(float pos, float min, float scale, int binCount) {
+      int index = static_cast<int>((pos - min) * scale);
+      return std::max(0, std::min(binCount - 1, index));
+    }
+
+    /** Binned SAH counterpart of constructLeaf. */
+    template<class ObjectArray, class Clipper>
+    void constructBinnedLeaf(SahContext<ObjectArray, Clipper>& ctx, BspNode* node, arx::ArrayTail<arx::FastArray<BinnedObject> > objects) {
+      if(objects.size() != 0) {
+        int* indexList = ctx.intAllocator.allocate(objects.size());
+        for(int i = 0; i < objects.size(); i++)
+          indexList[i] = objects[i].index;
+        new (node) BspNode(BspNode::LEAF(), objects.size(), indexList);
+        objects.clear();
+      } else {
+        new (node) BspNode(BspNode::LEAF(), 0, NULL);
+      }
+    }
+
+    /** Constructs a deferred node for the subtree with the given objects, 
+     * see expand. */
+    void constructDeferredNode(BspNode* node, arx::ArrayTail<arx::FastArray<BinnedObject> > objects, 
+                               const BoundingBox& boundingBox, int currentDepth) {
+      LazySubtree* subtree = new LazySubtree(this, boundingBox, currentDepth);
+      subtree->objects.resize(objects.size());
+
+      /* Node memory is allocated here and not in buildLazySubtree, so that 
+       * expansion in the middle of a frame doesn't wait on the heap for it. */
+      int minMemoryNeeded = sahEstimateMinMemoryNeeded(objects.size());
+      int maxMemoryNeeded = sahEstimateMaxMemoryNeeded(objects.size());
+      subtree->arena = new ArenaType(minMemoryNeeded, std::min(1024 * 1024, (maxMemoryNeeded - minMemoryNeeded) / 4 + 1));
+      for(int i = 0; i < objects.size(); i++)
+        subtree->objects[i] = objects[i].index;
+      objects.clear();
+
+      mLazySubtrees.push_back(subtree);
+      new (node) BspNode(BspNode::DEFERRED(), subtree);
+    }
+
+    /** For the given bounding box of an objects, generates several events
+     * associated with it, outputting them into the given buffer. 
+     *
+     * @param dst buffer to output events to, must have room for six events.
+     * @param boundingBox bounding box of an object. 
+     * @param objectIndex index of an object. 
+     * @returns pointer past the last generated event. */
+    static Event* sahGenerateEvents(Event* dst, const BoundingBox& boundingBox, int objectIndex) {
+      assert(!boundingBox.isEmpty());
+
+      for(int k = 0; k < 3; k++) {
+        if(boundingBox.getMin(k) == boundingBox.getMax(k)) {
+          *dst++ = Event(k, Event::FLAT,  boundingBox.getMin(k), objectIndex);
+        } else {
+          *dst++ = Event(k, Event::BEGIN, boundingBox.getMin(k), objectIndex);
+          *dst++ = Event(k, Event::END,   boundingBox.getMax(k), objectIndex);
+        }
+      }
+      return dst;
+    }
+
+    /** Cost function for surface area heuristic. Estimates SAH cost for the
+     * given split.
+     *
+     * @param min minimal coordinate of the current voxel.
+     * @param max maximal coordinate of the current voxel.
+     * @param pos coordinate of the split plane.
+     * @param nL number of objects to the left of the split plane.
+     * @param nF number of flat object lying on the split plane.
+     * @param nR number of objects to the right of the split plane.
+     * @param invSurfaceArea inverse of the surface area of the current voxel.
+     * @param sideLength sum of sides of the current voxel, which are
+     *   parallel to the splitting plane.
+     * @param flatClass (out) ObjectClass for flat objects lying on the split
+     *   plane which gives best SAH cost.
+     *
+     * @returns SAH cost. */
+    FORCEINLINE float sahCost(float min, float max, float pos, int nL, int nF, int nR, 
+                              float invSurfaceArea, float sideLength, ObjectClass& flatClass) {
+      bool favorEmptySpaceCutOff = (pos != min && pos != max);
+      float pL = 1 - sideLength * (max - pos) * invSurfaceArea;
+      float pR = 1 - sideLength * (pos - min) * invSurfaceArea;
+      float costL = sahCostInner(pL, pR, nL + nF, nR, favorEmptySpaceCutOff);
+      float costR = sahCostInner(pL, pR, nL, nF + nR, favorEmptySpaceCutOff);
+
+      if(costL < costR) {
+        flatClass = CLASS_L;
+        return costL;
+      } else {
+        flatClass = CLASS_R;
+        return costR;
+      }
+    }
+
+    /** Estimates SAH cost for inner, non-leaf node.
+     * 
+     * @param pL probability of a ray hitting the left child voxel provided
+     *   that the enclosing parent voxel is hit.
+     * @param pL probability of a ray hitting the right child voxel provided
+     *   that the enclosing parent voxel is hit.
+     * @param nL number of object in the left child voxel.
+     * @param nR number of object in the right child voxel.
+     *
+     * @returns SAH cost. */
+    FORCEINLINE float sahCostInner(float pL, float pR, int nL, int nR, bool favorEmptySpaceCutOff) {
+      float result = mParams.traversalCost + mParams.intersectionCost * (pL * nL + pR * nR);
+
+      /* Favor the splits which cut off empty space. */
+      if(favorEmptySpaceCutOff && (nL == 0 || nR == 0))
+        result *= 1 - mParams.emptySpaceBonus;
+
+      return result;
+    }
+
+    /** Estimates SAH cost for leaf node.
+     * 
+     * @param n number of object in this node.
+     * @returns SAH cost. */
+    FORCEINLINE float sahCostLeaf(int n) const {
+      return mParams.intersectionCost * static_cast<float>(n);
+    }
+
+    /** Decides whether a node should become a leaf.
+     *
+     * @param n number of objects in the node.
+     * @param bestCost SAH cost of the best split, or maximal float if there 
+     *   is no split.
+     * @param bestN numbers of objects in the children of the best split,
+     *   indexed by ObjectClass.
+     * @returns true if the node should become a leaf. */
+    FORCEINLINE bool sahTerminate(int n, float bestCost, const int* bestN) const {
+      if(bestCost == std::numeric_limits<float>::max())
+        return true;
+      if(sahCostLeaf(n) * mParams.terminationThreshold >= bestCost)
+        return false;
+
+      /* Split is forced by maxLeafSize. It must leave fewer objects in both
+       * children, otherwise objects that straddle every split plane would 
+       * be split on down to maxDepth. */
+      return n <= mParams.maxLeafSize || std::max(bestN[CLASS_L], bestN[CLASS_R]) >= n;
+    }
+
+    enum {
+      treeletPairCount = SMART_CACHELINE / sizeof(NodePair)
+    };
+
+    /** Header of the tree image, see saveImage. Padded to imageHeaderSize 
+     * bytes in the image. */
+    struct ImageHeader {
+      int size;              /**< Size of the image without header, in bytes. */
+      int rootOffset;        /**< Offset of the root node. */
+      int objectCount;       /**< Number of objects the tree was built upon. */
+      float boundingBox[6];  /**< Minimal and maximal corners of the bounding box. */
+    };
+
+    enum {
+      imageHeaderSize = SMART_CACHELINE
+    };
+
+    /** Counts nodes and leaf indices of this tree.
+     *
+     * @param packedSize set to the amount of memory taken by the data of 
+     *   packed leaves, see setLeafPacker, or zero if no packer is set. */
+    void countNodes(int& nodeCount, int& indexCount, int& packedSize) const {
+      nodeCount = 0;
+      indexCount = 0;
+      packedSize = 0;
+
+      arx::FastArray<const BspNode*> nodeStack;
+      nodeStack.push_back(mRoot);
+      while(nodeStack.size() > 0) {
+        const BspNode* node = nodeStack.back();
+        nodeStack.pop_back();
+        nodeCount++;
+
+        if(node->isDeferred()) {
+          continue;
+        } else if(node->isLeaf()) {
+          int size = node->getTriangleIndexList().size();
+          indexCount += size;
+          if(mLeafPacker != NULL && size != 0)
+            packedSize += mLeafPacker->getSize(size) + packedLeafAlignment;
+        } else {
+          nodeStack.push_back(node->getRightChild());
+          nodeStack.push_back(node->getLeftChild());
+        }
+      }
+    }
+
+    /** Copies this tree into the given arena, see relayout.
+     *
+     * @param pack whether non-empty leaves are to be packed with the leaf 
+     *   packer, see setLeafPacker.
+     * @returns the new root node. */
+    BspNode* relayoutTree(ArenaType& arena, bool pack) const {
+      /* Root is the right child of its pair, so we use a copy of that pair 
+       * with an empty leaf on the left as a source for the root treelet. */
+      NodePair rootPair;
+      new (&rootPair.child[CLASS_L]) BspNode(BspNode::LEAF(), 0, NULL);
+      rootPair.child[CLASS_R] = *mRoot;
+      return relayoutTreelet(arena, rootPair.child, mObjectCount <= 65536, pack) + CLASS_R;
+    }
+
+    /** Collects statistics for the subtree of the given node, see getStats.
+     *
+     * @returns SAH cost of the subtree, provided that its bounding box is hit. */
+    float collectStats(BspTreeStats& stats, const BspNode* node, const BoundingBox& boundingBox, int depth) const {
+      stats.nodeCount++;
+
+      if(node->isLeaf()) {
+        int size;
+        if(node->isDeferred()) {
+          size = static_cast<const LazySubtree*>(node->getDeferredSubtree())->objects.size();
+          stats.deferredLeafCount++;
+        } else
+          size = node->getTriangleIndexList().size();
+        stats.leafCount++;
+        stats.leafDepthSum += depth;
+        stats.maxDepth = std::max(stats.maxDepth, depth);
+        stats.maxLeafSize = std::max(stats.maxLeafSize, size);
+        stats.objectReferenceCount += size;
+        if(size == 0)
+          stats.emptyLeafCount++;
+        return sahCostLeaf(size);
+      }
+
+      /* Split planes kept by refit may lie outside of the node. */
+      int dim = node->getSplitDim();
+      float pos = std::max(boundingBox.getMin(dim), std::min(boundingBox.getMax(dim), node->getSplitCoord()));
+      Vector3f leftMax = boundingBox.getMax(), rightMin = boundingBox.getMin();
+      leftMax[dim] = pos;
+      rightMin[dim] = pos;
+      BoundingBox leftBox(boundingBox.getMin(), leftMax);
+      BoundingBox rightBox(rightMin, boundingBox.getMax());
+
+      float costL = collectStats(stats, node->getLeftChild(), leftBox, depth + 1);
+      float costR = collectStats(stats, node->getRightChild(), rightBox, depth + 1);
+
+      /* Probabilities are ratios of surface areas. Flat voxels have zero
+       * area, in which case we assume that both children are hit. */
+      float area = surfaceArea(boundingBox);
+      float pL = area > 0 ? surfaceArea(leftBox) / area : 1.0f;
+      float pR = area > 0 ? surfaceArea(rightBox) / area : 1.0f;
+      return mParams.traversalCost + pL * costL + pR * costR;
+    }
+
+    /** @returns surface area of the given bounding box. */
+    static float surfaceArea(const BoundingBox& boundingBox) {
+      Vector3f extent = boundingBox.getExtent();
+      return 2 * (extent[0] * extent[1] + extent[1] * extent[2] + extent[2] * extent[0]);
+    }
+
+    /** Adds the given delta to all the pointers stored in the subtree of the
+     * given node, see saveImage and loadImage.
+     *
+     * @param toOffsets true if the pointers are converted into offsets, 
+     *   false if offsets are converted into pointers. */
+    static void rebaseNodes(BspNode* root, intptr_t delta, bool toOffsets) {
+      arx::FastArray<BspNode*> nodeStack;
+      nodeStack.push_back(root);
+      while(nodeStack.size() > 0) {
+        BspNode* node = nodeStack.back();
+        nodeStack.pop_back();
+
+        if(!toOffsets)
+          node->rebase(delta);
+        if(!node->isLeaf()) {
+          nodeStack.push_back(const_cast<BspNode*>(node->getRightChild()));
+          nodeStack.push_back(const_cast<BspNode*>(node->getLeftChild()));
+        }
+        if(toOffsets)
+          node->rebase(delta);
+      }
+    }
+
+    /** Checks that the given image is a well-formed tree, so that it can be
+     * rebased and traversed safely, see loadImage. Each 4-byte word of the 
+     * image may belong to at most one node pair or index list, which rules
+     * out cycles and overlaps.
+     *
+     * @param begin pointer to the image, right past its header.
+     * @param size size of the image without header, in bytes. */
+    static bool checkImage(const unsigned char* begin, int size, int objectCount) {
+      std::vector<unsigned char> claimed((size + sizeof(int) - 1) / sizeof(int), 0);
+      if(!claimImageRange(claimed, size, 0, sizeof(NodePair)))
+        return false;
+
+      arx::FastArray<const BspNode*> nodeStack;
+      nodeStack.push_back(reinterpret_cast<const BspNode*>(begin) + CLASS_R);
+      while(nodeStack.size() > 0) {
+        const BspNode* node = nodeStack.back();
+        nodeStack.pop_back();
+
+        if(!node->isLeaf()) {
+          intptr_t offset = node->mAxisFlagPtr & BspNode::MASK_POINTER;
+          if((node->mAxisFlagPtr & BspNode::MASK_SPLIT_DIM) == BspNode::MASK_SPLIT_DIM ||
+             offset % sizeof(NodePair) != 0 || !claimImageRange(claimed, size, offset, sizeof(NodePair)))
+            return false;
+          nodeStack.push_back(reinterpret_cast<const BspNode*>(begin + offset) + CLASS_R);
+          nodeStack.push_back(reinterpret_cast<const BspNode*>(begin + offset) + CLASS_L);
+        } else if(node->mAxisFlagPtr & BspNode::MASK_INLINE) {
+          /* Deferred nodes never make it into images. */
+          if(node->mAxisFlagPtr != BspNode::MASK_INLINE || 
+             node->mTriangleIndex < 0 || node->mTriangleIndex >= objectCount)
+            return false;
+        } else if(node->mIndexListSize == 0) {
+          if(node->mAxisFlagPtr != 0)
+            return false;
+        } else if(node->mIndexListSize < 0) {
+          if(node->mIndexListSize < -static_cast<int>(size / sizeof(unsigned short)))
+            return false;
+          int count = -node->mIndexListSize;
+          if(!claimImageRange(claimed, size, node->mAxisFlagPtr, count * sizeof(unsigned short)))
+            return false;
+          const unsigned short* indices = reinterpret_cast<const unsigned short*>(begin + node->mAxisFlagPtr);
+          for(int i = 0; i < count; i++)
+            if(indices[i] >= objectCount)
+              return false;
+        } else {
+          if(node->mIndexListSize > static_cast<int>(size / sizeof(int)))
+            return false;
+          int count = node->mIndexListSize;
+          if(!claimImageRange(claimed, size, node->mAxisFlagPtr, count * sizeof(int)))
+            return false;
+          const int* indices = reinterpret_cast<const int*>(begin + node->mAxisFlagPtr);
+          for(int i = 0; i < count; i++)
+            if(indices[i] < 0 || indices[i] >= objectCount)
+              return false;
+        }
+      }
+      return true;
+    }
+
+    /** Marks the words of the given range of an image as used, see 
+     * checkImage.
+     *
+     * @returns false if the range is misaligned, lies outside of the image,
+     *   or overlaps a range marked before, true otherwise. */
+    static bool claimImageRange(std::vector<unsigned char>& claimed, int size, intptr_t offset, int bytes) {
+      if(offset < 0 || offset % sizeof(int) != 0 || offset > size - bytes)
+        return false;
+      int first = static_cast<int>(offset / sizeof(int));
+      int last = static_cast<int>((offset + bytes + sizeof(int) - 1) / sizeof(int));
+      for(int i = first; i < last; i++) {
+        if(claimed[i])
+          return false;
+        claimed[i] = 1;
+      }
+      return true;
+    }
+
+    /** Copies a treelet rooted at the given node pair and all the treelets 
+     * below it into the given arena, see relayout.
+     *
+     * @param pair left node of the source node pair.
+     * @param shortIndices whether to store leaf index lists as shorts.
+     * @returns left node of the copied node pair. */
+    BspNode* relayoutTreelet(ArenaType& arena, const BspNode* pair, bool shortIndices, bool pack) const {
+      /* Pick the pairs of this treelet in breadth-first order. */
+      const BspNode* pairs[treeletPairCount];
+      int pairCount = 1;
+      pairs[0] = pair;
+      for(int i = 0; i < pairCount && pairCount < treeletPairCount; i++)
+        for(int c = 0; c < 2 && pairCount < treeletPairCount; c++)
+          if(!pairs[i][c].isLeaf())
+            pairs[pairCount++] = pairs[i][c].getLeftChild();
+
+      NodePair* newPairs = reinterpret_cast<NodePair*>(
+        arena.allocate(pairCount * sizeof(NodePair), SMART_CACHELINE)
+      );
+
+      /* Inner nodes are visited in the same order as their children were
+       * picked, so the first pairCount - 1 of them point inside the treelet.
+       * The rest start new treelets. */
+      int nextPair = 1;
+      for(int i = 0; i < pairCount; i++) {
+        for(int c = 0; c < 2; c++) {
+          const BspNode* node = &pairs[i][c];
+          BspNode* newNode = &newPairs[i].child[c];
+          
+          if(node->isLeaf()) {
+            relayoutLeaf(arena, node, newNode, shortIndices, pack);
+          } else {
+            BspNode* children;
+            if(nextPair < pairCount) {
+              assert(pairs[nextPair] == node->getLeftChild());
+              children = newPairs[nextPair++].child;
+            } else
+              children = relayoutTreelet(arena, node->getLeftChild(), shortIndices, pack);
+            new (newNode) BspNode(BspNode::INNER(), node->getSplitDim(), node->getSplitCoord(), children);
+          }
+        }
+      }
+
+      return newPairs->child;
+    }
+
+    /** Copies the given leaf into the given arena, see relayout. */
+    void relayoutLeaf(ArenaType& arena, const BspNode* node, BspNode* newNode, bool shortIndices, bool pack) const {
+      if(node->isDeferred()) {
+        *newNode = *node;
+        return;
+      }
+
+      NodeTriangleIdList list = node->getTriangleIndexList();
+
+      if(list.size() == 0) {
+        new (newNode) BspNode(BspNode::LEAF(), 0, NULL);
+      } else if(pack) {
+        new (newNode) BspNode(BspNode::LEAF(), list.size(), packLeaf(arena, list));
+      } else if(list.size() == 1) {
+        new (newNode) BspNode(BspNode::INLINE_LEAF(), list[0]);
+      } else if(shortIndices) {
+        unsigned short* indexList = reinterpret_cast<unsigned short*>(
+          arena.allocate(list.size() * sizeof(unsigned short), sizeof(int))
+        );
+        for(int i = 0; i < list.size(); i++)
+          indexList[i] = static_cast<unsigned short>(list[i]);
+        new (newNode) BspNode(BspNode::SHORT_LEAF(), list.size(), indexList);
+      } else {
+        int* indexList = reinterpret_cast<int*>(arena.allocate<int>(list.size()));
+        for(int i = 0; i < list.size(); i++)
+          indexList[i] = list[i];
+        new (newNode) BspNode(BspNode::LEAF(), list.size(), indexList);
+      }
+    }
+
+    BspBuildParams mParams;
+
+    /** Arenas for nodes and index lists. Only one of them is in use, the
+     * other one is the target for relayout. */
+    ArenaType mArenas[2];
+
+    /** Index of the arena that is currently in use. */
+    int mArenaIndex;
+
+    /** Arenas of subtree tasks. */
+    arx::FastArray<ArenaType*> mTaskArenas;
+    arx::mutex mTaskArenasMutex;
+
+    /** Memory of the exact SAH workers that are not building anything at
+     * the moment, see acquireSahWorker. Guarded by mTaskArenasMutex. */
+    arx::FastArray<SahWorker> mSahWorkerPool;
+
+    /** Records of deferred subtrees, built or not. */
+    arx::FastArray<LazySubtree*> mLazySubtrees;
+
+    /** Builder for deferred subtrees, NULL for trees that are not lazy. */
+    AbstractLazyBuilder* mLazyBuilder;
+
+    /** Packer of non-empty leaves, NULL if leaves are not packed, see 
+     * setLeafPacker. */
+    AbstractLeafPacker* mLeafPacker;
+
+    BspNode* mRoot;
+
+    BoundingBox mBoundingBox;
+
+    /** Number of objects this tree was built upon. */
+    int mObjectCount;
+
+    /** Construction algorithm the tree was built with, never BSP_BUILD_AUTO. */
+    BspBuildMethod mBuildMethod;
+
+    /** Time spent in the last compile or refit, in seconds. */
+    double mBuildTime;
+
+    /** Scratch memory taken by the last compile, see BspTreeStats::scratchSize. */
+    int mScratchSize;
+
+    bool mCompiled;
+  };
+
+} // namespace smart
+
+#endif // __SMART_BSPTREE_H__
@@ -0,0 +1,585 @@
+#ifndef __SMART_BUNDLETRACER_H__
+#define __SMART_BUNDLETRACER_H__
+
+#include "common.h"
+#include <limits>
+#include "RayBundle.h"
+#include "Clipping.h"
+#include "TraceContext.h"
+#include "Tracer.h"
+#include "PacketTracer.h"
+
+#ifdef SMART_USE_SSE
+
+namespace smart {
+// -------------------------------------------------------------------------- //
+// BundleTracer
+// -------------------------------------------------------------------------- //
+  /** BundleTracer traces large bundles of coherent primary rays through the
+   * scene.
+   *
+   * BSP tree is traversed once for the whole bundle. Inner nodes are culled
+   * using interval arithmetic - the range of distances to the split plane is
+   * computed from the bounds of ray origins and reciprocal directions, and
+   * a child is skipped only if it cannot be reached by any ray of the bundle.
+   * In leaves, rays are intersected with triangles packet by packet, and the
+   * rays whose nearest hit lies inside the leaf's cell are terminated.
+   *
+   * The same traversal is used for the top-level scene tree, with leaves 
+   * tracing the bundle through their objects in object space. Small scenes
+   * are traced linearly, with objects sorted front to back.
+   *
+   * Incoherent bundles fall back to PacketTracer. */
+  class BundleTracer {
+  public:
+    /** Single element of a bundle traversal stack. */
+    struct StackElement {
+      const BspNode* node;
+      BoundingBox cell;
+      float segmentMin;
+      float segmentMax;
+    };
+
+    /** Computes distances along the rays of the given packet at which they
+     * enter and exit the given cell.
+     *
+     * @param entry (out) entry distances, not less than segmentMin.
+     * @param exitEps (out) exit distances, extended by epsilon. */
+    static FORCEINLINE void clipToCell(const RayPacket& packet, const BoundingBox& cell, const __m128& segmentMin, 
+                                       __m128& entry, __m128& exitEps) {
+      const __m128 eps = _mm_set1_ps(SMART_TRACEBSPNODE_SEGMENTCONTAINS_EPS);
+      __m128 exit = _mm_set1_ps(std::numeric_limits<float>::max());
+      entry = segmentMin;
+      for(int k = 0; k < 3; k++) {
+        const __m128 o = packet.getOrigin(k);
+        const __m128 inv = packet.getInvDirection(k);
+        const __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(cell.getMin(k)), o), inv);
+        const __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(cell.getMax(k)), o), inv);
+        entry = _mm_max_ps(entry, _mm_min_ps(t0, t1));
+        exit = _mm_min_ps(exit, _mm_max_ps(t0, t1));
+      }
+      exitEps = _mm_add_ps(exit, _mm_add_ps(eps, _mm_mul_ps(eps, detail::sseAbs(exit))));
+    }
+
+    /** Intersects live rays of the bundle with the triangles of the given
+     * leaf.
+     *
+     * @param liveMax (out) maximal segment end over all rays that are still
+     *   live after processing of this leaf.
+     * @returns true if there are no live rays left, false otherwise. */
+    static FORCEINLINE bool traceLeaf(const RayBundle& bundle, RayBundleState& s, const ShadedModel* model, const BspNode* node,
+                          const BoundingBox& cell, float& liveMax) {
+      NodeTriangleIdList list = node->getTriangleIndexList();
+      if(list.size() == 0)
+        return false;
+
+      __m128 maxSegmentMax = _mm_set1_ps(-std::numeric_limits<float>::max());
+      bool anyLive = false;
+
+      for(int p = 0; p < RayBundle::PACKET_COUNT; p++) {
+        if(s.liveMasks[p] == 0)
+          continue;
+
+        const RayPacket& packet = bundle.getPacket(p);
+        const __m128 segmentMin = _mm_load_ps(&s.segmentMin[p * RayPacket::SIZE]);
+        __m128 segmentMax = _mm_load_ps(&s.segmentMax[p * RayPacket::SIZE]);
+
+        /* Compute entry and exit distances of the rays into the leaf's cell. */
+        __m128 entry, exitEps;
+        clipToCell(packet, cell, segmentMin, entry, exitEps);
+
+        /* Only the rays which segments pass through the cell are tested. */
+        const int activeMask = s.liveMasks[p] &
+          _mm_movemask_ps(_mm_cmple_ps(entry, _mm_min_ps(exitEps, segmentMax)));
+
+        if(activeMask != 0) {
+          __m128 beta = _mm_load_ps(&s.beta[p * RayPacket::SIZE]);
+          __m128 gamma = _mm_load_ps(&s.gamma[p * RayPacket::SIZE]);
+
+          for(int i = 0; i < list.size(); ++i) {
+            int mask = intersect(packet, segmentMin, segmentMax, model->getTriAccel(list[i]),
+              beta, gamma, activeMask, SMART_TRACETRIACCEL_EPS);
+            if(mask != 0) {
+              for(int j = 0; j < RayPacket::SIZE; j++)
+                if(mask & (1 << j))
+                  s.triangleIds[p * RayPacket::SIZE + j] = list[i];
+              s.hitMasks[p] |= mask;
+            }
+          }
+
+          _mm_store_ps(&s.segmentMax[p * RayPacket::SIZE], segmentMax);
+          _mm_store_ps(&s.beta[p * RayPacket::SIZE], beta);
+          _mm_store_ps(&s.gamma[p * RayPacket::SIZE], gamma);
+
+          /* Cells are visited front to back, so rays with the nearest hit
+           * inside this cell are done. */
+          s.liveMasks[p] &= ~(activeMask & s.hitMasks[p] & _mm_movemask_ps(_mm_cmple_ps(segmentMax, exitEps)));
+        }
+
+        if(s.liveMasks[p] != 0) {
+          anyLive = true;
+          maxSegmentMax = _mm_max_ps(maxSegmentMax,
+            detail::sseSelect(detail::laneMask(s.liveMasks[p]), segmentMax, maxSegmentMax));
+        }
+      }
+
+      liveMax = detail::sseHorizontalMax(maxSegmentMax);
+      return !anyLive;
+    }
+
+    /** Leaf tracer for model BSP trees, see traceLeaf. */
+    class TriangleLeafTracer {
+    public:
+      FORCEINLINE TriangleLeafTracer(const RayBundle& bundle, RayBundleState& s, const ShadedModel* model):
+        mBundle(bundle), mState(s), mModel(model) {}
+
+      FORCEINLINE bool operator()(const BspNode* leaf, const BoundingBox& cell, float& liveMax) {
+        return traceLeaf(mBundle, mState, mModel, leaf, cell, liveMax);
+      }
+
+    private:
+      const RayBundle& mBundle;
+      RayBundleState& mState;
+      const ShadedModel* mModel;
+    };
+
+    /** Traces the given coherent ray bundle through the BSP tree of the given
+     * model. */
+    static void trace(const RayBundle& bundle, RayBundleState& s, const ShadedModel* model) {
+      TriangleLeafTracer leafTracer(bundle, s, model);
+      if(model->getBspTree().isLazy())
+        traverse<true>(bundle, s, model->getBspTree().getRoot(), model->getBoundingBox(), leafTracer);
+      else
+        traverse<false>(bundle, s, model->getBspTree().getRoot(), model->getBoundingBox(), leafTracer);
+    }
+
+    /** Traces the given coherent ray bundle through the given BSP tree, 
+     * visiting leaves front to back. Shared by model and scene level 
+     * traversals, see Tracer::traceBspNodes.
+     *
+     * @param lazy whether the tree may contain deferred nodes. Scene trees 
+     *   are never built lazily.
+     * @param cell bounding box of the tree.
+     * @param leafTracer functor that is called for each visited leaf as
+     *   <tt>bool leafTracer(const BspNode* leaf, const BoundingBox& cell, 
+     *   float& liveMax)</tt>. It must terminate the rays whose nearest hit 
+     *   lies inside the leaf's cell, store maximal segment end of the rays 
+     *   that are still live in liveMax, and return true if there are none. */
+    template<bool lazy, class LeafTracer>
+    static FORCEINLINE void traverse(const RayBundle& bundle, const RayBundleState& s, const BspNode* root, 
+                                     const BoundingBox& rootCell, LeafTracer& leafTracer) {
+      assert(bundle.isCoherent());
+
+      StackElement nodeStack[SMART_MAX_BSPTREE_DEPTH];
+      int nodeStackSize = 0;
+
+      const float eps = SMART_TRACEBSPNODE_SEGMENTCONTAINS_EPS;
+      const BspNode* node = root;
+      BoundingBox cell = rootCell;
+
+      /* Bundle-wide segment. */
+      float segmentMin = std::numeric_limits<float>::max();
+      float segmentMax = -std::numeric_limits<float>::max();
+      for(int i = 0; i < RayBundle::SIZE; i++) {
+        if(s.liveMasks[i / RayPacket::SIZE] & (1 << (i % RayPacket::SIZE))) {
+          segmentMin = std::min(segmentMin, s.segmentMin[i]);
+          segmentMax = std::max(segmentMax, s.segmentMax[i]);
+        }
+      }
+      float liveMax = segmentMax;
+
+      while(true) {
+        if(lazy && node->isDeferredAcquire()) {
+          BspTree::expand(node);
+          continue;
+        } else if(node->isLeaf()) {
+          if(leafTracer(node, cell, liveMax))
+            return;
+        } else {
+          const int dim = node->getSplitDim();
+          const float split = node->getSplitCoord();
+
+          /* Compute the range of distances to the splitting plane over all
+           * the rays of the bundle. Since reciprocal directions are of the
+           * same sign, extremes are reached at the corners. */
+          const float lo = split - bundle.getOriginMax(dim);
+          const float hi = split - bundle.getOriginMin(dim);
+          const float d0 = lo * bundle.getInvDirectionMin(dim);
+          const float d1 = lo * bundle.getInvDirectionMax(dim);
+          const float d2 = hi * bundle.getInvDirectionMin(dim);
+          const float d3 = hi * bundle.getInvDirectionMax(dim);
+          const float dNear = std::min(std::min(d0, d1), std::min(d2, d3));
+          const float dFar = std::max(std::max(d0, d1), std::max(d2, d3));
+
+          const int frontClass = bundle.getDirectionSign(dim);
+          const BspNode* frontChild = node->getLeftChild() + frontClass;
+          const BspNode* backChild = node->getLeftChild() + (1 - frontClass);
+          BoundingBox frontCell = cell;
+          BoundingBox backCell = cell;
+          if(frontClass == 0) {
+            frontCell.setMax(dim, split);
+            backCell.setMin(dim, split);
+          } else {
+            frontCell.setMin(dim, split);
+            backCell.setMax(dim, split);
+          }
+
+          if(segmentMax + eps + eps * abs(dNear) < dNear) {
+            /* Case one, all rays cull back side. */
+            node = frontChild;
+            cell = frontCell;
+          } else if(dFar < segmentMin - eps - eps * abs(dFar)) {
+            /* Case two, all rays cull front side. */
+            node = backChild;
+            cell = backCell;
+          } else {
+            /* Case three - traverse both sides in turn. */
+            assert(nodeStackSize < SMART_MAX_BSPTREE_DEPTH);
+            StackElement& top = nodeStack[nodeStackSize++];
+            top.node = backChild;
+            top.cell = backCell;
+            top.segmentMin = std::max(segmentMin, dNear);
+            top.segmentMax = segmentMax;
+
+            node = frontChild;
+            cell = frontCell;
+            segmentMax = std::min(segmentMax, dFar);
+          }
+          continue;
+        }
+
+        /* Pop the next node. Segment end is shrunk as the rays find their
+         * hits, so some of the nodes on the stack may be skipped. */
+        do {
+          if(nodeStackSize == 0)
+            return;
+          nodeStackSize--;
+          segmentMin = nodeStack[nodeStackSize].segmentMin;
+          segmentMax = std::min(nodeStack[nodeStackSize].segmentMax, liveMax);
+        } while(segmentMax + eps + eps * abs(segmentMax) < segmentMin);
+        node = nodeStack[nodeStackSize].node;
+        cell = nodeStack[nodeStackSize].cell;
+      }
+    }
+
+    /** Traces the given ray bundle through the given ShadedModel. Stores
+     * intersection data in the given trace contexts for rays that hit.
+     *
+     * @param masks lane masks of rays to trace, one per packet.
+     * @param hitMasks (out) lane masks of rays that hit something, one per
+     *   packet. */
+    static void trace(TraceContext* ctx, const RayBundle& bundle, const ShadedModel* model, const int* masks, int* hitMasks) {
+      RayBundleState s;
+
+      /* Clip ray segments to the model's bounding box. */
+      bool anyLive = false;
+      for(int p = 0; p < RayBundle::PACKET_COUNT; p++) {
+        s.liveMasks[p] = 0;
+        s.hitMasks[p] = 0;
+        for(int j = 0; j < RayPacket::SIZE; j++) {
+          int i = p * RayPacket::SIZE + j;
+          Segment segment = ctx[i].segment;
+          clip(segment, bundle.getPacket(p).getRay(j), model->getBoundingBox());
+          if((masks[p] & (1 << j)) && !segment.isEmpty<true, true>())
+            s.liveMasks[p] |= 1 << j;
+          s.segmentMin[i] = segment.getMin();
+          s.segmentMax[i] = segment.getMax();
+          s.beta[i] = 0;
+          s.gamma[i] = 0;
+        }
+        anyLive |= s.liveMasks[p] != 0;
+      }
+
+      if(anyLive)
+        trace(bundle, s, model);
+
+      for(int p = 0; p < RayBundle::PACKET_COUNT; p++) {
+        hitMasks[p] = s.hitMasks[p];
+        for(int j = 0; j < RayPacket::SIZE; j++) {
+          if(s.hitMasks[p] & (1 << j)) {
+            int i = p * RayPacket::SIZE + j;
+            ctx[i].segment.setMax(s.segmentMax[i]);
+            ctx[i].tAlongRay = s.segmentMax[i];
+            ctx[i].barycentricCoord = Vector3f(1 - (s.beta[i] + s.gamma[i]), s.beta[i], s.gamma[i]);
+            ctx[i].triangleId = s.triangleIds[i];
+            ctx[i].model = model;
+          }
+        }
+      }
+    }
+
+    /** Traces the rays of the given trace contexts through the given
+     * CoreObject. The bundle is transformed into the object's space, so 
+     * that it is culled against the object's BSP tree as a whole.
+     *
+     * @param masks lane masks of rays to trace, one per packet.
+     * @param hitMasks (out) lane masks of rays that hit something, one per
+     *   packet. */
+    static void trace(TraceContext* ctx, const CoreObject* object, const int* masks, int* hitMasks) {
+      RayBundle bundle;
+      for(int i = 0; i < RayBundle::SIZE; i++) {
+        const Ray& ray = ctx[i].ray;
+        bundle.setRay(i, object->transformPointToLocal(ray.getOrigin()), object->transformDirectionToLocal(ray.getDirection()));
+      }
+      bundle.updateBounds();
+
+      if(bundle.isCoherent()) {
+        trace(ctx, bundle, object->getModel(), masks, hitMasks);
+        for(int i = 0; i < RayBundle::SIZE; i++)
+          if(hitMasks[i / RayPacket::SIZE] & (1 << (i % RayPacket::SIZE)))
+            ctx[i].object = object;
+      } else {
+        /* Directions disagree in sign, fall back to packets. */
+        for(int p = 0; p < RayBundle::PACKET_COUNT; p++)
+          hitMasks[p] = masks[p] == 0 ? 0 : PacketTracer::trace(ctx + p * RayPacket::SIZE, object, masks[p]);
+      }
+    }
+
+    /** Traces the rays of the given trace contexts through the scene objects
+     * with the given indices. Works like PacketTracer::traceObjects, with
+     * objects culled by their world space bounding boxes for each ray, and
+     * traced in order of their nearest entry distance over the bundle.
+     *
+     * @param masks lane masks of rays to trace, one per packet.
+     * @param hitMasks (in/out) lane masks of rays that hit something, one 
+     *   per packet. Rays that hit get their bits set. */
+    template<class IndexArray>
+    static void traceObjects(TraceContext* ctx, const IndexArray& indices, const int* masks, int* hitMasks) {
+      const ShadedScene* scene = ctx[0].scene;
+      const bool sorted = indices.size() <= SMART_TOPLEVEL_LINEAR_OBJECT_COUNT;
+
+      /* Culled objects, entries are indexed by slot. */
+      Tracer::ObjectEntry entries[SMART_TOPLEVEL_LINEAR_OBJECT_COUNT];
+      int objectIndices[SMART_TOPLEVEL_LINEAR_OBJECT_COUNT];
+      int objectMasks[SMART_TOPLEVEL_LINEAR_OBJECT_COUNT][RayBundle::PACKET_COUNT];
+      int entryCount = 0;
+
+      int culledMasks[RayBundle::PACKET_COUNT];
+      int objectHitMasks[RayBundle::PACKET_COUNT];
+      for(int i = 0; i < indices.size(); ++i) {
+        const CoreObject* object = scene->getObject(indices[i]);
+
+        /* Cull the object for each ray. */
+        float distance = std::numeric_limits<float>::max();
+        bool any = false;
+        for(int p = 0; p < RayBundle::PACKET_COUNT; p++) {
+          culledMasks[p] = 0;
+          for(int j = 0; j < RayPacket::SIZE; j++) {
+            if(!(masks[p] & (1 << j)))
+              continue;
+
+            Segment segment = ctx[p * RayPacket::SIZE + j].segment;
+            clip(segment, ctx[p * RayPacket::SIZE + j].ray, object->getBoundingBox());
+            if(!segment.isEmpty<true, true>()) {
+              culledMasks[p] |= 1 << j;
+              distance = std::min(distance, segment.getMin());
+            }
+          }
+          any |= culledMasks[p] != 0;
+        }
+        if(!any)
+          continue;
+
+        if(sorted) {
+          int slot = entryCount++;
+          objectIndices[slot] = indices[i];
+          for(int p = 0; p < RayBundle::PACKET_COUNT; p++)
+            objectMasks[slot][p] = culledMasks[p];
+
+          /* Insertion sort, lists are short. */
+          int k = slot;
+          for(; k > 0 && distance < entries[k - 1].distance; k--)
+            entries[k] = entries[k - 1];
+          entries[k] = Tracer::ObjectEntry(distance, slot);
+        } else {
+          trace(ctx, object, culledMasks, objectHitMasks);
+          for(int p = 0; p < RayBundle::PACKET_COUNT; p++)
+            hitMasks[p] |= objectHitMasks[p];
+        }
+      }
+
+      for(int i = 0; i < entryCount; ++i) {
+        int slot = entries[i].index;
+
+        /* Everything else starts beyond the nearest hits. */
+        float farthest = -std::numeric_limits<float>::max();
+        for(int p = 0; p < RayBundle::PACKET_COUNT; p++)
+          for(int j = 0; j < RayPacket::SIZE; j++)
+            if(objectMasks[slot][p] & (1 << j))
+              farthest = std::max(farthest, ctx[p * RayPacket::SIZE + j].segment.getMax());
+        if(entries[i].distance > farthest)
+          continue;
+
+        trace(ctx, scene->getObject(objectIndices[slot]), objectMasks[slot], objectHitMasks);
+        for(int p = 0; p < RayBundle::PACKET_COUNT; p++)
+          hitMasks[p] |= objectHitMasks[p];
+      }
+    }
+
+    /** Leaf tracer for the top-level scene BSP tree, traces the live rays 
+     * that pass through the leaf's cell through all the objects of the 
+     * leaf. Hit data is stored in the trace contexts, the state only tracks
+     * ray segments and masks. */
+    class ObjectLeafTracer {
+    public:
+      ObjectLeafTracer(TraceContext* ctx, const RayBundle& bundle, RayBundleState& s): 
+        mCtx(ctx), mBundle(bundle), mState(s) {}
+
+      bool operator()(const BspNode* leaf, const BoundingBox& cell, float& liveMax) {
+        RayBundleState& s = mState;
+        NodeTriangleIdList list = leaf->getTriangleIndexList();
+
+        int activeMasks[RayBundle::PACKET_COUNT];
+        bool anyActive = false;
+        for(int p = 0; p < RayBundle::PACKET_COUNT; p++) {
+          activeMasks[p] = 0;
+          if(s.liveMasks[p] == 0 || list.size() == 0)
+            continue;
+
+          const __m128 segmentMin = _mm_load_ps(&s.segmentMin[p * RayPacket::SIZE]);
+          const __m128 segmentMax = _mm_load_ps(&s.segmentMax[p * RayPacket::SIZE]);
+          __m128 entry;
+          ALIGN(16) float exitEps[RayPacket::SIZE];
+          __m128 exitEpsPs;
+          clipToCell(mBundle.getPacket(p), cell, segmentMin, entry, exitEpsPs);
+          _mm_store_ps(exitEps, exitEpsPs);
+
+          /* Limit segments to the current cell, so that the nearest hit 
+           * found here is the nearest one overall. */
+          activeMasks[p] = s.liveMasks[p] & _mm_movemask_ps(_mm_cmple_ps(entry, _mm_min_ps(exitEpsPs, segmentMax)));
+          for(int j = 0; j < RayPacket::SIZE; j++) {
+            int i = p * RayPacket::SIZE + j;
+            if(activeMasks[p] & (1 << j))
+              mCtx[i].segment = Segment(s.segmentMin[i], std::min(s.segmentMax[i], exitEps[j]));
+          }
+          anyActive |= activeMasks[p] != 0;
+        }
+
+        if(anyActive) {
+          int leafHitMasks[RayBundle::PACKET_COUNT] = {0};
+          traceObjects(mCtx, list, activeMasks, leafHitMasks);
+          for(int p = 0; p < RayBundle::PACKET_COUNT; p++) {
+            for(int j = 0; j < RayPacket::SIZE; j++)
+              if(leafHitMasks[p] & (1 << j))
+                s.segmentMax[p * RayPacket::SIZE + j] = mCtx[p * RayPacket::SIZE + j].segment.getMax();
+            s.hitMasks[p] |= leafHitMasks[p];
+            s.liveMasks[p] &= ~leafHitMasks[p];
+          }
+        }
+
+        bool anyLive = false;
+        liveMax = -std::numeric_limits<float>::max();
+        for(int i = 0; i < RayBundle::SIZE; i++) {
+          if(s.liveMasks[i / RayPacket::SIZE] & (1 << (i % RayPacket::SIZE))) {
+            anyLive = true;
+            liveMax = std::max(liveMax, s.segmentMax[i]);
+          }
+        }
+        return !anyLive;
+      }
+
+    private:
+      TraceContext* mCtx;
+      const RayBundle& mBundle;
+      RayBundleState& mState;
+    };
+
+    /** Traces the rays of the given trace contexts through the scene. Small
+     * scenes are traced linearly, bigger ones - with the top-level BSP tree,
+     * which is culled for the whole bundle the same way model trees are.
+     * Either way, each object is traced as a bundle. Clips segments of the 
+     * rays that hit something.
+     *
+     * @param hitMasks (out) lane masks of rays that hit something, one per
+     *   packet. */
+    static void traceScene(TraceContext* ctx, int* hitMasks) {
+      const ShadedScene* scene = ctx[0].scene;
+      for(int p = 0; p < RayBundle::PACKET_COUNT; p++)
+        hitMasks[p] = 0;
+      if(scene->getObjectCount() == 0)
+        return;
+
+      RayBundle bundle;
+      for(int i = 0; i < RayBundle::SIZE; i++)
+        bundle.setRay(i, ctx[i].ray.getOrigin(), ctx[i].ray.getDirection());
+      bundle.updateBounds();
+
+      const bool linear = scene->getObjectCount() <= SMART_TOPLEVEL_LINEAR_OBJECT_COUNT;
+      if(!linear && !bundle.isCoherent()) {
+        /* Directions disagree in sign, fall back to packets. */
+        for(int p = 0; p < RayBundle::PACKET_COUNT; p++)
+          hitMasks[p] = PacketTracer::traceScene(ctx + p * RayPacket::SIZE);
+        return;
+      }
+
+      /* Clip ray segments to the scene's bounding box. */
+      RayBundleState s;
+      Segment oldSegments[RayBundle::SIZE];
+      bool anyLive = false;
+      for(int p = 0; p < RayBundle::PACKET_COUNT; p++) {
+        s.liveMasks[p] = 0;
+        s.hitMasks[p] = 0;
+        for(int j = 0; j < RayPacket::SIZE; j++) {
+          int i = p * RayPacket::SIZE + j;
+          oldSegments[i] = ctx[i].segment;
+          Segment segment = ctx[i].segment;
+          clip(segment, ctx[i].ray, scene->getBoundingBox());
+          if(!segment.isEmpty<true, true>())
+            s.liveMasks[p] |= 1 << j;
+          s.segmentMin[i] = segment.getMin();
+          s.segmentMax[i] = segment.getMax();
+        }
+        anyLive |= s.liveMasks[p] != 0;
+      }
+      if(!anyLive)
+        return;
+
+      if(linear) {
+        for(int i = 0; i < RayBundle::SIZE; i++)
+          if(s.liveMasks[i / RayPacket::SIZE] & (1 << (i % RayPacket::SIZE)))
+            ctx[i].segment = Segment(s.segmentMin[i], s.segmentMax[i]);
+        traceObjects(ctx, FakeArray<int>(scene->getObjectCount()), s.liveMasks, hitMasks);
+      } else {
+        ObjectLeafTracer leafTracer(ctx, bundle, s);
+        traverse<false>(bundle, s, scene->getBspTree().getRoot(), scene->getBoundingBox(), leafTracer);
+        for(int p = 0; p < RayBundle::PACKET_COUNT; p++)
+          hitMasks[p] = s.hitMasks[p];
+      }
+
+      /* Segments were limited to the scene bounding box and traversal 
+       * cells. */
+      for(int i = 0; i < RayBundle::SIZE; i++) {
+        if(hitMasks[i / RayPacket::SIZE] & (1 << (i % RayPacket::SIZE)))
+          ctx[i].segment.setMin(oldSegments[i].getMin());
+        else
+          ctx[i].segment = oldSegments[i];
+      }
+    }
+
+    /** Top-level bundle tracing routine. Traces primary rays stored in the
+     * given trace contexts through the scene and shades them.
+     *
+     * @param ctx array of RayBundle::SIZE trace contexts, with scene, depth
+     *   and ray set. Rays are grouped into packets as described by
+     *   RayBundle::getRayX and RayBundle::getRayY. */
+    static void trace(TraceContext* ctx) {
+      const ShadedScene* scene = ctx[0].scene;
+      for(int i = 0; i < RayBundle::SIZE; i++) {
+        assert(ctx[i].scene == scene && ctx[i].depth == 0);
+        assert(abs(ctx[i].ray.getDirection().squaredNorm() - 1.0f) < 1.0e-5);
+        ctx[i].segment = Segment(SMART_TRACEUPPER_SEGMENTSTART_EPS, std::numeric_limits<float>::max());
+      }
+
+      int hitMasks[RayBundle::PACKET_COUNT];
+      traceScene(ctx, hitMasks);
+
+      for(int i = 0; i < RayBundle::SIZE; i++)
+        Tracer::shade(ctx[i], (hitMasks[i / RayPacket::SIZE] & (1 << (i % RayPacket::SIZE))) != 0);
+    }
+  };
+
+} // namespace smart
+
+#endif // SMART_USE_SSE
+
+#endif // __SMART_BUNDLETRACER_H__
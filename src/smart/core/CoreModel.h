@@ -1,302 +1,569 @@
-#ifndef __SMART_COREMODEL_H__
-#define __SMART_COREMODEL_H__
-
-#include "common.h"
-#include <cmath>
-#include <assert.h>
-#include <arx/Collections.h>
-#include <arx/Utility.h>
-#include <arx/static_assert.h>
-#include "ExplicitlyCounted.h"
-#include "BspTree.h"
-#include "TriAccel.h"
-#include "ShaderClass.h"
-#include "MemoryArena.h"
-#include "Utility.h"
-#include "Clipping.h"
-#include "ShaderManager.h"
-#include "Idded.h"
-
-namespace smart {
-// -------------------------------------------------------------------------- //
-// CoreModel
-// -------------------------------------------------------------------------- //
-  /** CoreModel represents a compiled 3d model - including vertex information,
-   * triangle acceleration structures, and BSP tree. 
-   *
-   * Note that it is recommended to distinguish static and dynamic models.
-   * Static models do not change from frame to frame. Such models are 
-   * normally constructed before the start of rendering cycle, therefore 
-   * it's profitable to use sophisticated algorithms for compilation to 
-   * speed up rendering.
-   * Dynamic models change from frame to frame, and therefore they need 
-   * to be recompiled quite often, so that only fast compilation algorithms 
-   * can be used.
-   */
-  class CoreModel: private arx::noncopyable, private ExplicitlyCounted<CoreModel>, public Idded {
-  private:
-    class TriangleAdapter;
-
-  public:
-    typedef TriangleAdapter TriangleType;
-
-    /** @returns BSP tree built for this model. */
-    const BspTree& getBspTree() const {
-      assert(mCompiled);
-      return mBspTree;
-    }
-
-    /** @returns bounding box of this model. */
-    const BoundingBox& getBoundingBox() const {
-      assert(mCompiled);
-      return mBspTree.getBoundingBox();
-    }
-
-    /** @return the number of triangles in this model. */
-    const int getTriangleCount() const {
-      return mTriangleData.size();
-    }
-
-    /** @returns TriAccel structure for the triangle with the given id. */
-    const TriAccel& getTriAccel(int id) const {
-      assert(mCompiled);
-      return mTriAccels[id];
-    }
-
-    /** @returns the triangle with the given id. */
-    const TriangleType getTriangle(int id) const {
-      return TriangleType(*this, id);
-    }
-
-    bool hasVertex(int id) const {
-      return 0 <= id && id < mVertexData.size();
-    }
-
-    bool hasTriangle(int id) const {
-      return 0 <= id && id <= mTriangleData.size();
-    }
-
-    const Vector3f& getCoord(int vertexId) const {
-      return mVertexData[vertexId].mCoord;
-    }
-
-    const Vector3f& getNormal(int vertexId) const {
-      return mVertexData[vertexId].mNormal;
-    }
-
-    const Vector3f& getTexCoord(int vertexId) const {
-      return mVertexData[vertexId].mTexCoord;
-    }
-
-    const Vector3f& getCoord(int triangleId, int n) const {
-      return getCoord(mTriangleData[triangleId].mVertexId[n]);
-    }
-
-    const Vector3f& getNormal(int triangleId, int n) const {
-      return getNormal(mTriangleData[triangleId].mVertexId[n]);
-    }
-
-    const Vector3f& getTexCoord(int triangleId, int n) const {
-      return getTexCoord(mTriangleData[triangleId].mVertexId[n]);
-    }
-
-    /** Creates a new storage for Triangle shader parameters for the shader with
-     * the given identifier. */
-    void* newShaderTriangleParam(SurfaceShaderClass* shaderClass) {
-      return static_cast<void*>(
-        mShadingParamArena.allocate(shaderClass->getTriangleParamSize(), shaderClass->getTriangleParamAlign())
-      );
-    }
-
-    /** Creates a new storage for Attribute shader parameters for the shader 
-     * with the given identifier. */
-    void* newShaderAttribParam(SurfaceShaderClass* shaderClass) {
-      return static_cast<void*>(
-        mShadingParamArena.allocate(shaderClass->getAttribParamSize(), shaderClass->getAttribParamAlign())
-      );
-    }
-
-    /** Adds a new triangle to triangle buffer. It is guaranteed that 
-     * succeeding calls to newTriangle will return succeeding integer 
-     * identifiers.
-     * 
-     * @param vertexId0 identifier of the first vertex.
-     * @param vertexId1 identifier of the second vertex.
-     * @param vertexId2 identifier of the third vertex.
-     * @param shaderId identifier of a shader to use.
-     * @param shadingParam pointer to a location of Triangle shading parameter. 
-     *        Use NULL for none.
-     * @returns identifier of a newly created triangle. */
-    int newTriangle(int vertexId0, int vertexId1, int vertexId2, void* shadingParam) {
-      assert(!mCompiled);
-      assert(vertexId0 != vertexId1 && vertexId1 != vertexId2 && vertexId2 != vertexId0);
-      assert(hasVertex(vertexId0) && hasVertex(vertexId1) && hasVertex(vertexId2));
-      assert((getCoord(vertexId0) - getCoord(vertexId1)).squaredNorm() >= SMART_NOT_A_TRIANGLE_EPS &&
-             (getCoord(vertexId1) - getCoord(vertexId2)).squaredNorm() >= SMART_NOT_A_TRIANGLE_EPS &&
-             (getCoord(vertexId2) - getCoord(vertexId0)).squaredNorm() >= SMART_NOT_A_TRIANGLE_EPS);
-
-      TriangleData triangle;
-      triangle.mVertexId[0] = vertexId0;
-      triangle.mVertexId[1] = vertexId1;
-      triangle.mVertexId[2] = vertexId2;
-      triangle.mShadingParam = shadingParam;
-
-      if(mTriangleData.capacity() == mTriangleData.size())
-        mTriangleData.reserve(mTriangleData.capacity() * 2 + 16);
-      mTriangleData.push_back(triangle);
-
-      return mTriangleData.size() - 1;
-    }
-
-    /** Adds a new vertex to vertex buffer. It is guaranteed that succeeding 
-     * calls to newVertex will return succeeding integer identifiers.
-     *
-     * @param coord vertex coordinates.
-     * @param normal normalized vertex normal.
-     * @param texCoord texture coordinates.
-     * @param shadingParam pointer to a location of Attrib shading parameter. 
-     *        Use NULL for none.
-     * @returns identifier of a newly added vertex. */
-    int newVertex(const Vector3f& coord, const Vector3f& normal, const Vector3f& texCoord, void* shadingParam) {
-      assert(!mCompiled);
-
-      VertexData vertex;
-      vertex.mCoord = coord;
-      vertex.mNormal = normal;
-      vertex.mTexCoord = texCoord;
-      vertex.mShadingParam = shadingParam;
-      
-      if(mVertexData.capacity() == mVertexData.size())
-        mVertexData.reserve(mVertexData.capacity() * 2 + 16);
-      mVertexData.push_back(vertex);
-
-      return mVertexData.size() - 1;
-    }
-
-    /** Compiles a model - builds ray-triangle intersection test acceleration
-     * structures and a BSP tree. */
-    void compile() {
-      if(mCompiled)
-        return;
-      
-      /* Create TriAccel structures first. */
-      mTriAccels.reserve(getTriangleCount());
-      for(int i = 0; i < getTriangleCount(); ++i)
-        mTriAccels.push_back(TriAccel(getTriangle(i)));
-
-      /* Build BspTree. */
-      mBspTree.compile(FakeArray<int>(getTriangleCount()), TriangleClipper(*this));
-
-      /* We're done. */
-      mCompiled = true;
-    }
-
-    bool isCompiled() const {
-      return mCompiled;
-    }
-
-  private:
-    class TriangleClipper {
-    public:
-      TriangleClipper(const CoreModel& coreModel): mCoreModel(&coreModel) {}
-
-      BoundingBox operator()(int i, const BoundingBox& boundingBox) const {
-        BoundingBox result;
-        clip(mCoreModel->getTriangle(i), mCoreModel->mTriAccels[i], boundingBox, result);
-        return result;
-      }
-
-      BoundingBox operator()(int i) const {
-        return triangleBoundingBox(mCoreModel->getTriangle(i));
-      }
-    private:
-      const CoreModel* mCoreModel;
-    };
-
-    /** TriangleData structure stores data associated with a triangle. */
-    struct TriangleData {
-      int mVertexId[3];
-      void* mShadingParam;
-    };
-
-    /** VertexData structure stores data associated with a vertex. */
-    struct VertexData {
-      Vector3f mCoord;
-      Vector3f mNormal;
-      Vector3f mTexCoord;
-      void* mShadingParam;
-    };
-
-    /** TriangleAdapter class represents a reference to one of the triangles in a model. */
-    class TriangleAdapter {
-    public:
-      TriangleAdapter(const CoreModel& model, int index):
-        mModel(model), mIndex(index) {}
-
-      const Vector3f& operator[](int vertexIndex) const {
-        assert(vertexIndex >= 0 && vertexIndex < 3);
-        return mModel.mVertexData[mModel.mTriangleData[mIndex].mVertexId[vertexIndex]].mCoord;
-      }
-
-    private:
-      const CoreModel& mModel;
-      int mIndex;
-    };
-
-    friend class SmartCore;
-    friend class ShadedModel;
-    friend class TriangleClipper;
-
-    /** Constructor. 
-     *
-     * @param id identifier of this model. */
-    CoreModel() {
-      initialize(16, 48);
-    }
-
-    /** Constructor. Allocates triangle and vertex buffers.
-     * 
-     * @param id identifier of this model.
-     * @param triangleCapacity initial triangle capacity of this model.
-     * @param vertexCapacity initial vertex capacity of this model. */
-    CoreModel(int triangleCapacity, int vertexCapacity) {
-      initialize(triangleCapacity, vertexCapacity);
-    }
-
-    /** Initializer. Called from constructors. */
-    void initialize(int triangleCapacity, int vertexCapacity) {
-      ExplicitlyCounted::initialize(this);
-      mTriangleData.reserve(triangleCapacity);
-      mVertexData.reserve(vertexCapacity);
-      mCompiled = false;
-      mShadingParamArena.setNextBlockCapacity(1024);
-    }
-
-    /** Array of TriAccel structures - one structure instance per triangle. 
-     * Created on compilation. Note that this is the only data accessed
-     * during triangle intersection tests. */
-    arx::FastArray<TriAccel> mTriAccels;
-
-    /** Array of TriangleData structures, describing triangles. 
-     * Stays intact after compilation. */
-    arx::FastArray<TriangleData> mTriangleData;
-
-    /** Array of VertexData structures, describing vertices.
-     * Stays intact after compilation. */
-    arx::FastArray<VertexData> mVertexData;
-
-    /** Storage for shading parameters, which are set per triangle and per vertex. */
-    MemoryArena<> mShadingParamArena;
-
-    /** Binary Space Subdivision tree for triangle data. 
-     * Created on compilation. */
-    BspTree mBspTree;
-
-    /** Is this CoreModel compiled? */
-    bool mCompiled;
-  };
-
-
-} // namespace smart
-
-#endif // __SMART_COREMODEL_H__
+#ifndef __SMART_COREMODEL_H__
+#define __SMART_COREMODEL_H__
+
+#include "common.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <assert.h>
+#include <string>
+#include <fstream>
+#include <arx/Collections.h>
+#include <arx/Utility.h>
+#include <arx/static_assert.h>
+#include "ExplicitlyCounted.h"
+#include "BspTree.h"
+#include "TriAccel.h"
+#include "TriAccel4.h"
+#include "ShaderClass.h"
+#include "MemoryArena.h"
+#include "Utility.h"
+#include "Clipping.h"
+#include "ShaderManager.h"
+#include "Idded.h"
+#include "MappedFile.h"
+
+namespace smart {
+// -------------------------------------------------------------------------- //
+// CoreModel
+// -------------------------------------------------------------------------- //
+  /** CoreModel represents a compiled 3d model - including vertex information,
+   * triangle acceleration structures, and BSP tree. 
+   *
+   * Note that it is recommended to distinguish static and dynamic models.
+   * Static models do not change from frame to frame. Such models are 
+   * normally constructed before the start of rendering cycle, therefore 
+   * it's profitable to use sophisticated algorithms for compilation to 
+   * speed up rendering.
+   * Dynamic models change from frame to frame, and therefore they need 
+   * to be recompiled quite often, so that only fast compilation algorithms 
+   * can be used.
+   */
+  class CoreModel: private arx::noncopyable, private ExplicitlyCounted<CoreModel>, public Idded {
+  private:
+    class TriangleAdapter;
+
+  public:
+    typedef TriangleAdapter TriangleType;
+
+    /** @returns BSP tree built for this model. */
+    const BspTree& getBspTree() const {
+      assert(mCompiled);
+      return mBspTree;
+    }
+
+    /** @returns statistics of the BSP tree built for this model. */
+    BspTreeStats getStats() const {
+      assert(mCompiled);
+      return mBspTree.getStats();
+    }
+
+    /** @returns bounding box of this model. */
+    const BoundingBox& getBoundingBox() const {
+      assert(mCompiled);
+      return mBspTree.getBoundingBox();
+    }
+
+    /** @return the number of triangles in this model. */
+    const int getTriangleCount() const {
+      return mTriangleData.size();
+    }
+
+    /** @returns TriAccel structure for the triangle with the given id. */
+    const TriAccel& getTriAccel(int id) const {
+      assert(mCompiled);
+      return mTriAccels[id];
+    }
+
+#ifdef SMART_USE_TRIACCEL4
+    /** @returns pointer to the first TriAccel4 block for the given triangle 
+     * index list of a leaf of this model's BSP tree. Blocks store triangles 
+     * in the same order as the index list does. */
+    const TriAccel4* getTriAccel4s(const NodeTriangleIdList& list) const {
+      assert(mCompiled);
+
+      /* Blocks are stored right before the index list. */
+      return reinterpret_cast<const TriAccel4*>(list.getIndices()) - TriAccel4::getBlockCount(list.size());
+    }
+#endif
+
+    /** @returns the triangle with the given id. */
+    const TriangleType getTriangle(int id) const {
+      return TriangleType(*this, id);
+    }
+
+    bool hasVertex(int id) const {
+      return 0 <= id && id < mVertexData.size();
+    }
+
+    bool hasTriangle(int id) const {
+      return 0 <= id && id <= mTriangleData.size();
+    }
+
+    const Vector3f& getCoord(int vertexId) const {
+      return mVertexData[vertexId].mCoord;
+    }
+
+    const Vector3f& getNormal(int vertexId) const {
+      return mVertexData[vertexId].mNormal;
+    }
+
+    const Vector3f& getTexCoord(int vertexId) const {
+      return mVertexData[vertexId].mTexCoord;
+    }
+
+    const Vector3f& getCoord(int triangleId, int n) const {
+      return getCoord(mTriangleData[triangleId].mVertexId[n]);
+    }
+
+    const Vector3f& getNormal(int triangleId, int n) const {
+      return getNormal(mTriangleData[triangleId].mVertexId[n]);
+    }
+
+    const Vector3f& getTexCoord(int triangleId, int n) const {
+      return getTexCoord(mTriangleData[triangleId].mVertexId[n]);
+    }
+
+    /** Creates a new storage for Triangle shader parameters for the shader with
+     * the given identifier. */
+    void* newShaderTriangleParam(SurfaceShaderClass* shaderClass) {
+      return static_cast<void*>(
+        mShadingParamArena.allocate(shaderClass->getTriangleParamSize(), shaderClass->getTriangleParamAlign())
+      );
+    }
+
+    /** Creates a new storage for Attribute shader parameters for the shader 
+     * with the given identifier. */
+    void* newShaderAttribParam(SurfaceShaderClass* shaderClass) {
+      return static_cast<void*>(
+        mShadingParamArena.allocate(shaderClass->getAttribParamSize(), shaderClass->getAttribParamAlign())
+      );
+    }
+
+    /** Adds a new triangle to triangle buffer. It is guaranteed that 
+     * succeeding calls to newTriangle will return succeeding integer 
+     * identifiers.
+     * 
+     * @param vertexId0 identifier of the first vertex.
+     * @param vertexId1 identifier of the second vertex.
+     * @param vertexId2 identifier of the third vertex.
+     * @param shaderId identifier of a shader to use.
+     * @param shadingParam pointer to a location of Triangle shading parameter. 
+     *        Use NULL for none.
+     * @returns identifier of a newly created triangle. */
+    int newTriangle(int vertexId0, int vertexId1, int vertexId2, void* shadingParam) {
+      assert(!mCompiled);
+      assert(vertexId0 != vertexId1 && vertexId1 != vertexId2 && vertexId2 != vertexId0);
+      assert(hasVertex(vertexId0) && hasVertex(vertexId1) && hasVertex(vertexId2));
+      assert((getCoord(vertexId0) - getCoord(vertexId1)).squaredNorm() >= SMART_NOT_A_TRIANGLE_EPS &&
+             (getCoord(vertexId1) - getCoord(vertexId2)).squaredNorm() >= SMART_NOT_A_TRIANGLE_EPS &&
+             (getCoord(vertexId2) - getCoord(vertexId0)).squaredNorm() >= SMART_NOT_A_TRIANGLE_EPS);
+
+      TriangleData triangle;
+      triangle.mVertexId[0] = vertexId0;
+      triangle.mVertexId[1] = vertexId1;
+      triangle.mVertexId[2] = vertexId2;
+      triangle.mShadingParam = shadingParam;
+
+      if(mTriangleData.capacity() == mTriangleData.size())
+        mTriangleData.reserve(mTriangleData.capacity() * 2 + 16);
+      mTriangleData.push_back(triangle);
+
+      return mTriangleData.size() - 1;
+    }
+
+    /** Adds a new vertex to vertex buffer. It is guaranteed that succeeding 
+     * calls to newVertex will return succeeding integer identifiers.
+     *
+     * @param coord vertex coordinates.
+     * @param normal normalized vertex normal.
+     * @param texCoord texture coordinates.
+     * @param shadingParam pointer to a location of Attrib shading parameter. 
+     *        Use NULL for none.
+     * @returns identifier of a newly added vertex. */
+    int newVertex(const Vector3f& coord, const Vector3f& normal, const Vector3f& texCoord, void* shadingParam) {
+      assert(!mCompiled);
+
+      VertexData vertex;
+      vertex.mCoord = coord;
+      vertex.mNormal = normal;
+      vertex.mTexCoord = texCoord;
+      vertex.mShadingParam = shadingParam;
+      
+      if(mVertexData.capacity() == mVertexData.size())
+        mVertexData.reserve(mVertexData.capacity() * 2 + 16);
+      mVertexData.push_back(vertex);
+
+      return mVertexData.size() - 1;
+    }
+
+    /** Sets BSP tree construction parameters for this model, including the 
+     * build method, which is BSP_BUILD_AUTO by default. Must be called 
+     * before compile. Parameters are also used
+     * when the model is refitted. */
+    void setBuildParams(const BspBuildParams& params) {
+      assert(!mCompiled);
+      mBspTree.setBuildParams(params);
+    }
+
+    const BspBuildParams& getBuildParams() const {
+      return mBspTree.getBuildParams();
+    }
+
+    /** Sets path to the cache file for compiled structures of this model. If
+     * set, compile loads TriAccels and BSP tree from this file, provided that
+     * it was written for the same geometry, build method and configuration,
+     * and writes it otherwise. Empty path disables caching. Lazily built 
+     * trees are never cached, see BSP_BUILD_LAZY_BINNED_SAH. Must be called 
+     * before compile. */
+    void setCacheFile(const std::string& path) {
+      assert(!mCompiled);
+      mCacheFile = path;
+    }
+
+    const std::string& getCacheFile() const {
+      return mCacheFile;
+    }
+
+    /** @returns hash of the geometry of this model and its build parameters, 
+     * which is used as a cache file key. */
+    unsigned long long getGeometryHash() const {
+      const BspBuildParams& params = getBuildParams();
+      int vertexCount = mVertexData.size();
+      int triangleCount = getTriangleCount();
+
+      unsigned long long hash = SMART_HASH_SEED;
+      int buildMethod = params.buildMethod;
+      hash = hashBytes(hash, &buildMethod, sizeof(buildMethod));
+      hash = hashBytes(hash, &params.traversalCost, sizeof(params.traversalCost));
+      hash = hashBytes(hash, &params.intersectionCost, sizeof(params.intersectionCost));
+      hash = hashBytes(hash, &params.emptySpaceBonus, sizeof(params.emptySpaceBonus));
+      hash = hashBytes(hash, &params.maxDepth, sizeof(params.maxDepth));
+      hash = hashBytes(hash, &params.maxLeafSize, sizeof(params.maxLeafSize));
+      hash = hashBytes(hash, &params.terminationThreshold, sizeof(params.terminationThreshold));
+      hash = hashBytes(hash, &params.autoLeafSize, sizeof(params.autoLeafSize));
+      hash = hashBytes(hash, &params.autoBinnedSize, sizeof(params.autoBinnedSize));
+      hash = hashBytes(hash, &vertexCount, sizeof(vertexCount));
+      hash = hashBytes(hash, &triangleCount, sizeof(triangleCount));
+      for(int i = 0; i < vertexCount; i++)
+        hash = hashBytes(hash, mVertexData[i].mCoord.data(), 3 * sizeof(float));
+      for(int i = 0; i < triangleCount; i++)
+        hash = hashBytes(hash, mTriangleData[i].mVertexId, sizeof(mTriangleData[i].mVertexId));
+      return hash;
+    }
+
+    /** Compiles a model - builds ray-triangle intersection test acceleration
+     * structures and a BSP tree, or loads them from the cache file. */
+    void compile() {
+      if(mCompiled)
+        return;
+
+      /* Empty models have nothing worth caching. */
+      bool cached = !mCacheFile.empty() && getBuildParams().buildMethod != BSP_BUILD_LAZY_BINNED_SAH && getTriangleCount() > 0;
+      if(!cached || !loadCache()) {
+        /* Create TriAccel structures first. */
+        mTriAccels.reserve(getTriangleCount());
+        for(int i = 0; i < getTriangleCount(); ++i)
+          mTriAccels.push_back(TriAccel(getTriangle(i)));
+
+        /* Build BspTree. Relayout also packs TriAccel4 blocks, if any. */
+        mBspTree.compile(FakeArray<int>(getTriangleCount()), TriangleClipper(*this));
+        mBspTree.relayout();
+
+        if(cached)
+          saveCache();
+      }
+
+      /* We're done. */
+      mCompiled = true;
+    }
+
+    bool isCompiled() const {
+      return mCompiled;
+    }
+
+    /** Moves the given vertex. Can be called on a compiled model, in which
+     * case refit must be called before the model is traced again. */
+    void setCoord(int vertexId, const Vector3f& coord) {
+      assert(hasVertex(vertexId));
+      mVertexData[vertexId].mCoord = coord;
+      mRefitNeeded = mCompiled;
+    }
+
+    /** Updates acceleration structures of a compiled model after some of its 
+     * vertices were moved with setCoord. Triangle acceleration structures 
+     * are recomputed, and BSP tree is refitted keeping its topology, see 
+     * BspTree::refit. Must not be called while the model is being traced. */
+    void refit() {
+      assert(mCompiled);
+      if(!mRefitNeeded)
+        return;
+
+      for(int i = 0; i < getTriangleCount(); ++i)
+        mTriAccels[i] = TriAccel(getTriangle(i));
+
+      /* Refit relays out the tree, which rebuilds TriAccel4 blocks from the
+       * new TriAccels. */
+      mBspTree.refit(FakeArray<int>(getTriangleCount()), TriangleClipper(*this));
+
+      mRefitNeeded = false;
+    }
+
+  private:
+    enum {
+      /** Version of the cache file format, increment on any change. */
+      cacheVersion = 1
+    };
+
+    /** Header of the cache file. The file consists of the header, an array of
+     * TriAccels, and a BSP tree image, each aligned on SMART_CACHELINE 
+     * boundary. */
+    struct CacheHeader {
+      char magic[8];                /**< "SMARTMDL". */
+      int version;                  /**< Cache file format version. */
+      int triAccelSize;             /**< sizeof(TriAccel), depends on configuration. */
+      int pointerSize;              /**< sizeof(void*). */
+      int triangleCount;            /**< Number of triangles. */
+      unsigned long long hash;      /**< Geometry hash, see getGeometryHash. */
+      int triAccelOffset;           /**< Offset of the TriAccel array. */
+      int bspTreeOffset;            /**< Offset of the BSP tree image. */
+    };
+
+    /** @returns the given offset aligned forward on SMART_CACHELINE boundary. */
+    static int alignCacheOffset(int offset) {
+      return (offset + SMART_CACHELINE - 1) & ~(SMART_CACHELINE - 1);
+    }
+
+    /** Fills the given cache header for this model. */
+    void initializeCacheHeader(CacheHeader& header) const {
+      memset(&header, 0, sizeof(header));
+      memcpy(header.magic, "SMARTMDL", sizeof(header.magic));
+      header.version = cacheVersion;
+      header.triAccelSize = sizeof(TriAccel);
+      header.pointerSize = sizeof(void*);
+      header.triangleCount = getTriangleCount();
+      header.hash = getGeometryHash();
+      header.triAccelOffset = alignCacheOffset(sizeof(CacheHeader));
+      header.bspTreeOffset = alignCacheOffset(header.triAccelOffset + getTriangleCount() * sizeof(TriAccel));
+    }
+
+    /** Tries to load compiled structures from the cache file. Everything is 
+     * validated and copied out of the mapped file, which is closed right 
+     * away.
+     * 
+     * @returns true on success, false if the file is missing, stale, or 
+     *   malformed. */
+    bool loadCache() {
+      MappedFile mapping;
+      if(!mapping.open(mCacheFile.c_str()))
+        return false;
+
+      CacheHeader expected;
+      initializeCacheHeader(expected);
+      const CacheHeader* header = reinterpret_cast<const CacheHeader*>(mapping.getData());
+      if(mapping.getSize() < expected.bspTreeOffset || memcmp(header, &expected, sizeof(CacheHeader)) != 0)
+        return false;
+
+      /* Projection dimension is used as an index by intersection tests. */
+      const TriAccel* triAccels = reinterpret_cast<const TriAccel*>(mapping.getData() + expected.triAccelOffset);
+      for(int i = 0; i < getTriangleCount(); ++i)
+        if(triAccels[i].k < 0 || triAccels[i].k > 2)
+          return false;
+
+      /* Loading relays the tree out, which packs TriAccel4 blocks out of 
+       * mTriAccels, so they must be in place first. */
+      mTriAccels.reserve(getTriangleCount());
+      for(int i = 0; i < getTriangleCount(); ++i)
+        mTriAccels.push_back(triAccels[i]);
+
+      if(!mBspTree.loadImage(mapping.getData() + expected.bspTreeOffset, mapping.getSize() - expected.bspTreeOffset, getTriangleCount())) {
+        mTriAccels.clear();
+        return false;
+      }
+      return true;
+    }
+
+    /** Writes compiled structures into the cache file. Failures are ignored, 
+     * since the cache is only an optimization. The file is written under a 
+     * temporary name first, so that other processes never map a partially
+     * written one. */
+    void saveCache() const {
+      assert(getTriangleCount() > 0);
+
+      std::string tmpFile = mCacheFile + ".tmp";
+      std::ofstream stream(tmpFile.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+      if(!stream)
+        return;
+
+      CacheHeader header;
+      initializeCacheHeader(header);
+      stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      writeCachePadding(stream, header.triAccelOffset);
+      stream.write(reinterpret_cast<const char*>(&mTriAccels[0]), getTriangleCount() * sizeof(TriAccel));
+      writeCachePadding(stream, header.bspTreeOffset);
+      bool saved = mBspTree.saveImage(stream) != 0;
+      stream.close();
+
+      if(!saved || !stream) {
+        std::remove(tmpFile.c_str());
+        return;
+      }
+
+      /* Rename doesn't overwrite on some platforms. */
+      std::remove(mCacheFile.c_str());
+      std::rename(tmpFile.c_str(), mCacheFile.c_str());
+    }
+
+    /** Writes zeros to the given stream until it reaches the given offset. */
+    static void writeCachePadding(std::ostream& stream, int offset) {
+      while(static_cast<int>(stream.tellp()) < offset)
+        stream.put(0);
+    }
+
+    class TriangleClipper {
+    public:
+      TriangleClipper(const CoreModel& coreModel): mCoreModel(&coreModel) {}
+
+      BoundingBox operator()(int i, const BoundingBox& boundingBox) const {
+        BoundingBox result;
+        clip(mCoreModel->getTriangle(i), mCoreModel->mTriAccels[i], boundingBox, result);
+        return result;
+      }
+
+      BoundingBox operator()(int i) const {
+        return triangleBoundingBox(mCoreModel->getTriangle(i));
+      }
+    private:
+      const CoreModel* mCoreModel;
+    };
+
+#ifdef SMART_USE_TRIACCEL4
+    /** TriAccel4Packer stores TriAccel4 blocks of the triangles of BSP tree
+     * leaves right before their index lists, see BspTree::setLeafPacker. */
+    class TriAccel4Packer {
+    public:
+      TriAccel4Packer(const CoreModel& coreModel): mCoreModel(&coreModel) {}
+
+      int getSize(int objectCount) const {
+        STATIC_ASSERT((sizeof(TriAccel4) % BspTree::packedLeafAlignment == 0));
+        return TriAccel4::getBlockCount(objectCount) * sizeof(TriAccel4);
+      }
+
+      void operator()(const NodeTriangleIdList& list, void* data) const {
+        TriAccel4* blocks = static_cast<TriAccel4*>(data);
+        for(int i = 0; i < TriAccel4::getBlockCount(list.size()); i++)
+          new (&blocks[i]) TriAccel4();
+        for(int i = 0; i < list.size(); i++)
+          blocks[i / TriAccel4::SIZE].set(i % TriAccel4::SIZE, mCoreModel->mTriAccels[list[i]]);
+      }
+
+    private:
+      const CoreModel* mCoreModel;
+    };
+#endif
+
+    /** TriangleData structure stores data associated with a triangle. */
+    struct TriangleData {
+      int mVertexId[3];
+      void* mShadingParam;
+    };
+
+    /** VertexData structure stores data associated with a vertex. */
+    struct VertexData {
+      Vector3f mCoord;
+      Vector3f mNormal;
+      Vector3f mTexCoord;
+      void* mShadingParam;
+    };
+
+    /** TriangleAdapter class represents a reference to one of the triangles in a model. */
+    class TriangleAdapter {
+    public:
+      TriangleAdapter(const CoreModel& model, int index):
+        mModel(model), mIndex(index) {}
+
+      const Vector3f& operator[](int vertexIndex) const {
+        assert(vertexIndex >= 0 && vertexIndex < 3);
+        return mModel.mVertexData[mModel.mTriangleData[mIndex].mVertexId[vertexIndex]].mCoord;
+      }
+
+    private:
+      const CoreModel& mModel;
+      int mIndex;
+    };
+
+    friend class SmartCore;
+    friend class ShadedModel;
+    friend class TriangleClipper;
+#ifdef SMART_USE_TRIACCEL4
+    friend class TriAccel4Packer;
+#endif
+
+    /** Constructor. 
+     *
+     * @param id identifier of this model. */
+    CoreModel() {
+      initialize(16, 48);
+    }
+
+    /** Constructor. Allocates triangle and vertex buffers.
+     * 
+     * @param id identifier of this model.
+     * @param triangleCapacity initial triangle capacity of this model.
+     * @param vertexCapacity initial vertex capacity of this model. */
+    CoreModel(int triangleCapacity, int vertexCapacity) {
+      initialize(triangleCapacity, vertexCapacity);
+    }
+
+    /** Initializer. Called from constructors. */
+    void initialize(int triangleCapacity, int vertexCapacity) {
+      ExplicitlyCounted::initialize(this);
+      mTriangleData.reserve(triangleCapacity);
+      mVertexData.reserve(vertexCapacity);
+      mCompiled = false;
+      mRefitNeeded = false;
+      mShadingParamArena.setNextBlockCapacity(1024);
+
+      /* Models vary in size a lot, so the build method is picked per model. */
+      BspBuildParams params;
+      params.buildMethod = BSP_BUILD_AUTO;
+      mBspTree.setBuildParams(params);
+#ifdef SMART_USE_TRIACCEL4
+      mBspTree.setLeafPacker(TriAccel4Packer(*this));
+#endif
+    }
+
+    /** Array of TriAccel structures - one structure instance per triangle. 
+     * Created on compilation. Note that this is the only data accessed
+     * during triangle intersection tests. */
+    arx::FastArray<TriAccel> mTriAccels;
+
+    /** Array of TriangleData structures, describing triangles. 
+     * Stays intact after compilation. */
+    arx::FastArray<TriangleData> mTriangleData;
+
+    /** Array of VertexData structures, describing vertices.
+     * Stays intact after compilation. */
+    arx::FastArray<VertexData> mVertexData;
+
+    /** Storage for shading parameters, which are set per triangle and per vertex. */
+    MemoryArena<> mShadingParamArena;
+
+    /** Binary Space Subdivision tree for triangle data. 
+     * Created on compilation. */
+    BspTree mBspTree;
+
+    /** Path to the cache file, empty if caching is disabled. */
+    std::string mCacheFile;
+
+    /** Is this CoreModel compiled? */
+    bool mCompiled;
+
+    /** Were vertices of this compiled CoreModel moved since the last refit? */
+    bool mRefitNeeded;
+  };
+
+
+} // namespace smart
+
+#endif // __SMART_COREMODEL_H__
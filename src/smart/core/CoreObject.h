@@ -1,60 +1,116 @@
-#ifndef __SMART_COREOBJECT_H__
-#define __SMART_COREOBJECT_H__
-
-#include "common.h"
-#include "ShadedModel.h"
-
-namespace smart {
-
-  /** CoreObject represents an instantiation of a model in a scene. 
-   * It is defined by a model and a transformation matrix. */
-  class CoreObject: public arx::nonassignable {
-  public:
-    const ShadedModel* getModel() const {
-      return mModel;
-    }
-
-    ShadedModel* getModel() {
-      return mModel;
-    }
-
-    /** @returns transformation from object local coordinates to world coordinates. */
-    const Matrix4f& getLocalToWorldTransform() const {
-      return mLocalToWorldTransform;
-    }
-
-    /** @returns transformation from world coordinates to object local coordinates. */
-    const Matrix4f& getWorldToLocalTransform() const {
-      return mWorldToLocalTransform;
-    }
-
-    ~CoreObject() {
-      mModel->releaseOwnership();
-    }
-
-  private:
-    friend class SmartCore;
-    friend class CoreScene;
-
-    /** Constructor.
-     * 
-     * @param model model to instantiate this object for. 
-     * @param localToWorldTransform transformation from object local 
-     *   coordinates to world coordinates. */
-    CoreObject(ShadedModel* model, const Matrix4f& localToWorldTransform): 
-      mModel(model), mLocalToWorldTransform(localToWorldTransform) {
-      mModel->claimOwnership();
-      localToWorldTransform.computeInverse(&mWorldToLocalTransform);
-    }
-
-    /** Transformation from object space to world space. */
-    Matrix4f mLocalToWorldTransform;
-
-    /** Transformation from world space to object space. */
-    Matrix4f mWorldToLocalTransform;
-    ShadedModel* mModel;
-  };
-
-} // namespace smart
-
-#endif // __SMART_COREOBJECT_H__
+#ifndef __SMART_COREOBJECT_H__
+#define __SMART_COREOBJECT_H__
+
+#include "common.h"
+#include "ShadedModel.h"
+
+namespace smart {
+
+  /** CoreObject represents an instantiation of a model in a scene. 
+   * It is defined by a model and a transformation matrix. */
+  class CoreObject: public arx::nonassignable {
+  public:
+    const ShadedModel* getModel() const {
+      return mModel;
+    }
+
+    ShadedModel* getModel() {
+      return mModel;
+    }
+
+    /** @returns transformation from object local coordinates to world coordinates. */
+    const Matrix4f& getLocalToWorldTransform() const {
+      return mLocalToWorldTransform;
+    }
+
+    /** @returns transformation from world coordinates to object local coordinates. */
+    const Matrix4f& getWorldToLocalTransform() const {
+      return mWorldToLocalTransform;
+    }
+
+    /** @returns the given world space point in object local coordinates. */
+    Vector3f transformPointToLocal(const Vector3f& point) const {
+      return transformDirectionToLocal(point) + mWorldToLocalTranslation;
+    }
+
+    /** @returns the given world space direction in object local coordinates.
+     * Note that the result is not normalized, so that distances along 
+     * the transformed ray are the same as along the original one. */
+    Vector3f transformDirectionToLocal(const Vector3f& direction) const {
+      return Vector3f(
+        mWorldToLocalLinear[0].dot(direction),
+        mWorldToLocalLinear[1].dot(direction),
+        mWorldToLocalLinear[2].dot(direction)
+      );
+    }
+
+    /** @returns bounding box of this object in world coordinates. Valid only
+     * when the owning CoreScene is compiled. */
+    const BoundingBox& getBoundingBox() const {
+      return mBoundingBox;
+    }
+
+    ~CoreObject() {
+      mModel->releaseOwnership();
+    }
+
+  private:
+    friend class SmartCore;
+    friend class CoreScene;
+
+    /** Constructor.
+     * 
+     * @param model model to instantiate this object for. 
+     * @param localToWorldTransform transformation from object local 
+     *   coordinates to world coordinates. */
+    CoreObject(ShadedModel* model, const Matrix4f& localToWorldTransform): 
+      mModel(model), mLocalToWorldTransform(localToWorldTransform) {
+      mModel->claimOwnership();
+      localToWorldTransform.computeInverse(&mWorldToLocalTransform);
+
+      /* Rays are transformed with the affine part only. */
+      assert(abs(mWorldToLocalTransform(3, 0)) < 1.0e-6 && abs(mWorldToLocalTransform(3, 1)) < 1.0e-6 && 
+        abs(mWorldToLocalTransform(3, 2)) < 1.0e-6 && abs(mWorldToLocalTransform(3, 3) - 1.0f) < 1.0e-6);
+      for(int i = 0; i < 3; i++) {
+        mWorldToLocalLinear[i] = Vector3f(mWorldToLocalTransform(i, 0), mWorldToLocalTransform(i, 1), mWorldToLocalTransform(i, 2));
+        mWorldToLocalTranslation[i] = mWorldToLocalTransform(i, 3);
+      }
+    }
+
+    /** Recalculates world space bounding box of this object. Must be called
+     * after the underlying model is compiled. */
+    void updateBoundingBox() {
+      const BoundingBox& local = mModel->getBoundingBox();
+
+      mBoundingBox = BoundingBox::empty();
+      for(int i = 0; i < 8; i++) {
+        Vector3f corner(
+          (i & 1) ? local.getMax(0) : local.getMin(0),
+          (i & 2) ? local.getMax(1) : local.getMin(1),
+          (i & 4) ? local.getMax(2) : local.getMin(2)
+        );
+        mBoundingBox.extend(transform(corner, mLocalToWorldTransform));
+      }
+    }
+
+    /** Transformation from object space to world space. */
+    Matrix4f mLocalToWorldTransform;
+
+    /** Transformation from world space to object space. */
+    Matrix4f mWorldToLocalTransform;
+
+    /** Rows of the linear part of world to object space transformation. */
+    Vector3f mWorldToLocalLinear[3];
+
+    /** Translation part of world to object space transformation. */
+    Vector3f mWorldToLocalTranslation;
+
+    /** Bounding box in world space. */
+    BoundingBox mBoundingBox;
+
+    ShadedModel* mModel;
+  };
+
+} // namespace smart
+
+#endif // __SMART_COREOBJECT_H__
@@ -1,95 +1,185 @@
-#ifndef __SMART_SCENEINTERNAL_H__
-#define __SMART_SCENEINTERNAL_H__
-
-#include "common.h"
-#include <arx/Utility.h>
-#include <arx/Collections.h>
-#include "ExplicitlyCounted.h"
-#include "CoreObject.h"
-#include "Idded.h"
-
-namespace smart {
-
-  /** Class representing the whole rendering scene. */
-  class CoreScene: private arx::noncopyable, private ExplicitlyCounted<CoreScene>, public Idded {
-  public:
-    ~CoreScene() {
-      for(int i = 0; i < mObjects.size(); i++)
-         mObjects[i]->~CoreObject();
-    }
-
-    const BoundingBox& getBoundingBox() const {
-      return getObject(0)->getModel()->getBoundingBox(); // TODO
-    }
-
-    /** @returns an Object with the given index. */
-    const CoreObject* getObject(int index) const {
-      return mObjects[index];
-    }
-
-    /** @returns an Object with the given index. */
-    CoreObject* getObject(int index) {
-      return mObjects[index];
-    }
-
-    /** @returns the total number of Object instances in this scene. */
-    const int getObjectCount() const {
-      return mObjects.size();
-    }
-
-    /** Adds the given model to the scene, applying the given transformation
-     * to it. */
-    void newObject(ShadedModel* model, const Matrix4f& transform) {
-      assert(!mCompiled);
-      mObjects.push_back(new (mArena.allocate<CoreObject>(1)) CoreObject(model, transform));
-    }
-
-    void compile() {
-      if(mCompiled)
-        return;
-
-      /* Compile all the underlying models. */
-      for(int i = 0; i < mObjects.size(); i++)
-        mObjects[i]->getModel()->compile();
-
-      mCompiled = true;
-    }
-
-    bool isCompiled() const {
-      return mCompiled;
-    }
-
-  private:
-    friend class SmartCore;
-    friend class ShadedScene;
-
-    CoreScene() {
-      initialize(16);
-    }
-
-    CoreScene(int objectCapacity) {
-      initialize(objectCapacity);
-    }
-
-    /** Initializer. Called from constructors. */
-    void initialize(int objectCapacity) {
-      ExplicitlyCounted::initialize(this);
-      mObjects.reserve(objectCapacity);
-      mCompiled = false;
-    }
-
-    /** Array of objects in this scene. Note that scene owns all its objects,
-     * and they are released together with the scene. */
-    arx::CheckedArray<CoreObject*> mObjects;
-
-    /** Memory arena for objects. */
-    MemoryArena<MulDivAdd<3, 2, 0> > mArena;
-
-    /** Is this scene compiled? */
-    bool mCompiled;
-  };
-
-} // namespace smart
-
-
-#endif // __SMART_SCENEINTERNAL_H__
+#ifndef __SMART_SCENEINTERNAL_H__
+#define __SMART_SCENEINTERNAL_H__
+
+#include "common.h"
+#include <set>
+#include <arx/Utility.h>
+#include <arx/Collections.h>
+#include "ExplicitlyCounted.h"
+#include "CoreObject.h"
+#include "BspTree.h"
+#include "Utility.h"
+#include "Idded.h"
+
+namespace smart {
+
+  /** Class representing the whole rendering scene. */
+  class CoreScene: private arx::noncopyable, private ExplicitlyCounted<CoreScene>, public Idded {
+  public:
+    ~CoreScene() {
+      for(int i = 0; i < mObjects.size(); i++)
+         mObjects[i]->~CoreObject();
+    }
+
+    /** @returns world space bounding box of this scene. Valid only when 
+     * this scene is compiled. */
+    const BoundingBox& getBoundingBox() const {
+      assert(mCompiled);
+      return mBoundingBox;
+    }
+
+    /** @returns top-level BSP tree built over world space bounding boxes
+     * of objects of this scene. Its leaves store object indices. Valid only
+     * when this scene is compiled and is not empty. */
+    const BspTree& getBspTree() const {
+      assert(mCompiled && getObjectCount() > 0);
+      return mBspTree;
+    }
+
+    /** @returns an Object with the given index. */
+    const CoreObject* getObject(int index) const {
+      return mObjects[index];
+    }
+
+    /** @returns an Object with the given index. */
+    CoreObject* getObject(int index) {
+      return mObjects[index];
+    }
+
+    /** @returns the total number of Object instances in this scene. */
+    const int getObjectCount() const {
+      return mObjects.size();
+    }
+
+    /** Adds the given model to the scene, applying the given transformation
+     * to it. */
+    void newObject(ShadedModel* model, const Matrix4f& transform) {
+      assert(!mCompiled);
+      mObjects.push_back(new (mArena.allocate<CoreObject>(1)) CoreObject(model, transform));
+    }
+
+    void compile() {
+      if(mCompiled)
+        return;
+
+      /* Compile all the underlying models. */
+      for(int i = 0; i < mObjects.size(); i++) {
+        mObjects[i]->getModel()->compile();
+        mObjects[i]->updateBoundingBox();
+      }
+
+      /* Build top-level BSP tree over the objects. */
+      if(mObjects.size() > 0) {
+        mBspTree.compile(FakeArray<int>(mObjects.size()), ObjectClipper(*this));
+        mBspTree.relayout();
+        mBoundingBox = mBspTree.getBoundingBox();
+      } else
+        mBoundingBox = BoundingBox::empty();
+
+      mCompiled = true;
+    }
+
+    /** Updates a compiled scene after vertices of some of its models were
+     * moved. Models are refitted, and top-level BSP tree is rebuilt, which is
+     * cheap since it's built over objects. */
+    void refit() {
+      assert(mCompiled);
+
+      for(int i = 0; i < mObjects.size(); i++) {
+        mObjects[i]->getModel()->refit();
+        mObjects[i]->updateBoundingBox();
+      }
+
+      if(mObjects.size() > 0) {
+        mBspTree.clear();
+        mBspTree.compile(FakeArray<int>(mObjects.size()), ObjectClipper(*this));
+        mBspTree.relayout();
+        mBoundingBox = mBspTree.getBoundingBox();
+      }
+    }
+
+    bool isCompiled() const {
+      return mCompiled;
+    }
+
+    /** @returns BSP tree statistics of the models of this scene, aggregated.
+     * Models instanced several times are counted once. Statistics of the 
+     * top-level tree are available via getBspTree().getStats(). */
+    BspTreeStats getModelStats() const {
+      assert(mCompiled);
+
+      std::set<const ShadedModel*> models;
+      BspTreeStats stats;
+      for(int i = 0; i < mObjects.size(); i++)
+        if(models.insert(mObjects[i]->getModel()).second)
+          stats.add(mObjects[i]->getModel()->getStats());
+      return stats;
+    }
+
+  private:
+    friend class SmartCore;
+    friend class ShadedScene;
+
+    /** ObjectClipper clips world space bounding boxes of scene objects 
+     * during top-level BSP tree compilation. */
+    class ObjectClipper {
+    public:
+      ObjectClipper(const CoreScene& coreScene): mCoreScene(&coreScene) {}
+
+      BoundingBox operator()(int i, const BoundingBox& boundingBox) const {
+        const BoundingBox& objectBoundingBox = mCoreScene->getObject(i)->getBoundingBox();
+        BoundingBox result = boundingBox;
+        result.setMin(objectBoundingBox.getMin().cwise().max(boundingBox.getMin()));
+        result.setMax(objectBoundingBox.getMax().cwise().min(boundingBox.getMax()));
+        return result;
+      }
+
+      BoundingBox operator()(int i) const {
+        return mCoreScene->getObject(i)->getBoundingBox();
+      }
+    private:
+      const CoreScene* mCoreScene;
+    };
+
+    CoreScene() {
+      initialize(16);
+    }
+
+    CoreScene(int objectCapacity) {
+      initialize(objectCapacity);
+    }
+
+    /** Initializer. Called from constructors. */
+    void initialize(int objectCapacity) {
+      ExplicitlyCounted::initialize(this);
+      mObjects.reserve(objectCapacity);
+      mCompiled = false;
+
+      /* Top-level tree is rebuilt on every refit, so it must be cheap to 
+       * build, and there are few objects to make exact SAH pay off anyway. */
+      BspBuildParams params;
+      params.buildMethod = BSP_BUILD_BINNED_SAH;
+      mBspTree.setBuildParams(params);
+    }
+
+    /** Array of objects in this scene. Note that scene owns all its objects,
+     * and they are released together with the scene. */
+    arx::CheckedArray<CoreObject*> mObjects;
+
+    /** Memory arena for objects. */
+    MemoryArena<MulDivAdd<3, 2, 0> > mArena;
+
+    /** Top-level BSP tree over the objects. */
+    BspTree mBspTree;
+
+    /** World space bounding box of this scene. */
+    BoundingBox mBoundingBox;
+
+    /** Is this scene compiled? */
+    bool mCompiled;
+  };
+
+} // namespace smart
+
+
+#endif // __SMART_SCENEINTERNAL_H__
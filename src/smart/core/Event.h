@@ -0,0 +1,129 @@
+#ifndef __SMART_EVENT_H__
+#define __SMART_EVENT_H__
+
+#include "common.h"
+#include <arx/Utility.h>
+#include <arx/Thread.h>
+#include "Atomic.h"
+
+#ifdef ARX_WIN32
+#  include <windows.h>
+#else
+#  include <semaphore.h>
+#  include <sched.h>
+#endif
+
+namespace smart {
+// -------------------------------------------------------------------------- //
+// Event
+// -------------------------------------------------------------------------- //
+  /** Auto-reset event, a primitive for a single thread to wait on.
+   *
+   * Signal is kept until a waiter consumes it, so signals sent before
+   * anybody waits are not lost. Signals don't accumulate. Waiter spins for a
+   * while before going to sleep, and the kernel is called only if the waiter
+   * actually sleeps. */
+  class Event: private arx::noncopyable {
+  public:
+    Event(): mSignaled(0), mSleepers(0), mSetters(0) {
+#ifdef ARX_WIN32
+      mHandle = CreateEventA(NULL, FALSE, FALSE, NULL);
+#else
+      sem_init(&mSemaphore, 0, 0);
+#endif
+    }
+
+    ~Event() {
+#ifdef ARX_WIN32
+      CloseHandle(mHandle);
+#else
+      sem_destroy(&mSemaphore);
+#endif
+    }
+
+    /** Signals the event, waking the waiter if there is one. */
+    void set() {
+      mSetters.increment();
+      if(mSignaled.compareExchange(0, 1) && mSleepers.load() != 0) {
+#ifdef ARX_WIN32
+        SetEvent(mHandle);
+#else
+        sem_post(&mSemaphore);
+#endif
+      }
+      mSetters.decrement();
+    }
+
+    /** Waits for the event to be signaled, and resets it.
+     *
+     * Spins for SMART_EVENT_SPIN_COUNT iterations before going to sleep,
+     * since a wake-up that comes soon is a lot cheaper to catch awake. There
+     * is no spinning on a single processor, where it would only delay the 
+     * setter. Note that the event may be destroyed as soon as wait returns. */
+    void wait() {
+      int spinCount = getSpinCount();
+      for(int i = 0; i < spinCount; i++) {
+        if(mSignaled.compareExchange(1, 0)) {
+          waitForSetters();
+          return;
+        }
+        pause();
+      }
+
+      /* Sleeper count is raised before the last check of the signal, so a
+       * concurrent set either sees it and wakes us, or is seen by the check.
+       * Kernel object may be left signaled by a wake-up that came in late,
+       * that is handled by checking the signal again. */
+      mSleepers.increment();
+      while(!mSignaled.compareExchange(1, 0)) {
+#ifdef ARX_WIN32
+        WaitForSingleObject(mHandle, INFINITE);
+#else
+        sem_wait(&mSemaphore);
+#endif
+      }
+      mSleepers.decrement();
+      waitForSetters();
+    }
+
+  private:
+    /** Waits for the concurrent calls to set to return, so that the event
+     * can be destroyed once wait returns. The setter has likely just been
+     * preempted by the thread it woke, so the processor is given away 
+     * instead of spinning. */
+    void waitForSetters() {
+      while(mSetters.load() != 0) {
+#ifdef ARX_WIN32
+        SwitchToThread();
+#else
+        sched_yield();
+#endif
+      }
+    }
+
+    static int getSpinCount() {
+      static const int spinCount = arx::thread::hardware_concurrency() > 1 ? SMART_EVENT_SPIN_COUNT : 0;
+      return spinCount;
+    }
+
+    static void pause() {
+#ifdef ARX_WIN32
+      YieldProcessor();
+#elif defined(__i386__) || defined(__x86_64__)
+      __asm__ __volatile__("pause");
+#endif
+    }
+
+    AtomicInt mSignaled;
+    AtomicInt mSleepers;
+    AtomicInt mSetters;
+#ifdef ARX_WIN32
+    HANDLE mHandle;
+#else
+    sem_t mSemaphore;
+#endif
+  };
+
+} // namespace smart
+
+#endif // __SMART_EVENT_H__
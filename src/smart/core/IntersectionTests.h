@@ -1,183 +1,613 @@
-#ifndef __SMART_INTERSECTIONTESTS_H__
-#define __SMART_INTERSECTIONTESTS_H__
-
-#include "common.h"
-#include "Ray.h"
-#include "Segment.h"
-#include "TriAccel.h"
-#include "Utility.h"
-
-namespace smart {
-  namespace detail {
-    /** Intersects the given ray segment with the given triangle.
-     * In case there was in intersection, returns barycentric coordinates of
-     * intersection in barycenricCoord parameter and clips the given segment
-     * so that its end lies on the triangle plane.
-     * 
-     * @returns true if there was an intersection, false otherwise. */
-    FORCEINLINE bool intersect(const Ray& ray, Segment& segment, const TriAccel& triAccel, Vector3f& barycenricCoord, float epsilon) {
-      assert(epsilon >= 0.0f);
-
-      /* Shortcuts. */
-      const Vector3f& o = ray.getOrigin();
-      const Vector3f& d = ray.getDirection();
-      const TriAccel& a = triAccel;
-
-      /* Some macro magic won't hurt... */
-#define ak (a.k)
-#define au (fastModulo3(a.k + 1))
-#define av (fastModulo3(a.k + 2))
-
-      /* Start high-latecy division first - compute reciprocal scalar product of 
-       * plane normal and ray direction. */
-      const float nd = 1.0f / (d[ak] + a.nU * d[au] + a.nV * d[av]);
-
-      /* Compute t parameter for point of plane-ray intersection. */
-      const float t = (a.nD - o[ak] - a.nU * o[au] - a.nV * o[av]) * nd;
-
-      /* If we are outside the needed segment, then it's a miss. */
-      if(!(segment.contains(t, epsilon + abs(t) * epsilon))) /* TODO: think about these evil epsilons. */
-        return false;
-
-      /* Compute hit point positions on uv plane. */
-      const float hu = o[au] + t * d[au];
-      const float hv = o[av] + t * d[av];
-
-      /* Check first barycentric coordinate. */
-      const float beta = hu * a.bnU + hv * a.bnV + a.bD;
-      if (beta < -epsilon) 
-        return false;
-
-      /* Check second barycentric coordinate. */
-      const float gamma = hu * a.cnU + hv * a.cnV + a.cD;
-      if (gamma < -epsilon) 
-        return false;
-
-      /* Check third barycentric coordinate. */
-      if (gamma + beta > 1.0f + epsilon) 
-        return false;
-
-      /* Hit point is valid. */
-      segment.setMax(t);
-      barycenricCoord = Vector3f(1 - (beta + gamma), beta, gamma);
-      return true;
-
-      /* Clean up. */
-#undef ak
-#undef au
-#undef av
-    }
-
-    /** SAT checker for box-triangle intersection test. */
-    FORCEINLINE bool satFailed(int u, int v, const Vector3f& edge, const Vector3f& offset, 
-      const Vector3f& extend, const Vector3f& vertex) {
-        /* Projection of offset to edge normal. */
-        const float offsetProj = (-edge[v] * offset[u] + edge[u] * offset[v]);
-
-        /* Projection of extend to edge normal. */
-        const float extendProj = (abs(edge[v]) * extend[u] + abs(edge[u]) * extend[v]);
-
-        /* Projection of vertex to edge normal. */
-        const float vertexProj = (-edge[v] * vertex[u] + edge[u] * vertex[v]);
-
-        /* Apply SAT. */
-        if(vertexProj < 0)
-          return offsetProj + extendProj < vertexProj || 0 < offsetProj - extendProj;
-        else
-          return offsetProj + extendProj < 0 || vertexProj < offsetProj - extendProj;
-    }
-
-    /** Determines whether a given triangle and a bounding box intersect. */
-    template<class TriangleType>
-    inline bool intersects(const BoundingBox& boundingBox, const TriangleType& triangle) {
-      /* Shortcuts. */
-      const Vector3f& a = triangle[0];
-      const Vector3f& b = triangle[1];
-      const Vector3f& c = triangle[2];
-
-      /* Edges. */
-      const Vector3f e0 = b - a;
-      const Vector3f e1 = c - b;
-      const Vector3f e2 = a - c;
-
-      /* Calculate center of the bounding box. */
-      const Vector3f mOrg = (boundingBox.getMin() + boundingBox.getMax()) * 0.5f;
-
-      /* Calculate extends of the bounding box. */
-      const Vector3f mExt = mOrg - boundingBox.getMin();
-
-      /* Bounding box center offsets. */
-      const Vector3f v0 = mOrg - a;
-      const Vector3f v1 = mOrg - b;
-
-      /* First simple AABB vs AABB test in 3D. */
-      const Vector3f tMin = a.cwise().min(b.cwise().min(c));
-      const Vector3f tMax = a.cwise().max(b.cwise().max(c));
-      const Vector3f tOrg = (tMin + tMax) * 0.5;
-      const Vector3f tExt = tOrg - tMin;
-      if(((tOrg - mOrg).cwise().abs().cwise() > tExt + mExt).any())
-        return false;
-
-      /* Then it's time to use the Separating Axis Theorem.
-      * See http://www.harveycartel.org/metanet/tutorials/tutorialA.html#section1 for details. */
-
-      /* Apply SAT for triangle normal in 3D. */
-      const Vector3f tNorm = e0.cross(e1);
-      if(abs(tNorm.dot(v0)) - tNorm.cwise().abs().dot(mExt) > 0)
-        return false;
-
-      /* Apply SAT for 9 edge-plane combinations. 
-      * XY first. */
-      if(satFailed(0, 1, e0, v0, mExt, -e2)) return false;
-      if(satFailed(0, 1, e1, v1, mExt, -e0)) return false;
-      if(satFailed(0, 1, e2, v0, mExt, -e1)) return false;
-
-      /* Then YZ. */
-      if(satFailed(1, 2, e0, v0, mExt, -e2)) return false;
-      if(satFailed(1, 2, e1, v1, mExt, -e0)) return false;
-      if(satFailed(1, 2, e2, v0, mExt, -e1)) return false;
-
-      /* And finally ZX. */
-      if(satFailed(2, 0, e0, v0, mExt, -e2)) return false;
-      if(satFailed(2, 0, e1, v1, mExt, -e0)) return false;
-      if(satFailed(2, 0, e2, v0, mExt, -e1)) return false;
-
-      /* Intersection! */
-      return true;
-
-      /* see
-       * http://www.gamedev.net/community/forums/topic.asp?topic_id=307377&whichpage=1? */
-    }
-
-  } // namespace detail
-
-// -------------------------------------------------------------------------- //
-// Interface section
-// -------------------------------------------------------------------------- //
-  inline bool intersect(const Ray& ray, Segment& segment, const TriAccel& triAccel, Vector3f& barycenricCoord, float eps) {
-    return detail::intersect(ray, segment, triAccel, barycenricCoord, eps);
-  }
-
-  inline bool intersect(const Ray& ray, Segment& segment, const TriAccel& triAccel, float eps) {
-    Vector3f dummy;
-    return detail::intersect(ray, segment, triAccel, dummy, eps);
-  }
-
-  template<class TriangleType>
-  inline bool intersects(const BoundingBox& boundingBox, const TriangleType& triangle) {
-    return detail::intersects(boundingBox, triangle);
-  }
-
-  template<class TriangleType>
-  inline bool intersects(const TriangleType& triangle, const BoundingBox& boundingBox) {
-    return detail::intersects(boundingBox, triangle);
-  }
-
-  inline bool intersects(const BoundingBox& a, const BoundingBox& b) {
-    return (a.getMax().cwise() >= b.getMin()).all() &&
-      (b.getMax().cwise() >= a.getMin()).all();
-  }
-
-} // namespace smart
-
+#ifndef __SMART_INTERSECTIONTESTS_H__
+#define __SMART_INTERSECTIONTESTS_H__
+
+#include "common.h"
+#include "Ray.h"
+#include "RayPacket.h"
+#include "Segment.h"
+#include "TriAccel.h"
+#include "TriAccel4.h"
+#include "Utility.h"
+
+namespace smart {
+  namespace detail {
+    /** Tests the given ray segment against the given triangle using Wald's
+     * projection test. 
+     *
+     * @param t (out) distance along the ray to the triangle plane.
+     * @param beta (out) second barycentric coordinate of the hit point.
+     * @param gamma (out) third barycentric coordinate of the hit point.
+     * @returns true if there was an intersection, false otherwise. In the
+     *   latter case output parameters may hold garbage. */
+    FORCEINLINE bool testHitWald(const Ray& ray, const Segment& segment, const TriAccel& triAccel, float& t, float& beta, float& gamma, float epsilon) {
+      assert(epsilon >= 0.0f);
+
+      /* Shortcuts. */
+      const Vector3f& o = ray.getOrigin();
+      const Vector3f& d = ray.getDirection();
+      const TriAccel& a = triAccel;
+
+      /* Some macro magic won't hurt... */
+#define ak (a.k)
+#define au (fastModulo3(a.k + 1))
+#define av (fastModulo3(a.k + 2))
+
+      /* Start high-latecy division first - compute reciprocal scalar product of 
+       * plane normal and ray direction. */
+      const float nd = 1.0f / (d[ak] + a.nU * d[au] + a.nV * d[av]);
+
+      /* Compute t parameter for point of plane-ray intersection. */
+      t = (a.nD - o[ak] - a.nU * o[au] - a.nV * o[av]) * nd;
+
+      /* If we are outside the needed segment, then it's a miss. */
+      if(!(segment.contains(t, epsilon + abs(t) * epsilon))) /* TODO: think about these evil epsilons. */
+        return false;
+
+      /* Compute hit point positions on uv plane. */
+      const float hu = o[au] + t * d[au];
+      const float hv = o[av] + t * d[av];
+
+      /* Check first barycentric coordinate. */
+      beta = hu * a.bnU + hv * a.bnV + a.bD;
+      if (beta < -epsilon) 
+        return false;
+
+      /* Check second barycentric coordinate. */
+      gamma = hu * a.cnU + hv * a.cnV + a.cD;
+      if (gamma < -epsilon) 
+        return false;
+
+      /* Check third barycentric coordinate. */
+      if (gamma + beta > 1.0f + epsilon) 
+        return false;
+
+      /* Hit point is valid. */
+      return true;
+
+      /* Clean up. */
+#undef ak
+#undef au
+#undef av
+    }
+
+#ifdef SMART_USE_WATERTIGHT_INTERSECTION
+    /** Tests the given ray segment against the given triangle using the 
+     * watertight test by Woop, Benthin and Wald. 
+     *
+     * Triangle vertices are transformed into ray space, where the ray starts
+     * at the origin and goes along the z axis, and three edge functions are 
+     * evaluated in 2D. Neighbouring triangles compute exactly the same edge
+     * function values for their shared edges, so hits on edges and vertices
+     * are neither lost nor double-counted, and no epsilons are needed for 
+     * the barycentric coordinates. Parameters are the same as in 
+     * testHitWald. */
+    FORCEINLINE bool testHitWatertight(const Ray& ray, const Segment& segment, const TriAccel& triAccel, float& t, float& beta, float& gamma, float epsilon) {
+      assert(epsilon >= 0.0f);
+
+      /* Shortcuts. */
+      const Vector3f& o = ray.getOrigin();
+      const int kx = ray.getShearAxis(0);
+      const int ky = ray.getShearAxis(1);
+      const int kz = ray.getShearAxis(2);
+      const float sx = ray.getShear(0);
+      const float sy = ray.getShear(1);
+      const float sz = ray.getShear(2);
+      const float* A = triAccel.vertices[0];
+      const float* B = triAccel.vertices[1];
+      const float* C = triAccel.vertices[2];
+
+      /* Transform vertices into ray space. */
+      const float az = A[kz] - o[kz];
+      const float bz = B[kz] - o[kz];
+      const float cz = C[kz] - o[kz];
+      const float ax = A[kx] - o[kx] - sx * az;
+      const float ay = A[ky] - o[ky] - sy * az;
+      const float bx = B[kx] - o[kx] - sx * bz;
+      const float by = B[ky] - o[ky] - sy * bz;
+      const float cx = C[kx] - o[kx] - sx * cz;
+      const float cy = C[ky] - o[ky] - sy * cz;
+
+      /* Compute scaled barycentric coordinates. */
+      float u = cx * by - cy * bx;
+      float v = ax * cy - ay * cx;
+      float w = bx * ay - by * ax;
+
+      /* Ray passes exactly through an edge, recompute in double precision
+       * to get the sign right. */
+      if(u == 0.0f || v == 0.0f || w == 0.0f) {
+        u = static_cast<float>(static_cast<double>(cx) * by - static_cast<double>(cy) * bx);
+        v = static_cast<float>(static_cast<double>(ax) * cy - static_cast<double>(ay) * cx);
+        w = static_cast<float>(static_cast<double>(bx) * ay - static_cast<double>(by) * ax);
+      }
+
+      /* Mixed signs mean that ray passes outside the triangle. */
+      if((u < 0.0f || v < 0.0f || w < 0.0f) && (u > 0.0f || v > 0.0f || w > 0.0f))
+        return false;
+
+      /* Ray is parallel to the triangle plane. */
+      const float det = u + v + w;
+      if(det == 0.0f)
+        return false;
+
+      /* Compute hit distance. */
+      const float detRec = 1.0f / det;
+      t = (u * az + v * bz + w * cz) * sz * detRec;
+      if(!(segment.contains(t, epsilon + abs(t) * epsilon)))
+        return false;
+
+      /* Hit point is valid. */
+      beta = v * detRec;
+      gamma = w * detRec;
+      return true;
+    }
+#endif // SMART_USE_WATERTIGHT_INTERSECTION
+
+    /** Tests the given ray segment against the given triangle, using the 
+     * test selected at compile time. Parameters are the same as in 
+     * testHitWald. */
+    FORCEINLINE bool testHit(const Ray& ray, const Segment& segment, const TriAccel& triAccel, float& t, float& beta, float& gamma, float epsilon) {
+#ifdef SMART_USE_WATERTIGHT_INTERSECTION
+      return testHitWatertight(ray, segment, triAccel, t, beta, gamma, epsilon);
+#else
+      return testHitWald(ray, segment, triAccel, t, beta, gamma, epsilon);
+#endif
+    }
+
+    /** Intersects the given ray segment with the given triangle.
+     * In case there was in intersection, returns barycentric coordinates of
+     * intersection in barycenricCoord parameter and clips the given segment
+     * so that its end lies on the triangle plane.
+     * 
+     * @returns true if there was an intersection, false otherwise. */
+    FORCEINLINE bool intersect(const Ray& ray, Segment& segment, const TriAccel& triAccel, Vector3f& barycenricCoord, float epsilon) {
+      float t, beta, gamma;
+      if(!testHit(ray, segment, triAccel, t, beta, gamma, epsilon))
+        return false;
+
+      segment.setMax(t);
+      barycenricCoord = Vector3f(1 - (beta + gamma), beta, gamma);
+      return true;
+    }
+
+#ifdef SMART_USE_SSE
+    /** Intersects four ray segments of the given ray packet with the given
+     * triangle using Wald's projection test. Works exactly like the single 
+     * ray version, but only for rays which are set in the active lane mask.
+     *
+     * For every ray that hits the triangle, clips the end of its segment so 
+     * that it lies on the triangle plane and stores the second and third 
+     * barycentric coordinates of the hit point. Data of other rays is left 
+     * untouched.
+     *
+     * @returns lane mask of rays that hit the triangle. */
+    FORCEINLINE int intersectWald(const RayPacket& packet, const __m128& segmentMin, __m128& segmentMax, const TriAccel& triAccel, 
+                                  __m128& beta, __m128& gamma, int activeMask, float epsilon) {
+      assert(epsilon >= 0.0f);
+
+      /* Shortcuts. */
+      const TriAccel& a = triAccel;
+      const int k = a.k;
+      const int u = fastModulo3(a.k + 1);
+      const int v = fastModulo3(a.k + 2);
+      const __m128 eps = _mm_set1_ps(epsilon);
+
+      const __m128 oK = packet.getOrigin(k);
+      const __m128 oU = packet.getOrigin(u);
+      const __m128 oV = packet.getOrigin(v);
+      const __m128 dU = packet.getDirection(u);
+      const __m128 dV = packet.getDirection(v);
+      const __m128 nU = _mm_set1_ps(a.nU);
+      const __m128 nV = _mm_set1_ps(a.nV);
+
+      /* Reciprocal scalar product of plane normal and ray direction. 
+       * We need full precision here, so no _mm_rcp_ps. */
+      const __m128 nd = _mm_div_ps(_mm_set1_ps(1.0f), 
+        _mm_add_ps(packet.getDirection(k), _mm_add_ps(_mm_mul_ps(nU, dU), _mm_mul_ps(nV, dV))));
+
+      /* Compute t parameter for point of plane-ray intersection. */
+      const __m128 t = _mm_mul_ps(nd, _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(a.nD), oK), 
+        _mm_add_ps(_mm_mul_ps(nU, oU), _mm_mul_ps(nV, oV))));
+
+      /* Segment containment test, same as in Segment::contains. Note that
+       * comparisons with NaNs return false, so degenerate rays are culled 
+       * here too. */
+      const __m128 tEps = _mm_add_ps(eps, _mm_mul_ps(sseAbs(t), eps));
+      __m128 valid = _mm_and_ps(
+        _mm_cmple_ps(segmentMin, _mm_add_ps(t, tEps)), 
+        _mm_cmple_ps(_mm_sub_ps(t, tEps), segmentMax)
+      );
+      if((_mm_movemask_ps(valid) & activeMask) == 0)
+        return 0;
+
+      /* Compute hit point positions on uv plane. */
+      const __m128 hu = _mm_add_ps(oU, _mm_mul_ps(t, dU));
+      const __m128 hv = _mm_add_ps(oV, _mm_mul_ps(t, dV));
+
+      /* Check barycentric coordinates. */
+      const __m128 negEps = _mm_sub_ps(_mm_setzero_ps(), eps);
+      const __m128 b = _mm_add_ps(_mm_add_ps(_mm_mul_ps(hu, _mm_set1_ps(a.bnU)), _mm_mul_ps(hv, _mm_set1_ps(a.bnV))), _mm_set1_ps(a.bD));
+      valid = _mm_and_ps(valid, _mm_cmpge_ps(b, negEps));
+      const __m128 g = _mm_add_ps(_mm_add_ps(_mm_mul_ps(hu, _mm_set1_ps(a.cnU)), _mm_mul_ps(hv, _mm_set1_ps(a.cnV))), _mm_set1_ps(a.cD));
+      valid = _mm_and_ps(valid, _mm_cmpge_ps(g, negEps));
+      valid = _mm_and_ps(valid, _mm_cmple_ps(_mm_add_ps(b, g), _mm_add_ps(_mm_set1_ps(1.0f), eps)));
+
+      int hitMask = _mm_movemask_ps(valid) & activeMask;
+      if(hitMask == 0)
+        return 0;
+
+      /* Store hits. */
+      const __m128 hit = laneMask(hitMask);
+      segmentMax = sseSelect(hit, t, segmentMax);
+      beta = sseSelect(hit, b, beta);
+      gamma = sseSelect(hit, g, gamma);
+      return hitMask;
+    }
+
+#ifdef SMART_USE_WATERTIGHT_INTERSECTION
+    /** Tests the rays of the given packet that are set in the given lane 
+     * mask one by one with testHitWatertight, storing hits the same way
+     * intersectWatertight does.
+     *
+     * @returns lane mask of rays that hit the triangle. */
+    inline int intersectWatertightSingle(const RayPacket& packet, const __m128& segmentMin, __m128& segmentMax, const TriAccel& triAccel, 
+                                         __m128& beta, __m128& gamma, int mask, float epsilon) {
+      ALIGN(16) float mins[RayPacket::SIZE];
+      ALIGN(16) float maxs[RayPacket::SIZE];
+      ALIGN(16) float betas[RayPacket::SIZE];
+      ALIGN(16) float gammas[RayPacket::SIZE];
+      _mm_store_ps(mins, segmentMin);
+      _mm_store_ps(maxs, segmentMax);
+      _mm_store_ps(betas, beta);
+      _mm_store_ps(gammas, gamma);
+
+      int hitMask = 0;
+      for(int i = 0; i < RayPacket::SIZE; i++) {
+        float t;
+        if((mask & (1 << i)) && testHitWatertight(packet.getRay(i), Segment(mins[i], maxs[i]), triAccel, t, betas[i], gammas[i], epsilon)) {
+          maxs[i] = t;
+          hitMask |= 1 << i;
+        }
+      }
+      if(hitMask == 0)
+        return 0;
+
+      /* Data of the rays that missed is garbage now, so select. */
+      const __m128 hit = laneMask(hitMask);
+      segmentMax = sseSelect(hit, _mm_load_ps(maxs), segmentMax);
+      beta = sseSelect(hit, _mm_load_ps(betas), beta);
+      gamma = sseSelect(hit, _mm_load_ps(gammas), gamma);
+      return hitMask;
+    }
+
+    /** Packet version of the watertight test, see testHitWatertight. 
+     * Parameters and results are the same as in intersectWald.
+     *
+     * Ray space axis permutation is shared by all the rays of the packet,
+     * see RayPacket::updateShear. Rays that pass exactly through an edge
+     * are handed over to the single ray version one by one, for its double
+     * precision fallback. */
+    FORCEINLINE int intersectWatertight(const RayPacket& packet, const __m128& segmentMin, __m128& segmentMax, const TriAccel& triAccel, 
+                                        __m128& beta, __m128& gamma, int activeMask, float epsilon) {
+      assert(epsilon >= 0.0f);
+
+      /* Shortcuts. */
+      const int kx = packet.getShearAxis(0);
+      const int ky = packet.getShearAxis(1);
+      const int kz = packet.getShearAxis(2);
+      const __m128 sx = packet.getShear(0);
+      const __m128 sy = packet.getShear(1);
+      const __m128 sz = packet.getShear(2);
+      const __m128 ox = packet.getOrigin(kx);
+      const __m128 oy = packet.getOrigin(ky);
+      const __m128 oz = packet.getOrigin(kz);
+      const __m128 eps = _mm_set1_ps(epsilon);
+      const __m128 zero = _mm_setzero_ps();
+
+      /* Transform vertices into ray space. */
+#define SHEAR(V, X, Y, Z)                                                       \
+      const __m128 Z = _mm_sub_ps(_mm_set1_ps(V[kz]), oz);                      \
+      const __m128 X = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(V[kx]), ox), _mm_mul_ps(sx, Z)); \
+      const __m128 Y = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(V[ky]), oy), _mm_mul_ps(sy, Z));
+
+      SHEAR(triAccel.vertices[0], ax, ay, az);
+      SHEAR(triAccel.vertices[1], bx, by, bz);
+      SHEAR(triAccel.vertices[2], cx, cy, cz);
+#undef SHEAR
+
+      /* Compute scaled barycentric coordinates. */
+      const __m128 u = _mm_sub_ps(_mm_mul_ps(cx, by), _mm_mul_ps(cy, bx));
+      const __m128 v = _mm_sub_ps(_mm_mul_ps(ax, cy), _mm_mul_ps(ay, cx));
+      const __m128 w = _mm_sub_ps(_mm_mul_ps(bx, ay), _mm_mul_ps(by, ax));
+
+      /* Rays that pass exactly through an edge are rare, they are tested 
+       * separately. */
+      int edgeMask = activeMask & _mm_movemask_ps(
+        _mm_or_ps(_mm_or_ps(_mm_cmpeq_ps(u, zero), _mm_cmpeq_ps(v, zero)), _mm_cmpeq_ps(w, zero)));
+      int edgeHitMask = 0;
+      if(edgeMask != 0) {
+        edgeHitMask = intersectWatertightSingle(packet, segmentMin, segmentMax, triAccel, beta, gamma, edgeMask, epsilon);
+        activeMask &= ~edgeMask;
+      }
+
+      /* Mixed signs mean that ray passes outside the triangle. */
+      const __m128 anyNegative = _mm_or_ps(_mm_or_ps(_mm_cmplt_ps(u, zero), _mm_cmplt_ps(v, zero)), _mm_cmplt_ps(w, zero));
+      const __m128 anyPositive = _mm_or_ps(_mm_or_ps(_mm_cmpgt_ps(u, zero), _mm_cmpgt_ps(v, zero)), _mm_cmpgt_ps(w, zero));
+      const __m128 det = _mm_add_ps(_mm_add_ps(u, v), w);
+      __m128 valid = _mm_andnot_ps(_mm_and_ps(anyNegative, anyPositive), _mm_cmpneq_ps(det, zero));
+      if((_mm_movemask_ps(valid) & activeMask) == 0)
+        return edgeHitMask;
+
+      /* Compute hit distances. Full precision is needed here, so no 
+       * _mm_rcp_ps. */
+      const __m128 detRec = _mm_div_ps(_mm_set1_ps(1.0f), det);
+      const __m128 t = _mm_mul_ps(_mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(u, az), _mm_mul_ps(v, bz)), _mm_mul_ps(w, cz)), sz), detRec);
+
+      /* Segment containment test, same as in Segment::contains. */
+      const __m128 tEps = _mm_add_ps(eps, _mm_mul_ps(sseAbs(t), eps));
+      valid = _mm_and_ps(valid, _mm_and_ps(
+        _mm_cmple_ps(segmentMin, _mm_add_ps(t, tEps)), 
+        _mm_cmple_ps(_mm_sub_ps(t, tEps), segmentMax)
+      ));
+
+      int hitMask = _mm_movemask_ps(valid) & activeMask;
+      if(hitMask == 0)
+        return edgeHitMask;
+
+      /* Store hits. */
+      const __m128 hit = laneMask(hitMask);
+      segmentMax = sseSelect(hit, t, segmentMax);
+      beta = sseSelect(hit, _mm_mul_ps(v, detRec), beta);
+      gamma = sseSelect(hit, _mm_mul_ps(w, detRec), gamma);
+      return hitMask | edgeHitMask;
+    }
+#endif // SMART_USE_WATERTIGHT_INTERSECTION
+
+    /** Intersects four ray segments of the given ray packet with the given
+     * triangle, using the test selected at compile time. */
+    FORCEINLINE int intersect(const RayPacket& packet, const __m128& segmentMin, __m128& segmentMax, const TriAccel& triAccel, 
+                              __m128& beta, __m128& gamma, int activeMask, float epsilon) {
+#ifdef SMART_USE_WATERTIGHT_INTERSECTION
+      return intersectWatertight(packet, segmentMin, segmentMax, triAccel, beta, gamma, activeMask, epsilon);
+#else
+      return intersectWald(packet, segmentMin, segmentMax, triAccel, beta, gamma, activeMask, epsilon);
+#endif
+    }
+
+    /** Tests the given ray segment against four triangles of the given
+     * TriAccel4 block at once. Acceptance rules are the same as in the
+     * single triangle version.
+     *
+     * @param t (out) distances along the ray to the triangle planes.
+     * @param beta (out) second barycentric coordinates of the hit points.
+     * @param gamma (out) third barycentric coordinates of the hit points.
+     * @returns lane mask of the hit triangles. */
+    FORCEINLINE int testHit(const Ray& ray, const Segment& segment, const TriAccel4& a, __m128& t, __m128& beta, __m128& gamma, float epsilon) {
+      assert(epsilon >= 0.0f);
+
+      const __m128 eps = _mm_set1_ps(epsilon);
+      const __m128 ox = _mm_set1_ps(ray.getOrigin(0));
+      const __m128 oy = _mm_set1_ps(ray.getOrigin(1));
+      const __m128 oz = _mm_set1_ps(ray.getOrigin(2));
+      const __m128 dx = _mm_set1_ps(ray.getDirection(0));
+      const __m128 dy = _mm_set1_ps(ray.getDirection(1));
+      const __m128 dz = _mm_set1_ps(ray.getDirection(2));
+
+      /* Macro magic again. Computes dot product of a splatted ray vector with
+       * the given array of SoA vectors. */
+#define DOT(x, y, z, v) \
+  _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_load_ps(v[0])), _mm_mul_ps(y, _mm_load_ps(v[1]))), _mm_mul_ps(z, _mm_load_ps(v[2])))
+
+      /* Reciprocal scalar product of plane normal and ray direction. */
+      const __m128 nd = _mm_div_ps(_mm_set1_ps(1.0f), DOT(dx, dy, dz, a.n));
+
+      /* Compute t parameter for points of plane-ray intersection. */
+      t = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(a.nD), DOT(ox, oy, oz, a.n)), nd);
+
+      /* Segment containment test. */
+      const __m128 tEps = _mm_add_ps(eps, _mm_mul_ps(sseAbs(t), eps));
+      __m128 valid = _mm_and_ps(
+        _mm_cmple_ps(_mm_set1_ps(segment.getMin()), _mm_add_ps(t, tEps)), 
+        _mm_cmple_ps(_mm_sub_ps(t, tEps), _mm_set1_ps(segment.getMax()))
+      );
+      if((_mm_movemask_ps(valid) & a.validMask) == 0)
+        return 0;
+
+      /* Barycentric coordinates. Since b[k] and c[k] are zero, dot product
+       * with the hit point gives exactly the uv plane equations. */
+      const __m128 negEps = _mm_sub_ps(_mm_setzero_ps(), eps);
+      beta = _mm_add_ps(_mm_add_ps(DOT(ox, oy, oz, a.b), _mm_mul_ps(t, DOT(dx, dy, dz, a.b))), _mm_load_ps(a.bD));
+      valid = _mm_and_ps(valid, _mm_cmpge_ps(beta, negEps));
+      gamma = _mm_add_ps(_mm_add_ps(DOT(ox, oy, oz, a.c), _mm_mul_ps(t, DOT(dx, dy, dz, a.c))), _mm_load_ps(a.cD));
+      valid = _mm_and_ps(valid, _mm_cmpge_ps(gamma, negEps));
+      valid = _mm_and_ps(valid, _mm_cmple_ps(_mm_add_ps(beta, gamma), _mm_add_ps(_mm_set1_ps(1.0f), eps)));
+
+#undef DOT
+
+      return _mm_movemask_ps(valid) & a.validMask;
+    }
+
+    /** Intersects the given ray segment with four triangles of the given
+     * TriAccel4 block at once. Acceptance rules are the same as in the
+     * single triangle version. In case several triangles are hit, the
+     * nearest one is chosen.
+     *
+     * In case there was an intersection, returns barycentric coordinates of
+     * intersection in barycenricCoord parameter and clips the given segment
+     * so that its end lies on the triangle plane.
+     *
+     * @returns lane index of the hit triangle, or -1 if there was no 
+     *   intersection. */
+    FORCEINLINE int intersect(const Ray& ray, Segment& segment, const TriAccel4& a, Vector3f& barycenricCoord, float epsilon) {
+      __m128 t, beta, gamma;
+      int hitMask = testHit(ray, segment, a, t, beta, gamma, epsilon);
+      if(hitMask == 0)
+        return -1;
+
+      /* Pick the nearest hit. */
+      const __m128 hit = laneMask(hitMask);
+      const __m128 tMin = _mm_set1_ps(sseHorizontalMin(sseSelect(hit, t, _mm_set1_ps(std::numeric_limits<float>::max()))));
+      hitMask &= _mm_movemask_ps(_mm_cmpeq_ps(t, tMin));
+      int lane = 0;
+      while(!(hitMask & (1 << lane)))
+        lane++;
+
+      ALIGN(16) float ts[TriAccel4::SIZE];
+      ALIGN(16) float betas[TriAccel4::SIZE];
+      ALIGN(16) float gammas[TriAccel4::SIZE];
+      _mm_store_ps(ts, t);
+      _mm_store_ps(betas, beta);
+      _mm_store_ps(gammas, gamma);
+
+      /* Hit point is valid. */
+      segment.setMax(ts[lane]);
+      barycenricCoord = Vector3f(1 - (betas[lane] + gammas[lane]), betas[lane], gammas[lane]);
+      return lane;
+    }
+#endif // SMART_USE_SSE
+
+    /** SAT checker for box-triangle intersection test. */
+    FORCEINLINE bool satFailed(int u, int v, const Vector3f& edge, const Vector3f& offset, 
+      const Vector3f& extend, const Vector3f& vertex) {
+        /* Projection of offset to edge normal. */
+        const float offsetProj = (-edge[v] * offset[u] + edge[u] * offset[v]);
+
+        /* Projection of extend to edge normal. */
+        const float extendProj = (abs(edge[v]) * extend[u] + abs(edge[u]) * extend[v]);
+
+        /* Projection of vertex to edge normal. */
+        const float vertexProj = (-edge[v] * vertex[u] + edge[u] * vertex[v]);
+
+        /* Apply SAT. */
+        if(vertexProj < 0)
+          return offsetProj + extendProj < vertexProj || 0 < offsetProj - extendProj;
+        else
+          return offsetProj + extendProj < 0 || vertexProj < offsetProj - extendProj;
+    }
+
+    /** Determines whether a given triangle and a bounding box intersect. */
+    template<class TriangleType>
+    inline bool intersects(const BoundingBox& boundingBox, const TriangleType& triangle) {
+      /* Shortcuts. */
+      const Vector3f& a = triangle[0];
+      const Vector3f& b = triangle[1];
+      const Vector3f& c = triangle[2];
+
+      /* Edges. */
+      const Vector3f e0 = b - a;
+      const Vector3f e1 = c - b;
+      const Vector3f e2 = a - c;
+
+      /* Calculate center of the bounding box. */
+      const Vector3f mOrg = (boundingBox.getMin() + boundingBox.getMax()) * 0.5f;
+
+      /* Calculate extends of the bounding box. */
+      const Vector3f mExt = mOrg - boundingBox.getMin();
+
+      /* Bounding box center offsets. */
+      const Vector3f v0 = mOrg - a;
+      const Vector3f v1 = mOrg - b;
+
+      /* First simple AABB vs AABB test in 3D. */
+      const Vector3f tMin = a.cwise().min(b.cwise().min(c));
+      const Vector3f tMax = a.cwise().max(b.cwise().max(c));
+      const Vector3f tOrg = (tMin + tMax) * 0.5;
+      const Vector3f tExt = tOrg - tMin;
+      if(((tOrg - mOrg).cwise().abs().cwise() > tExt + mExt).any())
+        return false;
+
+      /* Then it's time to use the Separating Axis Theorem.
+      * See http://www.harveycartel.org/metanet/tutorials/tutorialA.html#section1 for details. */
+
+      /* Apply SAT for triangle normal in 3D. */
+      const Vector3f tNorm = e0.cross(e1);
+      if(abs(tNorm.dot(v0)) - tNorm.cwise().abs().dot(mExt) > 0)
+        return false;
+
+      /* Apply SAT for 9 edge-plane combinations. 
+      * XY first. */
+      if(satFailed(0, 1, e0, v0, mExt, -e2)) return false;
+      if(satFailed(0, 1, e1, v1, mExt, -e0)) return false;
+      if(satFailed(0, 1, e2, v0, mExt, -e1)) return false;
+
+      /* Then YZ. */
+      if(satFailed(1, 2, e0, v0, mExt, -e2)) return false;
+      if(satFailed(1, 2, e1, v1, mExt, -e0)) return false;
+      if(satFailed(1, 2, e2, v0, mExt, -e1)) return false;
+
+      /* And finally ZX. */
+      if(satFailed(2, 0, e0, v0, mExt, -e2)) return false;
+      if(satFailed(2, 0, e1, v1, mExt, -e0)) return false;
+      if(satFailed(2, 0, e2, v0, mExt, -e1)) return false;
+
+      /* Intersection! */
+      return true;
+
+      /* see
+       * http://www.gamedev.net/community/forums/topic.asp?topic_id=307377&whichpage=1? */
+    }
+
+  } // namespace detail
+
+// -------------------------------------------------------------------------- //
+// Interface section
+// -------------------------------------------------------------------------- //
+  inline bool intersect(const Ray& ray, Segment& segment, const TriAccel& triAccel, Vector3f& barycenricCoord, float eps) {
+    return detail::intersect(ray, segment, triAccel, barycenricCoord, eps);
+  }
+
+  /** Intersects the given ray segment with the given triangle, 
+   * clipping the segment. Note that this one always uses Wald's test, as 
+   * triangle clipping relies on its barycentric coordinate epsilons. */
+  inline bool intersect(const Ray& ray, Segment& segment, const TriAccel& triAccel, float eps) {
+    float t, beta, gamma;
+    if(!detail::testHitWald(ray, segment, triAccel, t, beta, gamma, eps))
+      return false;
+
+    segment.setMax(t);
+    return true;
+  }
+
+  /** @returns true if the given ray segment intersects the given triangle.
+   * Unlike intersect, does not clip the segment. */
+  inline bool occludes(const Ray& ray, const Segment& segment, const TriAccel& triAccel, float eps) {
+    float t, beta, gamma;
+    return detail::testHit(ray, segment, triAccel, t, beta, gamma, eps);
+  }
+
+#ifdef SMART_USE_SSE
+  inline int intersect(const RayPacket& packet, const __m128& segmentMin, __m128& segmentMax, const TriAccel& triAccel, 
+                       __m128& beta, __m128& gamma, int activeMask, float eps) {
+    return detail::intersect(packet, segmentMin, segmentMax, triAccel, beta, gamma, activeMask, eps);
+  }
+
+  inline int intersect(const Ray& ray, Segment& segment, const TriAccel4& triAccel4, Vector3f& barycenricCoord, float eps) {
+    return detail::intersect(ray, segment, triAccel4, barycenricCoord, eps);
+  }
+
+  /** @returns true if the given ray segment intersects any of the triangles 
+   * of the given TriAccel4 block. Unlike intersect, does not clip the 
+   * segment. */
+  inline bool occludes(const Ray& ray, const Segment& segment, const TriAccel4& triAccel4, float eps) {
+    __m128 t, beta, gamma;
+    return detail::testHit(ray, segment, triAccel4, t, beta, gamma, eps) != 0;
+  }
+#endif // SMART_USE_SSE
+
+  template<class TriangleType>
+  inline bool intersects(const BoundingBox& boundingBox, const TriangleType& triangle) {
+    return detail::intersects(boundingBox, triangle);
+  }
+
+  template<class TriangleType>
+  inline bool intersects(const TriangleType& triangle, const BoundingBox& boundingBox) {
+    return detail::intersects(boundingBox, triangle);
+  }
+
+  inline bool intersects(const BoundingBox& a, const BoundingBox& b) {
+    return (a.getMax().cwise() >= b.getMin()).all() &&
+      (b.getMax().cwise() >= a.getMin()).all();
+  }
+
+} // namespace smart
+
 #endif // __SMART_INTERSECTIONTESTS_H__
\ No newline at end of file
@@ -0,0 +1,113 @@
+#ifndef __SMART_MAPPEDFILE_H__
+#define __SMART_MAPPEDFILE_H__
+
+#include "common.h"
+#include <cassert>
+#include <arx/Utility.h>
+
+#ifdef ARX_WIN32
+#  include <windows.h>
+#else
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+namespace smart {
+// -------------------------------------------------------------------------- //
+// MappedFile
+// -------------------------------------------------------------------------- //
+  /** MappedFile maps a whole file into memory read-only. Mapping is always
+   * page-aligned. */
+  class MappedFile: private arx::noncopyable {
+  public:
+    MappedFile(): mData(NULL), mSize(0) {}
+
+    ~MappedFile() {
+      close();
+    }
+
+    /** Maps the file with the given path, unmapping the previously mapped one.
+     *
+     * @returns true on success, false if the file does not exist, is empty,
+     *   or cannot be mapped. */
+    bool open(const char* path) {
+      close();
+
+#ifdef ARX_WIN32
+      HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+      if(file == INVALID_HANDLE_VALUE)
+        return false;
+
+      DWORD size = GetFileSize(file, NULL);
+      HANDLE mapping = NULL;
+      if(size != 0 && size != INVALID_FILE_SIZE)
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+      CloseHandle(file);
+      if(mapping == NULL)
+        return false;
+
+      void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+      CloseHandle(mapping);
+      if(data == NULL)
+        return false;
+#else
+      int file = ::open(path, O_RDONLY);
+      if(file < 0)
+        return false;
+
+      struct stat fileStat;
+      void* data = MAP_FAILED;
+      if(fstat(file, &fileStat) == 0 && fileStat.st_size > 0)
+        data = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+      ::close(file);
+      if(data == MAP_FAILED)
+        return false;
+
+      int size = static_cast<int>(fileStat.st_size);
+#endif
+
+      mData = static_cast<unsigned char*>(data);
+      mSize = static_cast<int>(size);
+      return true;
+    }
+
+    /** Unmaps the currently mapped file, if any. */
+    void close() {
+      if(mData == NULL)
+        return;
+
+#ifdef ARX_WIN32
+      UnmapViewOfFile(mData);
+#else
+      munmap(mData, mSize);
+#endif
+      mData = NULL;
+      mSize = 0;
+    }
+
+    bool isOpen() const {
+      return mData != NULL;
+    }
+
+    /** @returns pointer to the mapped memory. */
+    const unsigned char* getData() const {
+      assert(isOpen());
+      return mData;
+    }
+
+    /** @returns size of the mapped file, in bytes. */
+    int getSize() const {
+      return mSize;
+    }
+
+  private:
+    unsigned char* mData;
+    int mSize;
+  };
+
+} // namespace smart
+
+#endif // __SMART_MAPPEDFILE_H__
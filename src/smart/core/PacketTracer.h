@@ -0,0 +1,472 @@
+#ifndef __SMART_PACKETTRACER_H__
+#define __SMART_PACKETTRACER_H__
+
+#include "common.h"
+#include "RayPacket.h"
+#include "Clipping.h"
+#include "TraceContext.h"
+#include "Tracer.h"
+
+#ifdef SMART_USE_SSE
+
+namespace smart {
+// -------------------------------------------------------------------------- //
+// PacketTracer
+// -------------------------------------------------------------------------- //
+  /** PacketTracer traces packets of four rays through the scene at once.
+   *
+   * Rays of a packet share BSP tree node fetches and a single traversal stack,
+   * and are intersected with leaf triangles using SSE. Packets must be
+   * coherent, i.e. all rays of a packet must have the same direction signs
+   * along each axis in object space. For incoherent packets PacketTracer
+   * falls back to single ray tracing with Tracer.
+   *
+   * The results are the same as if each ray was traced with Tracer::trace,
+   * up to rounding in split plane distance computation. */
+  class PacketTracer {
+  public:
+    /** Single element of a packet traversal stack. */
+    ALIGN(16) struct StackElement {
+      __m128 segmentMin;
+      __m128 segmentMax;
+      const BspNode* node;
+      int mask;
+    };
+
+    /** Traces the given ray packet through the given BSP subtree.
+     *
+     * @param packet ray packet to trace, must be coherent.
+     * @param initialSegmentMin start of ray segments.
+     * @param segmentMax (in/out) end of ray segments, clipped for the rays
+     *   that hit something.
+     * @param beta (out) second barycentric coordinates of hit points.
+     * @param gamma (out) third barycentric coordinates of hit points.
+     * @param triangleIds (out) indices of hit triangles.
+     * @param activeMask lane mask of rays to trace.
+     * @returns lane mask of rays that hit something. */
+    static int trace(const RayPacket& packet, const __m128& initialSegmentMin, __m128& segmentMax, __m128& beta, __m128& gamma,
+                     int* triangleIds, int activeMask, const ShadedModel* model, const BspNode* root) {
+      TriangleLeafTracer leafTracer(packet, model, beta, gamma, triangleIds);
+      if(model->getBspTree().isLazy())
+        return traverse<true>(packet, initialSegmentMin, segmentMax, activeMask, root, leafTracer);
+      else
+        return traverse<false>(packet, initialSegmentMin, segmentMax, activeMask, root, leafTracer);
+    }
+
+    /** Traces the given ray packet through the given BSP tree, visiting
+     * leaves front to back. Shared by model and scene level traversals.
+     *
+     * @param lazy whether the tree may contain deferred nodes, see 
+     *   Tracer::traceBspNodes. Scene trees are never built lazily.
+     * @param leafTracer functor that is called for each visited leaf as
+     *   <tt>int leafTracer(const BspNode* leaf, const __m128& segmentMin, 
+     *   __m128& segmentMax, int activeMask)</tt>. It must clip segment ends
+     *   of the rays that hit something, and return their lane mask. 
+     * @returns lane mask of rays that hit something. */
+    template<bool lazy, class LeafTracer>
+    static FORCEINLINE int traverse(const RayPacket& packet, const __m128& initialSegmentMin, __m128& segmentMax, 
+                                    int activeMask, const BspNode* root, LeafTracer& leafTracer) {
+      assert(packet.isCoherent());
+
+      __m128 segmentMin = initialSegmentMin;
+
+      StackElement nodeStack[SMART_MAX_BSPTREE_DEPTH];
+      int nodeStackSize = 0;
+
+      const __m128 eps = _mm_set1_ps(SMART_TRACEBSPNODE_SEGMENTCONTAINS_EPS);
+      const BspNode* node = root;
+      int hitMask = 0;
+
+      /* Direction signs are the same for all the rays in a packet, so front
+       * and back child order can be determined once per packet. */
+      const int signs[3] = {
+        packet.getDirectionSign(0),
+        packet.getDirectionSign(1),
+        packet.getDirectionSign(2)
+      };
+
+      while(true) {
+        if(lazy && node->isDeferredAcquire()) {
+          BspTree::expand(node);
+        } else if(node->isLeaf()) {
+          /* Rays that hit something in this leaf are done, since leaves
+           * are visited front to back. Other rays are done with this 
+           * path, too. */
+          hitMask |= leafTracer(node, segmentMin, segmentMax, activeMask);
+          activeMask = 0;
+        } else {
+          const int dim = node->getSplitDim();
+
+          /* Calculate distances along the rays to the splitting plane.
+           * Zero directions have huge reciprocals, so the plane ends up
+           * infinitely far along such rays. */
+          const __m128 d = _mm_mul_ps(
+            _mm_sub_ps(_mm_set1_ps(node->getSplitCoord()), packet.getOrigin(dim)),
+            packet.getInvDirection(dim)
+          );
+          const __m128 dEps = _mm_add_ps(eps, _mm_mul_ps(eps, detail::sseAbs(d)));
+
+          const BspNode* frontChild = node->getLeftChild() + signs[dim];
+          const BspNode* backChild = node->getLeftChild() + (1 - signs[dim]);
+
+          /* Classify rays, same way single ray traversal does. */
+          const int frontMask = activeMask &
+            _mm_movemask_ps(_mm_cmpge_ps(d, _mm_sub_ps(segmentMin, dEps)));
+          const int backMask = activeMask &
+            _mm_movemask_ps(_mm_cmple_ps(d, _mm_add_ps(segmentMax, dEps)));
+
+          if(backMask == 0) {
+            /* Case one, all rays cull back side. */
+            node = frontChild;
+            activeMask = frontMask;
+          } else if(frontMask == 0) {
+            /* Case two, all rays cull front side. */
+            node = backChild;
+            activeMask = backMask;
+          } else {
+            /* Case three - traverse both sides in turn.
+             * Rays that cross the plane get their segments split at it. */
+            const __m128 both = detail::laneMask(frontMask & backMask);
+
+            assert(nodeStackSize < SMART_MAX_BSPTREE_DEPTH);
+            StackElement& top = nodeStack[nodeStackSize++];
+            top.node = backChild;
+            top.mask = backMask;
+            top.segmentMin = detail::sseSelect(both, d, segmentMin);
+            top.segmentMax = segmentMax;
+
+            node = frontChild;
+            activeMask = frontMask;
+            segmentMax = detail::sseSelect(both, d, segmentMax);
+          }
+        }
+
+        if(activeMask == 0) {
+          /* Pop the next node that still has some live rays. */
+          do {
+            if(nodeStackSize == 0)
+              return hitMask;
+            nodeStackSize--;
+            activeMask = nodeStack[nodeStackSize].mask & ~hitMask;
+          } while(activeMask == 0);
+
+          const __m128 active = detail::laneMask(activeMask);
+          node = nodeStack[nodeStackSize].node;
+          segmentMin = nodeStack[nodeStackSize].segmentMin;
+          segmentMax = detail::sseSelect(active, nodeStack[nodeStackSize].segmentMax, segmentMax);
+        }
+      }
+    }
+
+    /** Leaf tracer for model BSP trees, intersects active rays with all the
+     * triangles of a leaf. */
+    class TriangleLeafTracer {
+    public:
+      FORCEINLINE TriangleLeafTracer(const RayPacket& packet, const ShadedModel* model, __m128& beta, __m128& gamma, int* triangleIds):
+        mPacket(packet), mModel(model), mBeta(beta), mGamma(gamma), mTriangleIds(triangleIds) {}
+
+      FORCEINLINE int operator()(const BspNode* leaf, const __m128& segmentMin, __m128& segmentMax, int activeMask) {
+        NodeTriangleIdList list = leaf->getTriangleIndexList();
+        int hitMask = 0;
+        for(int i = 0; i < list.size(); ++i) {
+          int mask = intersect(mPacket, segmentMin, segmentMax, mModel->getTriAccel(list[i]),
+            mBeta, mGamma, activeMask, SMART_TRACETRIACCEL_EPS);
+          if(mask != 0) {
+            for(int j = 0; j < RayPacket::SIZE; j++)
+              if(mask & (1 << j))
+                mTriangleIds[j] = list[i];
+            hitMask |= mask;
+          }
+        }
+        return hitMask;
+      }
+
+    private:
+      const RayPacket& mPacket;
+      const ShadedModel* mModel;
+      __m128& mBeta;
+      __m128& mGamma;
+      int* mTriangleIds;
+    };
+
+    /** Leaf tracer for the top-level scene BSP tree, traces active rays
+     * through all the objects of a leaf. */
+    class ObjectLeafTracer {
+    public:
+      ObjectLeafTracer(TraceContext* ctx): mCtx(ctx) {}
+
+      int operator()(const BspNode* leaf, const __m128& segmentMin, __m128& segmentMax, int activeMask) {
+        ALIGN(16) float mins[RayPacket::SIZE];
+        ALIGN(16) float maxs[RayPacket::SIZE];
+        _mm_store_ps(mins, segmentMin);
+        _mm_store_ps(maxs, segmentMax);
+
+        /* Limit segments to the current cell. */
+        for(int i = 0; i < RayPacket::SIZE; i++)
+          if(activeMask & (1 << i))
+            mCtx[i].segment = Segment(mins[i], maxs[i]);
+
+        int hitMask = PacketTracer::traceObjects(mCtx, leaf->getTriangleIndexList(), activeMask);
+        if(hitMask != 0) {
+          for(int i = 0; i < RayPacket::SIZE; i++)
+            if(hitMask & (1 << i))
+              maxs[i] = mCtx[i].segment.getMax();
+          segmentMax = _mm_load_ps(maxs);
+        }
+        return hitMask;
+      }
+
+    private:
+      TraceContext* mCtx;
+    };
+
+    /** Traces the rays of the given trace contexts through the scene objects
+     * with the given indices. Works like Tracer::traceObjects - objects are 
+     * culled by their world space bounding boxes and traced in order of 
+     * their nearest entry distance over the rays, and objects are skipped
+     * for the rays that have already found a nearer hit.
+     *
+     * @param mask lane mask of rays to trace.
+     * @returns lane mask of rays that hit something. */
+    template<class IndexArray>
+    static int traceObjects(TraceContext* ctx, const IndexArray& indices, int mask) {
+      const ShadedScene* scene = ctx[0].scene;
+      const bool sorted = indices.size() <= SMART_TOPLEVEL_LINEAR_OBJECT_COUNT;
+
+      /* Culled objects, entries are indexed by slot. */
+      Tracer::ObjectEntry entries[SMART_TOPLEVEL_LINEAR_OBJECT_COUNT];
+      int objectIndices[SMART_TOPLEVEL_LINEAR_OBJECT_COUNT];
+      int objectMasks[SMART_TOPLEVEL_LINEAR_OBJECT_COUNT];
+      float objectEntries[SMART_TOPLEVEL_LINEAR_OBJECT_COUNT][RayPacket::SIZE];
+      int entryCount = 0;
+
+      int hitMask = 0;
+      for(int i = 0; i < indices.size(); ++i) {
+        const CoreObject* object = scene->getObject(indices[i]);
+
+        /* Cull the object for each ray. */
+        float laneEntries[RayPacket::SIZE];
+        float distance = std::numeric_limits<float>::max();
+        int objectMask = 0;
+        for(int j = 0; j < RayPacket::SIZE; j++) {
+          laneEntries[j] = std::numeric_limits<float>::max();
+          if(!(mask & (1 << j)))
+            continue;
+
+          Segment segment = ctx[j].segment;
+          clip(segment, ctx[j].ray, object->getBoundingBox());
+          if(!segment.isEmpty<true, true>()) {
+            objectMask |= 1 << j;
+            laneEntries[j] = segment.getMin();
+            distance = std::min(distance, segment.getMin());
+          }
+        }
+        if(objectMask == 0)
+          continue;
+
+        if(sorted) {
+          int slot = entryCount++;
+          objectIndices[slot] = indices[i];
+          objectMasks[slot] = objectMask;
+          for(int j = 0; j < RayPacket::SIZE; j++)
+            objectEntries[slot][j] = laneEntries[j];
+
+          /* Insertion sort, lists are short. */
+          int k = slot;
+          for(; k > 0 && distance < entries[k - 1].distance; k--)
+            entries[k] = entries[k - 1];
+          entries[k] = Tracer::ObjectEntry(distance, slot);
+        } else
+          hitMask |= trace(ctx, object, objectMask);
+      }
+
+      for(int i = 0; i < entryCount; ++i) {
+        int slot = entries[i].index;
+
+        /* Skip the object for the rays that start beyond their nearest 
+         * hits. */
+        int objectMask = 0;
+        for(int j = 0; j < RayPacket::SIZE; j++)
+          if((objectMasks[slot] & (1 << j)) && objectEntries[slot][j] <= ctx[j].segment.getMax())
+            objectMask |= 1 << j;
+
+        if(objectMask != 0)
+          hitMask |= trace(ctx, scene->getObject(objectIndices[slot]), objectMask);
+      }
+
+      return hitMask;
+    }
+
+    /** Traces the given ray packet through the given ShadedModel. Stores
+     * intersection data in the given trace contexts for rays that hit.
+     *
+     * @param mask lane mask of rays to trace.
+     * @returns lane mask of rays that hit something. */
+    static int trace(TraceContext* ctx, const RayPacket& packet, const ShadedModel* model, int mask = RayPacket::ALL) {
+      ALIGN(16) float segmentMin[RayPacket::SIZE];
+      ALIGN(16) float segmentMax[RayPacket::SIZE];
+      ALIGN(16) float beta[RayPacket::SIZE];
+      ALIGN(16) float gamma[RayPacket::SIZE];
+      int triangleIds[RayPacket::SIZE];
+
+      /* Clip ray segments to the model's bounding box. */
+      int activeMask = 0;
+      for(int i = 0; i < RayPacket::SIZE; i++) {
+        Segment segment = ctx[i].segment;
+        clip(segment, packet.getRay(i), model->getBoundingBox());
+        if((mask & (1 << i)) && !segment.isEmpty<true, true>())
+          activeMask |= 1 << i;
+        segmentMin[i] = segment.getMin();
+        segmentMax[i] = segment.getMax();
+      }
+      if(activeMask == 0)
+        return 0;
+
+      __m128 segmentMaxPs = _mm_load_ps(segmentMax);
+      __m128 betaPs = _mm_setzero_ps();
+      __m128 gammaPs = _mm_setzero_ps();
+      int hitMask = trace(packet, _mm_load_ps(segmentMin), segmentMaxPs, betaPs, gammaPs, triangleIds,
+        activeMask, model, model->getBspTree().getRoot());
+      if(hitMask == 0)
+        return 0;
+
+      _mm_store_ps(segmentMax, segmentMaxPs);
+      _mm_store_ps(beta, betaPs);
+      _mm_store_ps(gamma, gammaPs);
+      for(int i = 0; i < RayPacket::SIZE; i++) {
+        if(hitMask & (1 << i)) {
+          ctx[i].segment.setMax(segmentMax[i]);
+          ctx[i].tAlongRay = segmentMax[i];
+          ctx[i].barycentricCoord = Vector3f(1 - (beta[i] + gamma[i]), beta[i], gamma[i]);
+          ctx[i].triangleId = triangleIds[i];
+          ctx[i].model = model;
+        }
+      }
+      return hitMask;
+    }
+
+    /** Traces the rays of the given trace contexts through the given
+     * CoreObject.
+     *
+     * @param mask lane mask of rays to trace.
+     * @returns lane mask of rays that hit something. */
+    static int trace(TraceContext* ctx, const CoreObject* object, int mask = RayPacket::ALL) {
+      RayPacket packet;
+      for(int i = 0; i < RayPacket::SIZE; i++) {
+        const Ray& ray = ctx[i].ray;
+        packet.setRay(i, object->transformPointToLocal(ray.getOrigin()), object->transformDirectionToLocal(ray.getDirection()));
+      }
+
+      bool coherent = packet.isCoherent();
+#ifdef SMART_USE_WATERTIGHT_INTERSECTION
+      if(coherent) {
+        packet.updateShear();
+        coherent = packet.isShearValid();
+      }
+#endif
+
+      int hitMask = 0;
+      if(coherent) {
+        hitMask = trace(ctx, packet, object->getModel(), mask);
+        for(int i = 0; i < RayPacket::SIZE; i++)
+          if(hitMask & (1 << i))
+            ctx[i].object = object;
+      } else {
+        /* Directions disagree in sign, fall back to single rays. */
+        for(int i = 0; i < RayPacket::SIZE; i++)
+          if((mask & (1 << i)) && Tracer::trace(ctx[i], object))
+            hitMask |= 1 << i;
+      }
+      return hitMask;
+    }
+
+    /** Top-level packet tracing routine. Traces four primary rays stored in
+     * the given trace contexts through the scene and shades them.
+     *
+     * @param ctx array of RayPacket::SIZE trace contexts, with scene, depth
+     *   and ray set. */
+    static void trace(TraceContext* ctx) {
+      const ShadedScene* scene = ctx[0].scene;
+      for(int i = 0; i < RayPacket::SIZE; i++) {
+        assert(ctx[i].scene == scene && ctx[i].depth == 0);
+        assert(abs(ctx[i].ray.getDirection().squaredNorm() - 1.0f) < 1.0e-5);
+        ctx[i].segment = Segment(SMART_TRACEUPPER_SEGMENTSTART_EPS, std::numeric_limits<float>::max());
+      }
+
+      int hitMask = traceScene(ctx);
+
+      for(int i = 0; i < RayPacket::SIZE; i++)
+        Tracer::shade(ctx[i], (hitMask & (1 << i)) != 0);
+    }
+
+    /** Traces the rays of the given trace contexts through the scene, 
+     * linearly for small scenes and with the top-level BSP tree for bigger
+     * ones. Clips segments of the rays that hit something.
+     *
+     * @returns lane mask of rays that hit something. */
+    static int traceScene(TraceContext* ctx) {
+      const ShadedScene* scene = ctx[0].scene;
+      if(scene->getObjectCount() == 0)
+        return 0;
+
+      RayPacket packet;
+      for(int i = 0; i < RayPacket::SIZE; i++)
+        packet.setRay(i, ctx[i].ray.getOrigin(), ctx[i].ray.getDirection());
+
+      const bool linear = scene->getObjectCount() <= SMART_TOPLEVEL_LINEAR_OBJECT_COUNT;
+      if(!linear && !packet.isCoherent()) {
+        /* Directions disagree in sign, fall back to single rays. */
+        int hitMask = 0;
+        for(int i = 0; i < RayPacket::SIZE; i++)
+          if(Tracer::traceScene(ctx[i]))
+            hitMask |= 1 << i;
+        return hitMask;
+      }
+
+      /* Clip ray segments to the scene's bounding box. */
+      ALIGN(16) float segmentMin[RayPacket::SIZE];
+      ALIGN(16) float segmentMax[RayPacket::SIZE];
+      Segment oldSegments[RayPacket::SIZE];
+      int activeMask = 0;
+      for(int i = 0; i < RayPacket::SIZE; i++) {
+        oldSegments[i] = ctx[i].segment;
+        Segment segment = ctx[i].segment;
+        clip(segment, ctx[i].ray, scene->getBoundingBox());
+        if(!segment.isEmpty<true, true>())
+          activeMask |= 1 << i;
+        segmentMin[i] = segment.getMin();
+        segmentMax[i] = segment.getMax();
+      }
+      if(activeMask == 0)
+        return 0;
+
+      int hitMask;
+      if(linear) {
+        for(int i = 0; i < RayPacket::SIZE; i++)
+          if(activeMask & (1 << i))
+            ctx[i].segment = Segment(segmentMin[i], segmentMax[i]);
+        hitMask = traceObjects(ctx, FakeArray<int>(scene->getObjectCount()), activeMask);
+      } else {
+        __m128 segmentMaxPs = _mm_load_ps(segmentMax);
+        ObjectLeafTracer leafTracer(ctx);
+        hitMask = traverse<false>(packet, _mm_load_ps(segmentMin), segmentMaxPs, activeMask, 
+          scene->getBspTree().getRoot(), leafTracer);
+      }
+
+      /* Segments were limited to the scene bounding box and traversal 
+       * cells. */
+      for(int i = 0; i < RayPacket::SIZE; i++) {
+        if(hitMask & (1 << i))
+          ctx[i].segment.setMin(oldSegments[i].getMin());
+        else
+          ctx[i].segment = oldSegments[i];
+      }
+      return hitMask;
+    }
+  };
+
+} // namespace smart
+
+#endif // SMART_USE_SSE
+
+#endif // __SMART_PACKETTRACER_H__
@@ -1,58 +1,170 @@
-#ifndef __SMART_RAY_H__
-#define __SMART_RAY_H__
-
-#include "common.h"
-
-namespace smart {
-
-  /** Structure representing a single ray. */
-  ALIGN(32) struct Ray {
-  public:
-    Ray() {}
-
-    template<class DirDerived, class OrgDerived>
-    Ray(const arx::MatrixBase<OrgDerived>& org, const arx::MatrixBase<DirDerived>& dir):
-      mOrigin(org), mDirection(dir) {}
-
-    const Vector3f& getOrigin() const { 
-      return mOrigin;
-    }
-
-    float getOrigin(int index) const { 
-      return mOrigin[index];
-    }
-
-    const Vector3f& getDirection() const { 
-      return mDirection;
-    }
-
-    float getDirection(int index) const { 
-      return mDirection[index];
-    }
-
-    template<class Derived>
-    void setOrigin(const arx::MatrixBase<Derived>& org) {
-      mOrigin = org;
-    }
-
-    void setOrigin(int index, float value) {
-      mOrigin[index] = value;
-    }
-
-    template<class Derived>
-    void setDirection(const arx::MatrixBase<Derived>& dir) {
-      mDirection = dir;
-    }
-
-    void setDirection(int index, float value) {
-      mDirection[index] = value;
-    }
-
-  private:
-    ALIGN(16) arx::Vector3f mDirection; /**< Ray direction (not necessarily of unit length). */
-    ALIGN(16) arx::Vector3f mOrigin; /**< Ray origin. */
-  };
-
-} // namespace smart
-
-#endif // __SMART_RAY_H__
+#ifndef __SMART_RAY_H__
+#define __SMART_RAY_H__
+
+#include "common.h"
+#include <algorithm>
+#include "Utility.h"
+
+namespace smart {
+  namespace detail {
+    /** @returns reciprocal of the given ray direction coordinate, used by
+     * SIMD traversal routines that can't branch on near-zero coordinates.
+     * Only zero and values so close to it that the reciprocal would overflow
+     * are replaced with a huge value of the same sign as the one returned by
+     * directionSign. Unlike infinity, it gives zero when multiplied by zero,
+     * not NaN. */
+    FORCEINLINE float safeReciprocal(float d) {
+      const float huge = 1.0e30f;
+      if(abs(d) > 1.0f / huge)
+        return 1.0f / d;
+      else
+        return (d < 0) ? -huge : huge;
+    }
+
+    /** @returns 1 if the given ray direction coordinate is negative, 0 
+     * otherwise. Note that negative zero is not negative. */
+    FORCEINLINE int directionSign(float d) {
+      return (d < 0) ? 1 : 0;
+    }
+
+  } // namespace detail
+
+  /** Structure representing a single ray. 
+   *
+   * Along with the direction, stores its reciprocal and per-axis signs, so
+   * that traversal routines do not have to divide. These are updated each 
+   * time the direction is set. */
+  ALIGN(32) struct Ray {
+  public:
+    Ray() {}
+
+    template<class DirDerived, class OrgDerived>
+    Ray(const arx::MatrixBase<OrgDerived>& org, const arx::MatrixBase<DirDerived>& dir):
+      mOrigin(org), mDirection(dir) {
+      updateInvDirection();
+    }
+
+    const Vector3f& getOrigin() const { 
+      return mOrigin;
+    }
+
+    float getOrigin(int index) const { 
+      return mOrigin[index];
+    }
+
+    const Vector3f& getDirection() const { 
+      return mDirection;
+    }
+
+    float getDirection(int index) const { 
+      return mDirection[index];
+    }
+
+    /** @returns reciprocal of the ray direction. Zero coordinates of the
+     * direction give infinite reciprocals. */
+    const Vector3f& getInvDirection() const { 
+      return mInvDirection;
+    }
+
+    float getInvDirection(int index) const { 
+      return mInvDirection[index];
+    }
+
+    /** @returns 1 if index-th coordinate of ray direction is negative, 0 
+     * otherwise. In BSP tree traversal it's the offset of the near child 
+     * from the left one. */
+    int getDirectionSign(int index) const { 
+      return mDirectionSign[index];
+    }
+
+#ifdef SMART_USE_WATERTIGHT_INTERSECTION
+    /** @returns index of the axis that is mapped to the index-th axis of the
+     * ray space for watertight intersection test. Ray space z axis is the 
+     * dominant axis of ray direction. */
+    int getShearAxis(int index) const {
+      return mShearAxis[index];
+    }
+
+    /** @returns shear constants for watertight intersection test, i.e. 
+     * x and y components of ray direction divided by its z component, and
+     * reciprocal z component, all in ray space. */
+    float getShear(int index) const {
+      return mShear[index];
+    }
+#endif
+
+    template<class Derived>
+    void setOrigin(const arx::MatrixBase<Derived>& org) {
+      mOrigin = org;
+    }
+
+    void setOrigin(int index, float value) {
+      mOrigin[index] = value;
+    }
+
+    template<class Derived>
+    void setDirection(const arx::MatrixBase<Derived>& dir) {
+      mDirection = dir;
+      updateInvDirection();
+    }
+
+    void setDirection(int index, float value) {
+      mDirection[index] = value;
+      updateInvDirection(index);
+#ifdef SMART_USE_WATERTIGHT_INTERSECTION
+      updateShear();
+#endif
+    }
+
+  private:
+    void updateInvDirection(int index) {
+      mInvDirection[index] = 1.0f / mDirection[index];
+      mDirectionSign[index] = detail::directionSign(mDirection[index]);
+    }
+
+    void updateInvDirection() {
+      for(int i = 0; i < 3; i++)
+        updateInvDirection(i);
+#ifdef SMART_USE_WATERTIGHT_INTERSECTION
+      updateShear();
+#endif
+    }
+
+#ifdef SMART_USE_WATERTIGHT_INTERSECTION
+    void updateShear() {
+      Vector3f absDirection = mDirection.cwise().abs();
+      int kz;
+      if(absDirection[0] > absDirection[1]) {
+        if(absDirection[0] > absDirection[2]) kz = 0; else kz = 2;
+      } else {
+        if(absDirection[1] > absDirection[2]) kz = 1; else kz = 2;
+      }
+      int kx = fastModulo3(kz + 1);
+      int ky = fastModulo3(kz + 2);
+
+      /* Swap kx and ky to preserve winding. */
+      if(mDirection[kz] < 0)
+        std::swap(kx, ky);
+
+      mShearAxis[0] = kx;
+      mShearAxis[1] = ky;
+      mShearAxis[2] = kz;
+      mShear[0] = mDirection[kx] / mDirection[kz];
+      mShear[1] = mDirection[ky] / mDirection[kz];
+      mShear[2] = 1.0f / mDirection[kz];
+    }
+#endif
+
+    ALIGN(16) arx::Vector3f mDirection; /**< Ray direction (not necessarily of unit length). */
+    ALIGN(16) arx::Vector3f mOrigin; /**< Ray origin. */
+    ALIGN(16) arx::Vector3f mInvDirection; /**< Clamped reciprocal of ray direction. */
+    int mDirectionSign[3]; /**< Signs of ray direction coordinates, 1 for negative. */
+#ifdef SMART_USE_WATERTIGHT_INTERSECTION
+    int mShearAxis[3]; /**< Ray space axis permutation. */
+    float mShear[3]; /**< Ray space shear constants. */
+#endif
+  };
+
+} // namespace smart
+
+#endif // __SMART_RAY_H__
@@ -0,0 +1,158 @@
+#ifndef __SMART_RAYBUNDLE_H__
+#define __SMART_RAYBUNDLE_H__
+
+#include "common.h"
+#include <arx/static_assert.h>
+#include "RayPacket.h"
+
+#ifdef SMART_USE_SSE
+
+namespace smart {
+// -------------------------------------------------------------------------- //
+// RayBundle
+// -------------------------------------------------------------------------- //
+  /** Square bundle of SMART_RAY_BUNDLE_SIZE x SMART_RAY_BUNDLE_SIZE rays,
+   * stored as a set of 2x2 ray packets.
+   *
+   * Besides the rays themselves, bundle stores per-axis bounds of ray origins
+   * and reciprocal ray directions. These are used for interval arithmetic
+   * culling of BSP tree nodes for the whole bundle at once. */
+  ALIGN(16) class RayBundle {
+  public:
+    STATIC_ASSERT((SMART_RAY_BUNDLE_SIZE > 0 && SMART_RAY_BUNDLE_SIZE % 2 == 0));
+
+    enum {
+      SIDE = SMART_RAY_BUNDLE_SIZE,
+      SIZE = SIDE * SIDE,
+      PACKET_COUNT = SIZE / RayPacket::SIZE
+    };
+
+    RayBundle() {}
+
+    /** @returns horizontal offset of a ray with the given index inside the
+     * bundle's square. Rays of a single packet form a 2x2 square. */
+    static int getRayX(int index) {
+      return 2 * ((index / RayPacket::SIZE) % (SIDE / 2)) + (index & 1);
+    }
+
+    /** @returns vertical offset of a ray with the given index inside the
+     * bundle's square. */
+    static int getRayY(int index) {
+      return 2 * ((index / RayPacket::SIZE) / (SIDE / 2)) + ((index >> 1) & 1);
+    }
+
+    /** Sets a ray with the given index. Note that updateBounds must be called
+     * after all the rays are set. */
+    void setRay(int index, const Vector3f& origin, const Vector3f& direction) {
+      assert(index >= 0 && index < SIZE);
+      mPackets[index / RayPacket::SIZE].setRay(index % RayPacket::SIZE, origin, direction);
+    }
+
+    /** Recomputes origin and reciprocal direction bounds and direction signs
+     * of this bundle. With watertight intersection test, also updates shear
+     * constants of all the packets. */
+    void updateBounds() {
+      for(int k = 0; k < 3; k++) {
+        __m128 originMin = mPackets[0].getOrigin(k);
+        __m128 originMax = originMin;
+        __m128 invDirectionMin = mPackets[0].getInvDirection(k);
+        __m128 invDirectionMax = invDirectionMin;
+        int sign = mPackets[0].getDirectionSign(k);
+
+        for(int i = 1; i < PACKET_COUNT; i++) {
+          originMin = _mm_min_ps(originMin, mPackets[i].getOrigin(k));
+          originMax = _mm_max_ps(originMax, mPackets[i].getOrigin(k));
+          invDirectionMin = _mm_min_ps(invDirectionMin, mPackets[i].getInvDirection(k));
+          invDirectionMax = _mm_max_ps(invDirectionMax, mPackets[i].getInvDirection(k));
+          if(mPackets[i].getDirectionSign(k) != sign)
+            sign = -1;
+        }
+
+        mOriginMin[k] = detail::sseHorizontalMin(originMin);
+        mOriginMax[k] = detail::sseHorizontalMax(originMax);
+        mInvDirectionMin[k] = detail::sseHorizontalMin(invDirectionMin);
+        mInvDirectionMax[k] = detail::sseHorizontalMax(invDirectionMax);
+        mSigns[k] = sign;
+      }
+
+#ifdef SMART_USE_WATERTIGHT_INTERSECTION
+      mShearValid = true;
+      for(int i = 0; i < PACKET_COUNT; i++) {
+        mPackets[i].updateShear();
+        mShearValid &= mPackets[i].isShearValid();
+      }
+#endif
+    }
+
+    /** @returns packet with the given index. */
+    const RayPacket& getPacket(int index) const {
+      assert(index >= 0 && index < PACKET_COUNT);
+      return mPackets[index];
+    }
+
+    float getOriginMin(int k) const {
+      return mOriginMin[k];
+    }
+
+    float getOriginMax(int k) const {
+      return mOriginMax[k];
+    }
+
+    float getInvDirectionMin(int k) const {
+      return mInvDirectionMin[k];
+    }
+
+    float getInvDirectionMax(int k) const {
+      return mInvDirectionMax[k];
+    }
+
+    /** @returns 0 if all the rays of this bundle have non-negative k-th
+     * direction coordinate, 1 if all of them are negative, and -1 if signs
+     * differ. */
+    int getDirectionSign(int k) const {
+      return mSigns[k];
+    }
+
+    /** @returns true if all the rays of this bundle have the same direction
+     * signs, i.e. this bundle can be traced through a BSP tree as a whole. */
+    bool isCoherent() const {
+#ifdef SMART_USE_WATERTIGHT_INTERSECTION
+      if(!mShearValid)
+        return false;
+#endif
+      return mSigns[0] >= 0 && mSigns[1] >= 0 && mSigns[2] >= 0;
+    }
+
+  private:
+    RayPacket mPackets[PACKET_COUNT];
+
+    float mOriginMin[3];
+    float mOriginMax[3];
+    float mInvDirectionMin[3];
+    float mInvDirectionMax[3];
+    int mSigns[3];
+#ifdef SMART_USE_WATERTIGHT_INTERSECTION
+    bool mShearValid;
+#endif
+  };
+
+
+// -------------------------------------------------------------------------- //
+// RayBundleState
+// -------------------------------------------------------------------------- //
+  /** Per-ray state of a ray bundle traversal. */
+  ALIGN(16) struct RayBundleState {
+    ALIGN(16) float segmentMin[RayBundle::SIZE];
+    ALIGN(16) float segmentMax[RayBundle::SIZE];
+    ALIGN(16) float beta[RayBundle::SIZE];
+    ALIGN(16) float gamma[RayBundle::SIZE];
+    int triangleIds[RayBundle::SIZE];
+    int liveMasks[RayBundle::PACKET_COUNT]; /**< Lane masks of rays that are still searched for intersection. */
+    int hitMasks[RayBundle::PACKET_COUNT];  /**< Lane masks of rays that have hit something. */
+  };
+
+} // namespace smart
+
+#endif // SMART_USE_SSE
+
+#endif // __SMART_RAYBUNDLE_H__
@@ -0,0 +1,230 @@
+#ifndef __SMART_RAYPACKET_H__
+#define __SMART_RAYPACKET_H__
+
+#include "common.h"
+#include <limits>
+#include <algorithm>
+#include "Ray.h"
+
+#ifdef SMART_USE_SSE
+
+namespace smart {
+  namespace detail {
+    /** @returns SSE mask with all bits set in lanes that are set in the given
+     * 4-bit lane mask, as returned by _mm_movemask_ps. */
+    FORCEINLINE __m128 laneMask(int mask) {
+      assert(mask >= 0 && mask <= 0xF);
+
+      ALIGN(SMART_CACHELINE) static const unsigned int sLaneMasks[16][4] = {
+        {0x00000000, 0x00000000, 0x00000000, 0x00000000},
+        {0xFFFFFFFF, 0x00000000, 0x00000000, 0x00000000},
+        {0x00000000, 0xFFFFFFFF, 0x00000000, 0x00000000},
+        {0xFFFFFFFF, 0xFFFFFFFF, 0x00000000, 0x00000000},
+        {0x00000000, 0x00000000, 0xFFFFFFFF, 0x00000000},
+        {0xFFFFFFFF, 0x00000000, 0xFFFFFFFF, 0x00000000},
+        {0x00000000, 0xFFFFFFFF, 0xFFFFFFFF, 0x00000000},
+        {0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0x00000000},
+        {0x00000000, 0x00000000, 0x00000000, 0xFFFFFFFF},
+        {0xFFFFFFFF, 0x00000000, 0x00000000, 0xFFFFFFFF},
+        {0x00000000, 0xFFFFFFFF, 0x00000000, 0xFFFFFFFF},
+        {0xFFFFFFFF, 0xFFFFFFFF, 0x00000000, 0xFFFFFFFF},
+        {0x00000000, 0x00000000, 0xFFFFFFFF, 0xFFFFFFFF},
+        {0xFFFFFFFF, 0x00000000, 0xFFFFFFFF, 0xFFFFFFFF},
+        {0x00000000, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF},
+        {0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF}
+      };
+      return _mm_load_ps(reinterpret_cast<const float*>(sLaneMasks[mask]));
+    }
+
+    /** Per-lane select.
+     *
+     * @returns a where mask is set, b otherwise. */
+    FORCEINLINE __m128 sseSelect(__m128 mask, __m128 a, __m128 b) {
+      return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+
+    /** @returns per-lane absolute value. */
+    FORCEINLINE __m128 sseAbs(__m128 value) {
+      return _mm_andnot_ps(_mm_set1_ps(-0.0f), value);
+    }
+
+    /** @returns minimum of the four elements of the given vector. */
+    FORCEINLINE float sseHorizontalMin(__m128 value) {
+      value = _mm_min_ps(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 3, 0, 1)));
+      value = _mm_min_ps(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(1, 0, 3, 2)));
+      float result;
+      _mm_store_ss(&result, value);
+      return result;
+    }
+
+    /** @returns maximum of the four elements of the given vector. */
+    FORCEINLINE float sseHorizontalMax(__m128 value) {
+      value = _mm_max_ps(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 3, 0, 1)));
+      value = _mm_max_ps(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(1, 0, 3, 2)));
+      float result;
+      _mm_store_ss(&result, value);
+      return result;
+    }
+
+  } // namespace detail
+
+
+// -------------------------------------------------------------------------- //
+// RayPacket
+// -------------------------------------------------------------------------- //
+  /** Four rays stored in structure-of-arrays layout, ready to be processed
+   * with SSE instructions.
+   *
+   * Packet also stores reciprocal directions and direction signs, which are
+   * used during packet BSP tree traversal. Reciprocals of zero direction 
+   * components are replaced with a huge finite value of the same sign, so
+   * that a plane parallel to the ray is "infinitely far" along it, and 
+   * no NaNs come out of it. */
+  ALIGN(16) class RayPacket {
+  public:
+    enum {
+      SIZE = 4,
+      ALL = 0xF
+    };
+
+    RayPacket() {}
+
+    /** Sets a ray with the given index. */
+    void setRay(int index, const Ray& ray) {
+      setRay(index, ray.getOrigin(), ray.getDirection());
+    }
+
+    /** Sets a ray with the given index. */
+    void setRay(int index, const Vector3f& origin, const Vector3f& direction) {
+      assert(index >= 0 && index < SIZE);
+
+      for(int k = 0; k < 3; k++) {
+        /* Get rid of negative zeros, so that sign bits are consistent with
+         * reciprocals. */
+        float d = (direction[k] == 0.0f) ? 0.0f : direction[k];
+
+        mOrigin[k][index] = origin[k];
+        mDirection[k][index] = d;
+        mInvDirection[k][index] = detail::safeReciprocal(d);
+      }
+    }
+
+    /** @returns a single ray with the given index. */
+    Ray getRay(int index) const {
+      assert(index >= 0 && index < SIZE);
+      return Ray(
+        Vector3f(mOrigin[0][index], mOrigin[1][index], mOrigin[2][index]),
+        Vector3f(mDirection[0][index], mDirection[1][index], mDirection[2][index])
+      );
+    }
+
+    /** @returns k-th coordinates of ray origins. */
+    __m128 getOrigin(int k) const {
+      return _mm_load_ps(mOrigin[k]);
+    }
+
+    /** @returns k-th coordinates of ray directions. */
+    __m128 getDirection(int k) const {
+      return _mm_load_ps(mDirection[k]);
+    }
+
+    /** @returns k-th coordinates of reciprocal ray directions. */
+    __m128 getInvDirection(int k) const {
+      return _mm_load_ps(mInvDirection[k]);
+    }
+
+    /** @returns 0 if all the rays of this packet have non-negative k-th
+     * direction coordinate, 1 if all of them are negative, and -1 if signs
+     * differ. */
+    int getDirectionSign(int k) const {
+      int signs = _mm_movemask_ps(getDirection(k));
+      if(signs == 0)
+        return 0;
+      else if(signs == ALL)
+        return 1;
+      else
+        return -1;
+    }
+
+    /** @returns true if all the rays of this packet have the same direction
+     * signs, i.e. this packet can be traced through a BSP tree as a whole. */
+    bool isCoherent() const {
+      return getDirectionSign(0) >= 0 && getDirectionSign(1) >= 0 && getDirectionSign(2) >= 0;
+    }
+
+#ifdef SMART_USE_WATERTIGHT_INTERSECTION
+    /** Computes ray space axis permutation and shear constants for the 
+     * watertight intersection test, see Ray::getShearAxis. Must be called
+     * after all the rays are set, before the packet is intersected with 
+     * triangles.
+     *
+     * Permutation is shared by all the rays of the packet. Its z axis is the
+     * one with the largest minimal absolute direction coordinate, so it is
+     * dominant for the rays of a coherent packet, but not necessarily for 
+     * each of them. */
+    void updateShear() {
+      int kz = 0;
+      float dz = -1.0f;
+      for(int k = 0; k < 3; k++) {
+        float d = detail::sseHorizontalMin(detail::sseAbs(getDirection(k)));
+        if(d > dz) {
+          kz = k;
+          dz = d;
+        }
+      }
+      int kx = fastModulo3(kz + 1);
+      int ky = fastModulo3(kz + 2);
+
+      /* Swap kx and ky to preserve winding. Note that for coherent packets
+       * direction signs are the same for all the rays. */
+      if(mDirection[kz][0] < 0)
+        std::swap(kx, ky);
+
+      mShearAxis[0] = kx;
+      mShearAxis[1] = ky;
+      mShearAxis[2] = kz;
+      mShearValid = dz > 0.0f;
+      if(mShearValid) {
+        for(int i = 0; i < SIZE; i++) {
+          mShear[0][i] = mDirection[kx][i] / mDirection[kz][i];
+          mShear[1][i] = mDirection[ky][i] / mDirection[kz][i];
+          mShear[2][i] = 1.0f / mDirection[kz][i];
+        }
+      }
+    }
+
+    /** @returns index of the axis that is mapped to the index-th axis of the
+     * ray space. */
+    int getShearAxis(int index) const {
+      return mShearAxis[index];
+    }
+
+    /** @returns index-th shear constants of the rays, see Ray::getShear. */
+    __m128 getShear(int index) const {
+      return _mm_load_ps(mShear[index]);
+    }
+
+    /** @returns true if none of the rays has zero direction coordinate along
+     * the ray space z axis, i.e. this packet can be intersected with 
+     * triangles as a whole. */
+    bool isShearValid() const {
+      return mShearValid;
+    }
+#endif
+
+  private:
+    ALIGN(16) float mOrigin[3][SIZE];       /**< Ray origins, one row per coordinate. */
+    ALIGN(16) float mDirection[3][SIZE];    /**< Ray directions (not necessarily of unit length). */
+    ALIGN(16) float mInvDirection[3][SIZE]; /**< Reciprocal ray directions. */
+#ifdef SMART_USE_WATERTIGHT_INTERSECTION
+    ALIGN(16) float mShear[3][SIZE];        /**< Ray space shear constants. */
+    int mShearAxis[3];                      /**< Ray space axis permutation. */
+    bool mShearValid;                       /**< Whether shear constants are finite. */
+#endif
+  };
+
+} // namespace smart
+
+#endif // SMART_USE_SSE
+
+#endif // __SMART_RAYPACKET_H__
@@ -1,90 +1,154 @@
-#ifndef __SMART_RENDERHANDLER_H__
-#define __SMART_RENDERHANDLER_H__
-
-#include "common.h"
-#include "ImageTile.h"
-#include "RenderTask.h"
-#include "Tracer.h"
-
-namespace smart {
-// -------------------------------------------------------------------------- //
-// RenderHandler
-// -------------------------------------------------------------------------- //
-  class RenderHandler {
-  public:
-    void taskAdded(RenderTask* task);
-
-    void renderTile(RenderTask* task, const ImageTile& tile);
-  };
-
-
-// -------------------------------------------------------------------------- //
-// LocalRenderHandler
-// -------------------------------------------------------------------------- //
-  class LocalRenderHandler {
-  public:
-    void taskAdded(RenderTask* task) {
-      return;
-    }
-
-    void renderTile(RenderTask* task, const ImageTile& tile) {
-      float hRec = 1.0f / task->getImage().getHeight();
-      float wRec = 1.0f / task->getImage().getWidth();
-
-      int y = tile.getY();
-      float fy = y * hRec;
-      for(; y < tile.getY() + tile.getHeight(); y++, fy += hRec) {
-        int x = tile.getX();
-        float fx = x * wRec;
-        for(; x < tile.getX() + tile.getWidth(); x++, fx += wRec) {
-          TraceContext ctx;
-          ctx.setScene(task->getScene());
-          ctx.setDepth(0);
-          task->getScene()->getCameraShader()->initPrimaryRay(fx, fy, ctx);
-
-          //ctx.setRay(Ray(Vector3f(0,0,0),Vector3f(i,2*i,3*i).normalized()));
-
-          Tracer::trace(ctx);
-
-          task->getImage().setPixel(x, y, ctx.getRadiance().toColor3f());
-        }
-      }
-    }
-  };
-
-
-
-// -------------------------------------------------------------------------- //
-// AbstractRenderHandler
-// -------------------------------------------------------------------------- //
-  class AbstractRenderHandler {
-  public:
-    virtual void taskAdded(RenderTask* task) = 0;
-
-    virtual void renderTile(RenderTask* task, const ImageTile& tile) = 0;
-  };
-
-
-// -------------------------------------------------------------------------- //
-// RenderHandlerAdapter
-// -------------------------------------------------------------------------- //
-  template<class Handler>
-  class RenderHandlerAdapter: public AbstractRenderHandler {
-  public:
-    RenderHandlerAdapter(Handler handler): mHandler(handler) {}
-
-    virtual void taskAdded(RenderTask* task) {
-      mHandler.taskAdded(task);
-    }
-
-    virtual void renderTile(RenderTask* task, const ImageTile& tile) {
-      mHandler.renderTile(task, tile);
-    }
-
-  private:
-    Handler mHandler;
-  };
-
-} // namespace smart
-
-#endif // __SMART_RENDERHANDLER_H__
+#ifndef __SMART_RENDERHANDLER_H__
+#define __SMART_RENDERHANDLER_H__
+
+#include "common.h"
+#include "ImageTile.h"
+#include "RenderTask.h"
+#include "Tracer.h"
+#include "PacketTracer.h"
+#include "BundleTracer.h"
+
+namespace smart {
+// -------------------------------------------------------------------------- //
+// RenderHandler
+// -------------------------------------------------------------------------- //
+  class RenderHandler {
+  public:
+    void taskAdded(RenderTask* task);
+
+    void renderTile(RenderTask* task, const ImageTile& tile);
+  };
+
+
+// -------------------------------------------------------------------------- //
+// LocalRenderHandler
+// -------------------------------------------------------------------------- //
+  class LocalRenderHandler {
+  public:
+    void taskAdded(RenderTask* task) {
+      return;
+    }
+
+    void renderTile(RenderTask* task, const ImageTile& tile) {
+      float hRec = 1.0f / task->getImage().getHeight();
+      float wRec = 1.0f / task->getImage().getWidth();
+
+#ifdef SMART_USE_SSE
+      /* Trace the tile in ray bundles, and the remaining part that doesn't 
+       * fit into bundles - in packets. */
+      int xEnd = tile.getX() + tile.getWidth();
+      int yEnd = tile.getY() + tile.getHeight();
+      int xBundleEnd = xEnd - tile.getWidth() % RayBundle::SIDE;
+      int yBundleEnd = yEnd - tile.getHeight() % RayBundle::SIDE;
+
+      for(int y = tile.getY(); y < yBundleEnd; y += RayBundle::SIDE) {
+        for(int x = tile.getX(); x < xBundleEnd; x += RayBundle::SIDE)
+          renderBundle(task, x, y, wRec, hRec);
+        renderPackets(task, xBundleEnd, y, xEnd, y + RayBundle::SIDE, wRec, hRec);
+      }
+      renderPackets(task, tile.getX(), yBundleEnd, xEnd, yEnd, wRec, hRec);
+#else
+      for(int y = tile.getY(); y < tile.getY() + tile.getHeight(); y++)
+        for(int x = tile.getX(); x < tile.getX() + tile.getWidth(); x++)
+          renderPixel(task, x, y, wRec, hRec);
+#endif
+    }
+
+  private:
+#ifdef SMART_USE_SSE
+    /** Traces a square bundle of primary rays with the given upper left 
+     * corner, and stores the results in the image. */
+    void renderBundle(RenderTask* task, int x, int y, float wRec, float hRec) {
+      TraceContext ctx[RayBundle::SIZE];
+      for(int i = 0; i < RayBundle::SIZE; i++) {
+        ctx[i].setScene(task->getScene());
+        ctx[i].setDepth(0);
+        task->getScene()->getCameraShader()->initPrimaryRay((x + RayBundle::getRayX(i)) * wRec, (y + RayBundle::getRayY(i)) * hRec, ctx[i]);
+      }
+
+      BundleTracer::trace(ctx);
+
+      for(int i = 0; i < RayBundle::SIZE; i++)
+        task->getImage().setPixel(x + RayBundle::getRayX(i), y + RayBundle::getRayY(i), ctx[i].getRadiance().toColor3f());
+    }
+
+    /** Traces the given rectangle of the image in 2x2 pixel ray packets, and 
+     * odd row and column one ray at a time. */
+    void renderPackets(RenderTask* task, int x0, int y0, int x1, int y1, float wRec, float hRec) {
+      int xPacketEnd = x0 + ((x1 - x0) & ~1);
+      int yPacketEnd = y0 + ((y1 - y0) & ~1);
+
+      for(int y = y0; y < yPacketEnd; y += 2) {
+        for(int x = x0; x < xPacketEnd; x += 2) {
+          TraceContext ctx[RayPacket::SIZE];
+          for(int i = 0; i < RayPacket::SIZE; i++) {
+            ctx[i].setScene(task->getScene());
+            ctx[i].setDepth(0);
+            task->getScene()->getCameraShader()->initPrimaryRay((x + (i & 1)) * wRec, (y + (i >> 1)) * hRec, ctx[i]);
+          }
+
+          PacketTracer::trace(ctx);
+
+          for(int i = 0; i < RayPacket::SIZE; i++)
+            task->getImage().setPixel(x + (i & 1), y + (i >> 1), ctx[i].getRadiance().toColor3f());
+        }
+        for(int x = xPacketEnd; x < x1; x++) {
+          renderPixel(task, x, y, wRec, hRec);
+          renderPixel(task, x, y + 1, wRec, hRec);
+        }
+      }
+      for(int y = yPacketEnd; y < y1; y++)
+        for(int x = x0; x < x1; x++)
+          renderPixel(task, x, y, wRec, hRec);
+    }
+#endif
+
+    /** Traces a single primary ray and stores the result in the given pixel. */
+    void renderPixel(RenderTask* task, int x, int y, float wRec, float hRec) {
+      TraceContext ctx;
+      ctx.setScene(task->getScene());
+      ctx.setDepth(0);
+      task->getScene()->getCameraShader()->initPrimaryRay(x * wRec, y * hRec, ctx);
+
+      Tracer::trace(ctx);
+
+      task->getImage().setPixel(x, y, ctx.getRadiance().toColor3f());
+    }
+  };
+
+
+
+// -------------------------------------------------------------------------- //
+// AbstractRenderHandler
+// -------------------------------------------------------------------------- //
+  class AbstractRenderHandler {
+  public:
+    virtual void taskAdded(RenderTask* task) = 0;
+
+    virtual void renderTile(RenderTask* task, const ImageTile& tile) = 0;
+  };
+
+
+// -------------------------------------------------------------------------- //
+// RenderHandlerAdapter
+// -------------------------------------------------------------------------- //
+  template<class Handler>
+  class RenderHandlerAdapter: public AbstractRenderHandler {
+  public:
+    RenderHandlerAdapter(Handler handler): mHandler(handler) {}
+
+    virtual void taskAdded(RenderTask* task) {
+      mHandler.taskAdded(task);
+    }
+
+    virtual void renderTile(RenderTask* task, const ImageTile& tile) {
+      mHandler.renderTile(task, tile);
+    }
+
+  private:
+    Handler mHandler;
+  };
+
+} // namespace smart
+
+#endif // __SMART_RENDERHANDLER_H__
@@ -1,135 +1,320 @@
-#ifndef __SMART_RENDERERMANAGER_H__
-#define __SMART_RENDERERMANAGER_H__
-
-#include "common.h"
-#include <queue>
-#include "RenderTask.h"
-#include "RenderHandler.h"
-#include "Renderer.h"
-
-namespace smart {
-// -------------------------------------------------------------------------- //
-// RenderManager
-// -------------------------------------------------------------------------- //
-  class RenderManager: public arx::noncopyable {
-  public:
-    RenderManager() {
-      mIsDestroying = false;
-    }
-
-    ~RenderManager() {
-      mDataMutex.lock();
-
-      /* Set destruction flag. */
-      mIsDestroying = true;
-
-      /* Wake everybody. */
-      for(unsigned int i = 0; i < mRendererContexts.size(); i++)
-        mRendererContexts[i].mRenderer->wake();
-
-      mDataMutex.unlock();
-
-      /* Destroy all renderers.
-       * Note that destructors will wait for thread destruction. */
-      for(unsigned int i = 0; i < mRendererContexts.size(); i++)
-        delete mRendererContexts[i].mRenderer;
-    }
-
-    template<class Handler>
-    void addRenderer(Handler renderHandler) {
-      arx::mutex::scoped_lock lock(mDataMutex);
-
-      RendererContext ctx;
-      ctx.mCurrentlyRendering = NULL;
-      ctx.mRenderer = new RendererType(renderHandler, NotificationConsumer(this));
-      ctx.mRenderer->setId(static_cast<int>(mRendererContexts.size()));
-      mRendererContexts.push_back(ctx);
-    }
-
-    void addRenderTask(RenderTask* renderTask) {
-      arx::mutex::scoped_lock lock(mDataMutex);
-
-      renderTask->getTiler()->nextTask(renderTask->getScene(), 
-        renderTask->getImage(), static_cast<int>(mRendererContexts.size()));
-      mTasks.push(renderTask);
-      for(unsigned int i = 0; i < mRendererContexts.size(); i++)
-        mRendererContexts[i].mToNotify.push_back(renderTask);
-
-      if(mTasks.size() == 1)
-        for(unsigned int i = 0; i < mRendererContexts.size(); i++)
-          mRendererContexts[i].mRenderer->wake();
-    }
-
-  private:
-    class NotificationConsumer;
-
-    typedef Renderer<NotificationConsumer> RendererType;
-
-    class NotificationConsumer {
-    public:
-      NotificationConsumer(RenderManager* manager): mManager(manager) {}
-
-      void operator()(Renderer<NotificationConsumer>* renderer) {
-        arx::mutex::scoped_lock lock(mManager->mDataMutex);
-        if(mManager->mIsDestroying) {
-          renderer->addSuicideJob();
-        } else {
-          int id = renderer->getId();
-
-          RendererContext& ctx = mManager->mRendererContexts[id];
-          for(unsigned int i = 0; i < ctx.mToNotify.size(); i++)
-            renderer->addNewRenderTaskJob(ctx.mToNotify[i]);
-          ctx.mToNotify.clear();
-
-          if(ctx.mCurrentlyRendering != NULL)
-            ctx.mCurrentlyRendering->tilesRendered(1);
-
-          while(true) {
-            ImageTile tile;
-            RenderTask* currentTask = mManager->currentTask();
-            if(currentTask != NULL) {
-              if(currentTask->getTiler()->nextTile(id, tile)) {
-                ctx.mCurrentlyRendering = currentTask;
-                currentTask->tilesQueued(1);
-                renderer->addRenderTileJob(currentTask, tile);
-                break;
-              } else {
-                currentTask->noMoreTiles();
-                mManager->mTasks.pop();
-              }
-            } else {
-              ctx.mCurrentlyRendering = NULL;
-              break;
-            }
-          }
-        }
-      }
-    private:
-      RenderManager* mManager;
-    };
-
-    RenderTask* currentTask() {
-      /* We're called from locked context, so it's OK not to lock */
-      return mTasks.size() == 0 ? NULL : mTasks.front();
-    }
-
-    struct RendererContext {
-      Renderer<NotificationConsumer>* mRenderer;
-      std::vector<RenderTask*>  mToNotify;
-      RenderTask* mCurrentlyRendering;
-    };
-
-    friend class NotificationConsumer;
-
-    std::queue<RenderTask*> mTasks;
-    std::vector<RendererContext> mRendererContexts;
-    
-    bool mIsDestroying;
-
-    arx::mutex mDataMutex;
-  };
-
-
-} // namespace smart
-
-#endif // __SMART_RENDERERMANAGER_H__
+#ifndef __SMART_RENDERERMANAGER_H__
+#define __SMART_RENDERERMANAGER_H__
+
+#include "common.h"
+#include <algorithm>
+#include <deque>
+#include <vector>
+#include "Task.h"
+#include "RenderTask.h"
+#include "RenderHandler.h"
+#include "Renderer.h"
+#include "Atomic.h"
+
+namespace smart {
+// -------------------------------------------------------------------------- //
+// RenderManager
+// -------------------------------------------------------------------------- //
+  /** RenderManager owns the worker pool and distributes render tiles and
+   * generic tasks among the workers.
+   *
+   * Tiles of a render task are split into one range per worker. Workers 
+   * claim tiles from their own ranges, and from the others' once their own
+   * run dry, with a single atomic increment and without any locks, see 
+   * RenderTask::claimTile. While a worker may claim tiles of a task, it holds
+   * a reference to it, so that the task is not finished and deleted under 
+   * its feet. The manager lock is taken only for generic tasks, task 
+   * notifications, attaching to tasks and going to sleep. */
+  class RenderManager: public arx::noncopyable, public AbstractTaskRunner {
+  public:
+    /** Constructor.
+     *
+     * @param workerCount maximal number of renderers that can be added. */
+    RenderManager(int workerCount) {
+      assert(workerCount > 0);
+
+      mIsDestroying = false;
+      mRendererCount = 0;
+      for(int i = 0; i < workerCount; i++)
+        mRendererContexts.push_back(new RendererContext(i));
+    }
+
+    ~RenderManager() {
+      mDataMutex.lock();
+
+      /* Set destruction flag. */
+      mIsDestroying = true;
+
+      /* Wake everybody. */
+      for(int i = 0; i < mRendererCount; i++)
+        mRendererContexts[i]->mRenderer->wake();
+
+      mDataMutex.unlock();
+
+      /* Destroy all renderers.
+       * Note that destructors will wait for thread destruction. */
+      for(int i = 0; i < mRendererCount; i++)
+        delete mRendererContexts[i]->mRenderer;
+
+      for(unsigned int i = 0; i < mRendererContexts.size(); i++)
+        delete mRendererContexts[i];
+
+      /* Nobody is going to run tasks that are still pending. */
+      for(unsigned int i = 0; i < mPendingTasks.size(); i++)
+        delete mPendingTasks[i];
+    }
+
+    template<class Handler>
+    void addRenderer(Handler renderHandler) {
+      arx::mutex::scoped_lock lock(mDataMutex);
+      assert(mRendererCount < static_cast<int>(mRendererContexts.size()));
+
+      RendererContext* ctx = mRendererContexts[mRendererCount];
+      ctx->mRenderer = new RendererType(renderHandler, NotificationConsumer(this, ctx));
+      ctx->mRenderer->setId(mRendererCount);
+      mRendererCount++;
+    }
+
+    void addRenderTask(RenderTask* renderTask) {
+      int rendererCount;
+      {
+        arx::mutex::scoped_lock lock(mDataMutex);
+        rendererCount = mRendererCount;
+      }
+
+      /* Tiling may take a while, so it is done without locking out the
+       * workers. The task isn't visible to them until it is published
+       * below, and they pick their range modulo the range count anyway. */
+      renderTask->start(rendererCount);
+
+      arx::mutex::scoped_lock lock(mDataMutex);
+      mTasks.push_back(renderTask);
+      for(int i = 0; i < mRendererCount; i++) {
+        mRendererContexts[i]->mToNotify.push_back(renderTask);
+        mRendererContexts[i]->mNotifyPending.store(1);
+        mRendererContexts[i]->mRenderer->wake();
+      }
+
+      /* Drop our own reference, this finishes tasks without tiles. */
+      if(renderTask->release())
+        finishLocked(renderTask);
+    }
+
+    virtual void addTask(AbstractTask* task) {
+      arx::mutex::scoped_lock lock(mDataMutex);
+
+      mPendingTasks.push_back(task);
+      mPendingTaskCount.increment();
+      for(int i = 0; i < mRendererCount; i++)
+        mRendererContexts[i]->mRenderer->wake();
+    }
+
+    /** @returns number of workers in the pool. */
+    virtual int getWorkerCount() const {
+      return mRendererCount;
+    }
+
+  private:
+    class NotificationConsumer;
+    struct RendererContext;
+
+    typedef Renderer<NotificationConsumer> RendererType;
+
+    class NotificationConsumer {
+    public:
+      NotificationConsumer(RenderManager* manager, RendererContext* ctx): mManager(manager), mCtx(ctx) {}
+
+      void operator()(Renderer<NotificationConsumer>* renderer) {
+        if(mCtx->mCurrentlyRendering != NULL) {
+          mManager->release(mCtx->mCurrentlyRendering);
+          mCtx->mCurrentlyRendering = NULL;
+        }
+
+        while(true) {
+          /* Fast path - claim the next tile without any locks. Generic tasks
+           * go first, since somebody is usually waiting for them to 
+           * complete. */
+          bool idle = false;
+          if(mManager->mPendingTaskCount.load() == 0 && mCtx->mNotifyPending.load() == 0) {
+            if(nextTile(renderer))
+              return;
+            idle = true;
+          }
+
+          /* Slow path. */
+          arx::mutex::scoped_lock lock(mManager->mDataMutex);
+          if(mManager->mIsDestroying) {
+            renderer->addSuicideJob();
+            return;
+          }
+
+          /* Notifications go in a separate batch of jobs, so that we are 
+           * still attached to the tasks when taskAdded is called. */
+          if(notify(renderer))
+            return;
+
+          if(!mManager->mPendingTasks.empty()) {
+            /* Generic tasks may take long, don't hold the render tasks back
+             * in the meantime. */
+            detachAll();
+
+            renderer->addRunTaskJob(mManager->mPendingTasks.front());
+            mManager->mPendingTasks.pop_front();
+            mManager->mPendingTaskCount.decrement();
+            return;
+          }
+
+          if(!idle || attachAll())
+            continue;
+
+          /* Nothing to do, the renderer will sleep until woken. */
+          return;
+        }
+      }
+
+    private:
+      /** Claims the next tile from the attached tasks, detaching from the
+       * tasks that have no tiles left. Doesn't lock unless a task is 
+       * finished. */
+      bool nextTile(Renderer<NotificationConsumer>* renderer) {
+        while(!mCtx->mTasks.empty()) {
+          AttachedTask& attached = mCtx->mTasks.front();
+
+          int index;
+          ImageTile tile;
+          if(attached.mTask->claimTile(attached.mRange, attached.mExhausted, index, tile)) {
+            if(!attached.mClaimed) {
+              attached.mClaimed = true;
+              attached.mTask->tileClaimed();
+            }
+            mCtx->mCurrentlyRendering = attached.mTask;
+            renderer->addRenderTileJob(attached.mTask, index, tile);
+            return true;
+          }
+
+          RenderTask* task = attached.mTask;
+          mCtx->mTasks.pop_front();
+          mManager->release(task);
+        }
+        return false;
+      }
+
+      /** Attaches to the given task. Must be called under the manager lock.
+       *
+       * @returns true if attached, false if already attached or the task has
+       *   no tiles left. */
+      bool attach(RenderTask* task) {
+        for(unsigned int i = 0; i < mCtx->mTasks.size(); i++)
+          if(mCtx->mTasks[i].mTask == task)
+            return false;
+
+        if(task->isExhausted() || !task->acquire())
+          return false;
+
+        mCtx->mTasks.push_back(AttachedTask(task, mCtx->mIndex % task->getRangeCount()));
+        return true;
+      }
+
+      /** Attaches to all the tasks that still have tiles to claim. Must be 
+       * called under the manager lock.
+       *
+       * @returns true if attached to any. */
+      bool attachAll() {
+        bool result = false;
+        for(unsigned int i = 0; i < mManager->mTasks.size(); i++)
+          result |= attach(mManager->mTasks[i]);
+        return result;
+      }
+
+      /** Detaches from all the tasks. Must be called under the manager lock. */
+      void detachAll() {
+        for(unsigned int i = 0; i < mCtx->mTasks.size(); i++)
+          if(mCtx->mTasks[i].mTask->release())
+            mManager->finishLocked(mCtx->mTasks[i].mTask);
+        mCtx->mTasks.clear();
+      }
+
+      /** Attaches to the newly added tasks and hands their notifications over
+       * to the renderer. Must be called under the manager lock.
+       *
+       * @returns true if any jobs were added. */
+      bool notify(Renderer<NotificationConsumer>* renderer) {
+        bool result = false;
+        for(unsigned int i = 0; i < mCtx->mToNotify.size(); i++) {
+          if(attach(mCtx->mToNotify[i])) {
+            renderer->addNewRenderTaskJob(mCtx->mToNotify[i]);
+            result = true;
+          }
+        }
+        mCtx->mToNotify.clear();
+        mCtx->mNotifyPending.store(0);
+        return result;
+      }
+
+      RenderManager* mManager;
+      RendererContext* mCtx;
+    };
+
+    /** Drops a reference to the given task, finishing it if that was the 
+     * last one. */
+    void release(RenderTask* task) {
+      if(task->release()) {
+        arx::mutex::scoped_lock lock(mDataMutex);
+        finishLocked(task);
+      }
+    }
+
+    /** Forgets about the given task and lets endRendering return. Must be
+     * called under the manager lock. */
+    void finishLocked(RenderTask* task) {
+      mTasks.erase(std::find(mTasks.begin(), mTasks.end(), task));
+      for(int i = 0; i < mRendererCount; i++) {
+        std::vector<RenderTask*>& toNotify = mRendererContexts[i]->mToNotify;
+        toNotify.erase(std::remove(toNotify.begin(), toNotify.end(), task), toNotify.end());
+      }
+      task->finish();
+    }
+
+    /** Render task a worker is attached to, with its position in the task's
+     * tile ranges. */
+    struct AttachedTask {
+      AttachedTask(RenderTask* task, int range): mTask(task), mRange(range), mExhausted(0), mClaimed(false) {}
+
+      RenderTask* mTask;
+      int mRange;
+      int mExhausted;
+      bool mClaimed; /**< Whether we have claimed any tiles of the task. */
+    };
+
+    struct RendererContext {
+      RendererContext(int index): mIndex(index), mRenderer(NULL), mCurrentlyRendering(NULL) {}
+
+      /** Index of the context, same as renderer's id. Unlike the id, is 
+       * available before the renderer's thread starts. */
+      int mIndex;
+      Renderer<NotificationConsumer>* mRenderer;
+      std::vector<RenderTask*> mToNotify;
+      AtomicInt mNotifyPending; /**< Non-zero if mToNotify is not empty. */
+
+      /* These are accessed by the renderer's thread only. */
+      std::deque<AttachedTask> mTasks;
+      RenderTask* mCurrentlyRendering;
+    };
+
+    friend class NotificationConsumer;
+
+    std::deque<RenderTask*> mTasks; /**< Unfinished render tasks, in the order they were added. */
+    std::deque<AbstractTask*> mPendingTasks;
+    AtomicInt mPendingTaskCount; /**< Size of mPendingTasks, readable without the lock. */
+    std::vector<RendererContext*> mRendererContexts;
+    int mRendererCount;
+    
+    bool mIsDestroying;
+
+    arx::mutex mDataMutex;
+  };
+
+
+} // namespace smart
+
+#endif // __SMART_RENDERERMANAGER_H__
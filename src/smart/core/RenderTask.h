@@ -1,92 +1,235 @@
-#ifndef __ARX_RENDERTASK_H__
-#define __ARX_RENDERTASK_H__
-
-#include "common.h"
-#include <iostream>
-#include <arx/Utility.h>
-#include <arx/Collections.h>
-#include <arx/Thread.h>
-#include "RenderTiler.h"
-#include "MemoryArena.h"
-#include "ShadedScene.h"
-#include "ShaderManager.h"
-
-namespace smart {
-// -------------------------------------------------------------------------- //
-// RenderTask
-// -------------------------------------------------------------------------- //
-  class RenderTask: public arx::noncopyable {
-  public:
-    template<class Tiler>
-    RenderTask(ShadedScene* scene, arx::Image3f& image, Tiler tiler) {
-      mScene = scene;
-      mImage = image;
-      mTiler = new RenderTilerAdapter<Tiler>(tiler);
-
-      mTilesQueued = 0;
-      mTilesRendered = 0;
-      mNoMoreTiles = false;
-
-      mScene->claimOwnership();
-      mEndLock.lock();
-    }
-
-    ~RenderTask() {
-      delete mTiler;
-      mScene->releaseOwnership();
-    }
-
-    ShadedScene* getScene() const {
-      return mScene;
-    }
-
-    AbstractRenderTiler* getTiler() const {
-      return mTiler;
-    }
-
-    arx::Image3f& getImage() {
-      return mImage;
-    }
-
-  private:
-    friend class RenderManager;
-    friend class SmartCore;
-
-    void endRendering() {
-      /* Wait for being unlocked by the rendering thread. */
-      mEndLock.lock();
-      mEndLock.unlock();
-    }
-
-    /* These functions are called from locked context, so it's OK not to lock. */
-    void tilesQueued(int count) {
-      mTilesQueued += count;
-    }
-
-    void tilesRendered(int count) {
-      mTilesRendered += count;
-      if(mNoMoreTiles && mTilesQueued == mTilesRendered)
-        mEndLock.unlock();
-    }
-
-    void noMoreTiles() {
-      mNoMoreTiles = true;
-      if(mTilesQueued == mTilesRendered)
-        mEndLock.unlock();
-    }
-
-    ShadedScene* mScene;
-    AbstractRenderTiler* mTiler; 
-    arx::Image3f mImage; /**< This one has reference-counted implementation, so should store it by value... */
-    arx::mutex mEndLock;
-    arx::mutex mDataLock;
-
-    int mTilesQueued;
-    int mTilesRendered;
-    bool mNoMoreTiles;
-  };
-
-} // namespace smart
-
-
+#ifndef __ARX_RENDERTASK_H__
+#define __ARX_RENDERTASK_H__
+
+#include "common.h"
+#include <iostream>
+#include <arx/Utility.h>
+#include <arx/Collections.h>
+#include <arx/Thread.h>
+#include "RenderTiler.h"
+#include "MemoryArena.h"
+#include "ShadedScene.h"
+#include "ShaderManager.h"
+#include "Atomic.h"
+#include "Event.h"
+#include "Timer.h"
+
+namespace smart {
+// -------------------------------------------------------------------------- //
+// RenderStats
+// -------------------------------------------------------------------------- //
+  /** Timings of a finished render task, all in seconds. */
+  struct RenderStats {
+    RenderStats(): startLatency(0.0), renderTime(0.0), endLatency(0.0) {}
+
+    /** Time from the task being added to the first tile being claimed. */
+    double startLatency;
+
+    /** Time from the task being added to the last tile being rendered. */
+    double renderTime;
+
+    /** Time from the last tile being rendered to endRendering returning. */
+    double endLatency;
+  };
+
+
+// -------------------------------------------------------------------------- //
+// RenderTask
+// -------------------------------------------------------------------------- //
+  class RenderTask: public arx::noncopyable {
+  public:
+    template<class Tiler>
+    RenderTask(ShadedScene* scene, arx::Image3f& image, Tiler tiler) {
+      mScene = scene;
+      mImage = image;
+      mTiler = new RenderTilerAdapter<Tiler>(tiler);
+
+      mRanges = NULL;
+      mRangeCount = 0;
+      mTileTimes = NULL;
+
+      mScene->claimOwnership();
+    }
+
+    ~RenderTask() {
+      delete[] mTileTimes;
+      arx::aligned_free(mRanges);
+      delete mTiler;
+      mScene->releaseOwnership();
+    }
+
+    ShadedScene* getScene() const {
+      return mScene;
+    }
+
+    AbstractRenderTiler* getTiler() const {
+      return mTiler;
+    }
+
+    arx::Image3f& getImage() {
+      return mImage;
+    }
+
+    /** @returns true if all the tiles were rendered. Doesn't block. Note that
+     * endRendering must still be called. */
+    bool isFinished() const {
+      return mPending.load() == 0;
+    }
+
+  private:
+    friend class RenderManager;
+    friend class SmartCore;
+    template<class NotificationConsumer> friend class Renderer;
+
+    void endRendering() {
+      /* Wait for being signaled by the rendering thread. */
+      mEnd.wait();
+      mStats.endLatency = Timer::now() - mFinishTime;
+    }
+
+    /** @returns timings of the task. Must be called after endRendering. */
+    const RenderStats& getStats() const {
+      return mStats;
+    }
+
+    /** Range of tile indices handed to a single worker. Other workers steal
+     * from it once their own ranges run dry. Is aligned on a cache line, so 
+     * that workers don't contend on neighbouring ranges. Alignment is set on
+     * the first member, since GCC ignores it in front of the struct. */
+    struct TileRange {
+      ALIGN(SMART_CACHELINE) AtomicInt mNext;
+      int mEnd;
+    };
+
+    /** Splits the tiles among the given number of workers. Is called by the
+     * render manager once, before any of the workers sees the task. */
+    void start(int workerCount) {
+      STATIC_ASSERT((sizeof(TileRange) % SMART_CACHELINE == 0));
+
+      int tileCount = mTiler->nextTask(mScene, mImage, workerCount);
+      mTileTimes = new float[tileCount];
+
+      mRangeCount = workerCount;
+      /* Operator new doesn't respect the alignment of TileRange. */
+      mRanges = static_cast<TileRange*>(arx::aligned_malloc(workerCount * sizeof(TileRange), SMART_CACHELINE));
+      for(int i = 0; i < workerCount; i++) {
+        new (&mRanges[i]) TileRange();
+        mRanges[i].mNext.store(static_cast<int>(static_cast<long long>(tileCount) * i / workerCount));
+        mRanges[i].mEnd = static_cast<int>(static_cast<long long>(tileCount) * (i + 1) / workerCount);
+      }
+
+      /* One reference for each tile, and one for the render manager. */
+      mPending.store(tileCount + 1);
+      mStartTime = Timer::now();
+    }
+
+    /** Claims a tile to render. Doesn't lock.
+     *
+     * Ranges are tried in order starting with the given one, which is 
+     * normally the worker's own. Once claimed, an index is never handed out 
+     * again, so exhausted ranges stay exhausted, and the caller doesn't need
+     * to try them twice.
+     *
+     * @param range[in,out] range to start with. Is updated to the range the
+     *   tile was taken from.
+     * @param exhausted[in,out] number of ranges already found exhausted, 
+     *   starting from zero.
+     * @param index[out] index of the claimed tile.
+     * @param tile[out] claimed tile.
+     * @returns true if a tile was claimed, false if there are no tiles left. */
+    bool claimTile(int& range, int& exhausted, int& index, ImageTile& tile) {
+      while(exhausted < mRangeCount) {
+        index = mRanges[range].mNext.fetchAdd(1);
+        if(index < mRanges[range].mEnd) {
+          tile = mTiler->getTile(index);
+          return true;
+        }
+
+        exhausted++;
+        range = (range + 1) % mRangeCount;
+      }
+      return false;
+    }
+
+    /** @returns true if all the tiles were claimed. */
+    bool isExhausted() const {
+      for(int i = 0; i < mRangeCount; i++)
+        if(mRanges[i].mNext.load() < mRanges[i].mEnd)
+          return false;
+      return true;
+    }
+
+    int getRangeCount() const {
+      return mRangeCount;
+    }
+
+    /** Adds a reference that keeps the task from being finished. A worker 
+     * holds one while it may claim tiles of the task.
+     *
+     * @returns false if the task is already finished, in which case the 
+     *   reference is not added. */
+    bool acquire() {
+      while(true) {
+        int pending = mPending.load();
+        if(pending == 0)
+          return false;
+        if(mPending.compareExchange(pending, pending + 1))
+          return true;
+      }
+    }
+
+    /** Removes a reference. Rendered tile counts as one.
+     *
+     * @returns true if that was the last reference, in which case the caller
+     *   must call finish. */
+    bool release() {
+      return mPending.decrement() == 0;
+    }
+
+    /** Records the time the first tile was claimed. Is called by the 
+     * workers on their first claim, only the earliest call counts. */
+    void tileClaimed() {
+      if(mClaimed.compareExchange(0, 1))
+        mStats.startLatency = Timer::now() - mStartTime;
+    }
+
+    /** Records the time it took to render the given tile. Is called before
+     * the tile's reference is released. */
+    void tileRendered(int index, float time) {
+      mTileTimes[index] = time;
+    }
+
+    /** Unblocks endRendering. Note that the task may be deleted right away,
+     * so this must be the last thing done to it. */
+    void finish() {
+      mTiler->taskFinished(mTileTimes);
+
+      mFinishTime = Timer::now();
+      mStats.renderTime = mFinishTime - mStartTime;
+      mEnd.set();
+    }
+
+    ShadedScene* mScene;
+    AbstractRenderTiler* mTiler; 
+    arx::Image3f mImage; /**< This one has reference-counted implementation, so should store it by value... */
+    Event mEnd;
+
+    TileRange* mRanges;
+    int mRangeCount;
+    float* mTileTimes; /**< Render times of the tiles, in seconds. */
+
+    /** Number of unrendered tiles plus number of references held by the 
+     * workers and the render manager. Task is finished once it drops to 
+     * zero. */
+    AtomicInt mPending;
+
+    AtomicInt mClaimed; /**< Non-zero once the first tile was claimed. */
+    double mStartTime;
+    double mFinishTime;
+    RenderStats mStats;
+  };
+
+} // namespace smart
+
+
 #endif // __ARX_RENDERTASK_H__
\ No newline at end of file
@@ -1,98 +1,446 @@
-#ifndef __SMART_RENDERTILER_H__
-#define __SMART_RENDERTILER_H__
-
-#include "common.h"
-#include "ImageTile.h"
-
-namespace smart {
-// -------------------------------------------------------------------------- //
-// RenderTiler
-// -------------------------------------------------------------------------- //
-  class RenderTiler {
-  public:
-    void nextTask(ShadedScene* scene, arx::Image3f& image, int renderersCount);
-
-    bool nextTile(int rendererId, ImageTile& tile);
-  };
-
-
-// -------------------------------------------------------------------------- //
-// LinearTiler
-// -------------------------------------------------------------------------- //
-  class LinearTiler {
-  public:
-    LinearTiler(int tileSize): mTileSize(tileSize) {}
-
-    void nextTask(ShadedScene* scene, arx::Image3f& image, int renderersCount) {
-      mImageWidth = image.getWidth();
-      mImageHeight = image.getHeight();
-      mCols = (mImageHeight + mTileSize - 1) / mTileSize;
-      mRows = (mImageWidth + mTileSize - 1) / mTileSize;
-      mCol = 0;
-      mRow = 0;
-    }
-
-    bool nextTile(int rendererId, ImageTile& tile) {
-      if(mRow >= mRows) {
-        return false;
-      } else {
-        int x = mCol * mTileSize;
-        int y = mRow * mTileSize;
-        int w = std::min(x + mTileSize, mImageWidth) - x;
-        int h = std::min(y + mTileSize, mImageHeight) - y;
-        tile = ImageTile(x, y, w, h);
-
-        mCol++;
-        if(mCol > mCols) {
-          mCol = 0;
-          mRow++;
-        }
-
-        return true;
-      }
-    }
-
-  private:
-    int mTileSize;
-    int mRows;
-    int mCols;
-    int mImageWidth;
-    int mImageHeight;
-    int mRow;
-    int mCol;
-  };
-
-
-// -------------------------------------------------------------------------- //
-// AbstractRenderTiler
-// -------------------------------------------------------------------------- //
-  class AbstractRenderTiler: public arx::noncopyable {
-  public:
-    virtual void nextTask(ShadedScene* scene, arx::Image3f& image, int renderersCount) = 0;
-    virtual bool nextTile(int rendererId, ImageTile& tile) = 0;
-  };
-
-
-// -------------------------------------------------------------------------- //
-// RenderTilerAdapter
-// -------------------------------------------------------------------------- //
-  template<class Tiler>
-  class RenderTilerAdapter: public AbstractRenderTiler {
-  public:
-    RenderTilerAdapter(Tiler tiler): mTiler(tiler) {}
-    
-    virtual void nextTask(ShadedScene* scene, arx::Image3f& image, int renderersCount) {
-      mTiler.nextTask(scene, image, renderersCount);
-    }
-
-    virtual bool nextTile(int rendererId, ImageTile& tile) {
-      return mTiler.nextTile(rendererId, tile);
-    }
-
-  private:
-    Tiler mTiler;
-  };
-
-} // namespace smart
-
-#endif // __SMART_RENDERTILER_H__
+#ifndef __SMART_RENDERTILER_H__
+#define __SMART_RENDERTILER_H__
+
+#include "common.h"
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <arx/Utility.h>
+#include <arx/Thread.h>
+#include "ImageTile.h"
+
+namespace smart {
+// -------------------------------------------------------------------------- //
+// RenderTiler
+// -------------------------------------------------------------------------- //
+  /** RenderTiler concept. Tiler splits the image into tiles, and enumerates
+   * them. Workers claim tiles by index, so getTile is called from many 
+   * threads at once.
+   *
+   * Index space is split into renderersCount contiguous runs of nearly equal
+   * length, and each worker starts with its own run, in order, before 
+   * stealing from the others. So tiles that should be rendered first go to
+   * the beginning of the runs. */
+  class RenderTiler {
+  public:
+    /** Prepares the tiler for rendering of the given image.
+     *
+     * @returns number of tiles. */
+    int nextTask(ShadedScene* scene, arx::Image3f& image, int renderersCount);
+
+    /** @returns tile with the given index. Must not modify the tiler. */
+    ImageTile getTile(int index) const;
+
+    /** Is called once all the tiles are rendered.
+     *
+     * @param tileTimes render times of the tiles in seconds, indexed the
+     *   same way as the tiles. */
+    void taskFinished(const float* tileTimes);
+  };
+
+
+// -------------------------------------------------------------------------- //
+// LinearTiler
+// -------------------------------------------------------------------------- //
+  class LinearTiler {
+  public:
+    LinearTiler(int tileSize): mTileSize(tileSize) {}
+
+    int nextTask(ShadedScene* scene, arx::Image3f& image, int renderersCount) {
+      mImageWidth = image.getWidth();
+      mImageHeight = image.getHeight();
+      mCols = (mImageWidth + mTileSize - 1) / mTileSize;
+      mRows = (mImageHeight + mTileSize - 1) / mTileSize;
+      return mCols * mRows;
+    }
+
+    ImageTile getTile(int index) const {
+      int x = index % mCols * mTileSize;
+      int y = index / mCols * mTileSize;
+      int w = std::min(x + mTileSize, mImageWidth) - x;
+      int h = std::min(y + mTileSize, mImageHeight) - y;
+      return ImageTile(x, y, w, h);
+    }
+
+    void taskFinished(const float* /* tileTimes */) {}
+
+  private:
+    int mTileSize;
+    int mRows;
+    int mCols;
+    int mImageWidth;
+    int mImageHeight;
+  };
+
+
+// -------------------------------------------------------------------------- //
+// MortonCurve & HilbertCurve
+// -------------------------------------------------------------------------- //
+  /** Z-order curve. */
+  struct MortonCurve {
+    /** @returns position of the given cell along the curve that covers
+     * n x n grid, n being a power of two. */
+    static unsigned index(unsigned n, unsigned x, unsigned y) {
+      unsigned result = 0;
+      for(unsigned bit = 0; (1u << bit) < n; bit++) {
+        result |= ((x >> bit) & 1u) << (2 * bit);
+        result |= ((y >> bit) & 1u) << (2 * bit + 1);
+      }
+      return result;
+    }
+  };
+
+  /** Hilbert curve. Unlike Z-order curve, it has no long jumps, so 
+   * consecutive tiles are always adjacent. */
+  struct HilbertCurve {
+    /** @returns position of the given cell along the curve that covers
+     * n x n grid, n being a power of two. */
+    static unsigned index(unsigned n, unsigned x, unsigned y) {
+      unsigned result = 0;
+      for(unsigned s = n / 2; s > 0; s /= 2) {
+        unsigned rx = (x & s) != 0 ? 1 : 0;
+        unsigned ry = (y & s) != 0 ? 1 : 0;
+        result += s * s * ((3 * rx) ^ ry);
+
+        /* Rotate the quadrant so that the curve inside it starts at the 
+         * origin. */
+        if(ry == 0) {
+          if(rx == 1) {
+            x = n - 1 - x;
+            y = n - 1 - y;
+          }
+          std::swap(x, y);
+        }
+      }
+      return result;
+    }
+  };
+
+  namespace detail {
+    /** Enumerates the cells of the given grid in the order of the given 
+     * curve.
+     *
+     * @param cells[out] row-major cell indices, in curve order. */
+    template<class Curve>
+    void curveOrder(int cols, int rows, std::vector<int>& cells) {
+      unsigned n = 1;
+      while(n < static_cast<unsigned>(cols) || n < static_cast<unsigned>(rows))
+        n *= 2;
+
+      std::vector<std::pair<unsigned, int> > keys;
+      keys.reserve(cols * rows);
+      for(int y = 0; y < rows; y++)
+        for(int x = 0; x < cols; x++)
+          keys.push_back(std::make_pair(Curve::index(n, x, y), y * cols + x));
+      std::sort(keys.begin(), keys.end());
+
+      cells.resize(keys.size());
+      for(unsigned i = 0; i < keys.size(); i++)
+        cells[i] = keys[i].second;
+    }
+
+  } // namespace detail
+
+
+// -------------------------------------------------------------------------- //
+// CurveTiler
+// -------------------------------------------------------------------------- //
+  /** Tiler that enumerates square tiles along a space-filling curve. Each
+   * worker then renders a compact region of the image, and the tiles it 
+   * renders one after another are close in the scene, so the parts of the
+   * BSP tree they touch are likely to still be in cache. */
+  template<class Curve>
+  class CurveTiler {
+  public:
+    CurveTiler(int tileSize): mTileSize(tileSize) {}
+
+    int nextTask(ShadedScene* scene, arx::Image3f& image, int renderersCount) {
+      int cols = (image.getWidth() + mTileSize - 1) / mTileSize;
+      int rows = (image.getHeight() + mTileSize - 1) / mTileSize;
+
+      std::vector<int> cells;
+      detail::curveOrder<Curve>(cols, rows, cells);
+
+      mTiles.resize(cells.size());
+      for(unsigned i = 0; i < cells.size(); i++) {
+        int x = cells[i] % cols * mTileSize;
+        int y = cells[i] / cols * mTileSize;
+        mTiles[i] = ImageTile(x, y, std::min(x + mTileSize, image.getWidth()) - x, std::min(y + mTileSize, image.getHeight()) - y);
+      }
+      return static_cast<int>(mTiles.size());
+    }
+
+    ImageTile getTile(int index) const {
+      return mTiles[index];
+    }
+
+    void taskFinished(const float* /* tileTimes */) {}
+
+  private:
+    int mTileSize;
+    std::vector<ImageTile> mTiles;
+  };
+
+  typedef CurveTiler<MortonCurve> MortonTiler;
+  typedef CurveTiler<HilbertCurve> HilbertTiler;
+
+
+// -------------------------------------------------------------------------- //
+// TileCostMap
+// -------------------------------------------------------------------------- //
+  /** Per-cell render times of the last finished frame, to be used by the
+   * CostTiler of the next one. Must outlive the tilers that use it. Is 
+   * thread-safe, since a frame may finish on a worker thread while the next
+   * one is being started. */
+  class TileCostMap: private arx::noncopyable {
+  public:
+    TileCostMap(): mCols(0), mRows(0) {}
+
+    /** @param costs[out] row-major cell costs, in seconds.
+     * @returns false if there are no costs recorded for a grid of the
+     *   given size. */
+    bool getCosts(int cols, int rows, std::vector<float>& costs) const {
+      arx::mutex::scoped_lock lock(mMutex);
+      if(cols != mCols || rows != mRows || mCosts.empty())
+        return false;
+      costs = mCosts;
+      return true;
+    }
+
+    void setCosts(int cols, int rows, const std::vector<float>& costs) {
+      arx::mutex::scoped_lock lock(mMutex);
+      mCols = cols;
+      mRows = rows;
+      mCosts = costs;
+    }
+
+    void clear() {
+      setCosts(0, 0, std::vector<float>());
+    }
+
+  private:
+    mutable arx::mutex mMutex;
+    int mCols, mRows;
+    std::vector<float> mCosts;
+  };
+
+
+// -------------------------------------------------------------------------- //
+// CostTiler
+// -------------------------------------------------------------------------- //
+  /** Tiler that uses render times of the previous frame to balance the 
+   * load. 
+   *
+   * Cells that took more than splitFactor times the mean are split into
+   * quadrants, down to the ray bundle size, so that a single expensive tile
+   * doesn't stall the end of the frame. Tiles are then grouped into cost
+   * buckets, each one half as expensive as the previous, and every bucket
+   * is dealt to the workers in contiguous pieces of the Hilbert curve. So
+   * the expensive tiles are rendered first, the cheap ones fill the gaps at
+   * the end, and the tiles a worker renders one after another stay close 
+   * in the image. Without history, tiles are enumerated along the Hilbert 
+   * curve. */
+  class CostTiler {
+  public:
+    CostTiler(TileCostMap* costs, int tileSize, float splitFactor = SMART_COST_TILER_SPLIT_FACTOR): 
+      mCosts(costs), mTileSize(tileSize), mSplitFactor(splitFactor) {}
+
+    int nextTask(ShadedScene* scene, arx::Image3f& image, int renderersCount) {
+      mImageWidth = image.getWidth();
+      mImageHeight = image.getHeight();
+      mCols = (mImageWidth + mTileSize - 1) / mTileSize;
+      mRows = (mImageHeight + mTileSize - 1) / mTileSize;
+
+      std::vector<int> cells;
+      detail::curveOrder<HilbertCurve>(mCols, mRows, cells);
+
+      mTiles.clear();
+      mCells.clear();
+
+      std::vector<float> costs;
+      if(!mCosts->getCosts(mCols, mRows, costs)) {
+        for(unsigned i = 0; i < cells.size(); i++) {
+          mTiles.push_back(getCellTile(cells[i]));
+          mCells.push_back(cells[i]);
+        }
+        return static_cast<int>(mTiles.size());
+      }
+
+      float totalCost = 0.0f;
+      for(unsigned i = 0; i < costs.size(); i++)
+        totalCost += costs[i];
+      float splitCost = mSplitFactor * totalCost / costs.size();
+
+      /* Split the expensive cells, assuming that the cost is spread evenly
+       * over the cell. */
+      std::vector<EstimatedTile> tiles;
+      for(unsigned i = 0; i < cells.size(); i++) {
+        ImageTile cellTile = getCellTile(cells[i]);
+        float cost = costs[cells[i]];
+
+        int side = mTileSize;
+        float sideCost = cost;
+        while(sideCost > splitCost && side >= 2 * SMART_RAY_BUNDLE_SIZE) {
+          side = (side / 2 + SMART_RAY_BUNDLE_SIZE - 1) / SMART_RAY_BUNDLE_SIZE * SMART_RAY_BUNDLE_SIZE;
+          sideCost /= 4;
+        }
+
+        float costPerPixel = cost / (cellTile.getWidth() * cellTile.getHeight());
+        int xEnd = cellTile.getX() + cellTile.getWidth();
+        int yEnd = cellTile.getY() + cellTile.getHeight();
+        for(int y = cellTile.getY(); y < yEnd; y += side) {
+          for(int x = cellTile.getX(); x < xEnd; x += side) {
+            EstimatedTile tile;
+            tile.mTile = ImageTile(x, y, std::min(x + side, xEnd) - x, std::min(y + side, yEnd) - y);
+            tile.mCell = cells[i];
+            tile.mCost = costPerPixel * tile.mTile.getWidth() * tile.mTile.getHeight();
+            tiles.push_back(tile);
+          }
+        }
+      }
+
+      /* Bucket the tiles by cost. Tiles that cost nothing go to the last 
+       * bucket. */
+      float maxCost = 0.0f;
+      for(unsigned i = 0; i < tiles.size(); i++)
+        maxCost = std::max(maxCost, tiles[i].mCost);
+      for(unsigned i = 0; i < tiles.size(); i++) {
+        int bucket = 0;
+        float bucketCost = maxCost / 2;
+        while(bucket < costBucketCount - 1 && !(tiles[i].mCost > bucketCost)) {
+          bucket++;
+          bucketCost /= 2;
+        }
+        tiles[i].mBucket = bucket;
+      }
+
+      /* Stable sort keeps the tiles of a bucket in curve order. */
+      std::stable_sort(tiles.begin(), tiles.end(), LessBucket());
+
+      /* Deal each bucket in contiguous pieces into the runs the workers 
+       * start from, skipping the runs that are already full. */
+      int tileCount = static_cast<int>(tiles.size());
+      int runCount = std::max(renderersCount, 1);
+      std::vector<int> next(runCount), end(runCount);
+      for(int i = 0; i < runCount; i++) {
+        next[i] = static_cast<int>(static_cast<long long>(tileCount) * i / runCount);
+        end[i] = static_cast<int>(static_cast<long long>(tileCount) * (i + 1) / runCount);
+      }
+
+      mTiles.resize(tileCount);
+      mCells.resize(tileCount);
+      int run = 0;
+      for(int first = 0; first < tileCount; ) {
+        int last = first;
+        while(last < tileCount && tiles[last].mBucket == tiles[first].mBucket)
+          last++;
+        int pieceSize = (last - first + runCount - 1) / runCount;
+
+        int placed = 0;
+        for(int i = first; i < last; i++) {
+          while(next[run] == end[run]) {
+            run = (run + 1) % runCount;
+            placed = 0;
+          }
+          mTiles[next[run]] = tiles[i].mTile;
+          mCells[next[run]] = tiles[i].mCell;
+          next[run]++;
+          if(++placed == pieceSize) {
+            run = (run + 1) % runCount;
+            placed = 0;
+          }
+        }
+        if(placed != 0)
+          run = (run + 1) % runCount;
+        first = last;
+      }
+      return tileCount;
+    }
+
+    ImageTile getTile(int index) const {
+      return mTiles[index];
+    }
+
+    void taskFinished(const float* tileTimes) {
+      std::vector<float> costs(mCols * mRows, 0.0f);
+      for(unsigned i = 0; i < mTiles.size(); i++)
+        costs[mCells[i]] += tileTimes[i];
+      mCosts->setCosts(mCols, mRows, costs);
+    }
+
+  private:
+    enum {
+      costBucketCount = 8
+    };
+
+    struct EstimatedTile {
+      ImageTile mTile;
+      int mCell;
+      float mCost;
+      int mBucket;
+    };
+
+    struct LessBucket {
+      bool operator() (const EstimatedTile& a, const EstimatedTile& b) const {
+        return a.mBucket < b.mBucket;
+      }
+    };
+
+    ImageTile getCellTile(int cell) const {
+      int x = cell % mCols * mTileSize;
+      int y = cell / mCols * mTileSize;
+      return ImageTile(x, y, std::min(x + mTileSize, mImageWidth) - x, std::min(y + mTileSize, mImageHeight) - y);
+    }
+
+    TileCostMap* mCosts;
+    int mTileSize;
+    float mSplitFactor;
+    int mRows;
+    int mCols;
+    int mImageWidth;
+    int mImageHeight;
+    std::vector<ImageTile> mTiles;
+    std::vector<int> mCells; /**< Grid cell of each tile. */
+  };
+
+
+// -------------------------------------------------------------------------- //
+// AbstractRenderTiler
+// -------------------------------------------------------------------------- //
+  class AbstractRenderTiler: public arx::noncopyable {
+  public:
+    virtual int nextTask(ShadedScene* scene, arx::Image3f& image, int renderersCount) = 0;
+    virtual ImageTile getTile(int index) const = 0;
+    virtual void taskFinished(const float* tileTimes) = 0;
+
+    virtual ~AbstractRenderTiler() {}
+  };
+
+
+// -------------------------------------------------------------------------- //
+// RenderTilerAdapter
+// -------------------------------------------------------------------------- //
+  template<class Tiler>
+  class RenderTilerAdapter: public AbstractRenderTiler {
+  public:
+    RenderTilerAdapter(Tiler tiler): mTiler(tiler) {}
+    
+    virtual int nextTask(ShadedScene* scene, arx::Image3f& image, int renderersCount) {
+      return mTiler.nextTask(scene, image, renderersCount);
+    }
+
+    virtual ImageTile getTile(int index) const {
+      return mTiler.getTile(index);
+    }
+
+    virtual void taskFinished(const float* tileTimes) {
+      mTiler.taskFinished(tileTimes);
+    }
+
+  private:
+    Tiler mTiler;
+  };
+
+} // namespace smart
+
+#endif // __SMART_RENDERTILER_H__
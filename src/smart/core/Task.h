@@ -0,0 +1,108 @@
+#ifndef __SMART_TASK_H__
+#define __SMART_TASK_H__
+
+#include "common.h"
+#include <arx/Utility.h>
+#include <arx/Thread.h>
+#include "Atomic.h"
+#include "Event.h"
+
+namespace smart {
+// -------------------------------------------------------------------------- //
+// AbstractTask
+// -------------------------------------------------------------------------- //
+  /** Unit of work that can be handed over to the worker pool. */
+  class AbstractTask: private arx::noncopyable {
+  public:
+    virtual void run() = 0;
+
+    virtual ~AbstractTask() {}
+  };
+
+
+// -------------------------------------------------------------------------- //
+// AbstractTaskRunner
+// -------------------------------------------------------------------------- //
+  /** Something that runs tasks asynchronously, i.e. the worker pool. */
+  class AbstractTaskRunner {
+  public:
+    /** Queues the given task. Runner takes ownership of it and deletes it
+     * once it is run. Note that tasks are run before any of the pending
+     * render tiles. */
+    virtual void addTask(AbstractTask* task) = 0;
+
+    /** @returns number of threads that run tasks, i.e. the maximal number of
+     *   tasks that are run at the same time. */
+    virtual int getWorkerCount() const = 0;
+
+    virtual ~AbstractTaskRunner() {}
+  };
+
+  namespace detail {
+    /** Holder for the global task runner. */
+    template<class T>
+    struct TaskRunnerHolder {
+      static AbstractTaskRunner* sRunner;
+    };
+
+    template<class T>
+    AbstractTaskRunner* TaskRunnerHolder<T>::sRunner = NULL;
+
+  } // namespace detail
+
+  /** @returns global task runner, or NULL if there is none. In the latter case
+   * work that could be done in parallel is done on the calling thread. */
+  inline AbstractTaskRunner* getTaskRunner() {
+    return detail::TaskRunnerHolder<void>::sRunner;
+  }
+
+  /** Sets global task runner. Is called by SmartCore. */
+  inline void setTaskRunner(AbstractTaskRunner* runner) {
+    detail::TaskRunnerHolder<void>::sRunner = runner;
+  }
+
+
+// -------------------------------------------------------------------------- //
+// TaskGroup
+// -------------------------------------------------------------------------- //
+  /** TaskGroup tracks a set of tasks spawned to the task runner, so that the
+   * spawning thread can wait for their completion.
+   *
+   * Spawning thread's own work counts as one task, so the group is not
+   * finished until wait is called. Tasks must call taskDone as the last thing
+   * they do. Note that tasks of a group must never wait for each other,
+   * since the pool may have fewer threads than there are tasks. */
+  class TaskGroup: private arx::noncopyable {
+  public:
+    TaskGroup(AbstractTaskRunner* runner): mRunner(runner), mPending(1) {
+      assert(runner != NULL);
+    }
+
+    /** Hands the given task over to the task runner. */
+    void spawn(AbstractTask* task) {
+      mPending.increment();
+      mRunner->addTask(task);
+    }
+
+    /** Marks one of the tasks as done. */
+    void taskDone() {
+      if(mPending.decrement() == 0)
+        mDone.set();
+    }
+
+    /** Marks the spawning thread's work as done and waits for all the
+     * spawned tasks to finish. */
+    void wait() {
+      taskDone();
+      mDone.wait();
+    }
+
+  private:
+    AbstractTaskRunner* mRunner;
+    AtomicInt mPending;
+    Event mDone;
+  };
+
+} // namespace smart
+
+#endif // __SMART_TASK_H__
@@ -0,0 +1,54 @@
+#ifndef __SMART_TIMER_H__
+#define __SMART_TIMER_H__
+
+#include "common.h"
+
+#ifdef ARX_WIN32
+#  include <windows.h>
+#else
+#  include <time.h>
+#endif
+
+namespace smart {
+// -------------------------------------------------------------------------- //
+// Timer
+// -------------------------------------------------------------------------- //
+  /** High-resolution monotonic wall clock timer. */
+  class Timer {
+  public:
+    /** Constructor. Starts the timer. */
+    Timer() {
+      restart();
+    }
+
+    void restart() {
+      mStart = now();
+    }
+
+    /** @returns seconds elapsed since construction or the last restart. */
+    double getElapsed() const {
+      return now() - mStart;
+    }
+
+    /** @returns current time in seconds, counted from some unspecified
+     * moment in the past. */
+    static double now() {
+#ifdef ARX_WIN32
+      LARGE_INTEGER counter, frequency;
+      QueryPerformanceCounter(&counter);
+      QueryPerformanceFrequency(&frequency);
+      return static_cast<double>(counter.QuadPart) / static_cast<double>(frequency.QuadPart);
+#else
+      timespec time;
+      clock_gettime(CLOCK_MONOTONIC, &time);
+      return time.tv_sec + time.tv_nsec * 1.0e-9;
+#endif
+    }
+
+  private:
+    double mStart;
+  };
+
+} // namespace smart
+
+#endif // __SMART_TIMER_H__
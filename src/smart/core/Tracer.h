@@ -1,224 +1,500 @@
-#ifndef __SMART_TRACER_H__
-#define __SMART_TRACER_H__
-
-#include "common.h"
-#include "TraceContext.h"
-#include "IntersectionTests.h"
-
-namespace smart {
-// -------------------------------------------------------------------------- //
-// Tracer
-// -------------------------------------------------------------------------- //
-  class Tracer {
-  public:
-    /** Traces the ray through the given triangle (given as TriAccel structure). 
-     *
-     * In case there was no intersection, returns false without modifying any 
-     * of the parameters. 
-     *
-     * If there was an intersection, then returns true, clipping the segment and
-     * storing barycentric coordinates. Note that triangle id is unknown at this
-     * step, therefore it should be set by a callee. */
-    static bool trace(TraceContext& ctx, const TriAccel& triAccel) {
-      if(intersect(ctx.ray, ctx.segment, triAccel, ctx.barycentricCoord, SMART_TRACETRIACCEL_EPS)) {
-        ctx.tAlongRay = ctx.segment.getMax(); // TODO remove.
-        return true;
-      } else
-        return false;
-    }
-
-    struct StackElement {
-      StackElement(const BspNode* node, float segmentEnd): 
-        node(node), segmentEnd(segmentEnd) {}
-
-      const BspNode* node;
-      float segmentEnd;
-    };
-
-    template<class StaticStack>
-    static FORCEINLINE void trace(TraceContext& ctx, StaticStack& nodeStack, const BspNode*& nextNode, const BspNode* frontChild, const BspNode* backChild, float d) {
-      const float eps = SMART_TRACEBSPNODE_SEGMENTCONTAINS_EPS;
-      if(d < ctx.segment.getMin() - eps - eps * d) {
-        /* Case one, cull front side. */
-        nextNode = backChild;
-      } else if(ctx.segment.getMax() + eps + eps * d < d) {
-        /* Case two, cull back side. */
-        nextNode = frontChild;
-      } else {
-        /* Case three - traverse both sides in turn. 
-         * Push the back one into the stack. */
-        nodeStack.push_back(StackElement(backChild, ctx.segment.getMax()));
-
-        /* Then issue traversal of the front one. */
-        nextNode = frontChild;
-        ctx.segment.setMax(d);
-      }
-    }
-
-
-    /** Recursively traces the ray through the given BSP subtree. 
-     * Clips in case of a valid intersection. */
-    static bool trace(TraceContext& ctx, const ShadedModel* model, const BspNode* root) {
-      arx::StaticFastArray<StackElement, SMART_MAX_BSPTREE_DEPTH> nodeStack;
-     
-      const BspNode* node = root;
-
-      while(true) {
-        /* First deal with leaf nodes. */
-        if(node->isLeaf()) {
-          NodeTriangleIdList list = node->getTriangleIndexList();
-          bool success = false;
-          for(int i = 0; i < list.size(); ++i) {
-            if(trace(ctx, model->getTriAccel(list[i]))) {
-              ctx.triangleId = list[i];
-              success = true;
-            }
-          }
-          if(success)
-            return true;
-          else if(nodeStack.size() == 0)
-            return false;
-          else {
-            node = nodeStack.back().node;
-            ctx.segment.setMin(ctx.segment.getMax());
-            ctx.segment.setMax(nodeStack.back().segmentEnd);
-            nodeStack.pop_back();
-          }
-        } else {
-          /* TODO: this can be moved up, once for one call. */
-          if(abs(ctx.ray.getDirection(node->getSplitDim())) > SMART_TRACEBSPNODE_DIRECTIONGEZERO_EPS) {
-            /* Calculate distance along the ray to the splitting dimension. */
-            const float d = (node->getSplitCoord() - ctx.ray.getOrigin(node->getSplitDim())) / 
-              ctx.ray.getDirection(node->getSplitDim());
-
-            /* Trace children in order. */
-            if(ctx.ray.getDirection(node->getSplitDim()) > 0) {
-              trace(ctx, nodeStack, node, node->getLeftChild(), node->getRightChild(), d);
-            } else {
-              trace(ctx, nodeStack, node, node->getRightChild(), node->getLeftChild(), d);
-            }
-          } else {
-            /* Intersection impossible. */
-            const float d = (ctx.ray.getOrigin(node->getSplitDim()) < node->getSplitCoord()) ?
-              std::numeric_limits<float>::max() : -std::numeric_limits<float>::max();
-            trace(ctx, nodeStack, node, node->getLeftChild(), node->getRightChild(), d);
-          }
-        }
-      }
-    }
-
-    /** Traces the the ray through the given ShadedModel. 
-     * Clips in case of a valid intersection. */
-    static bool trace(TraceContext& ctx, const ShadedModel* model) {
-      Segment oldSegment = ctx.segment;
-      clip(ctx.segment, ctx.ray, model->getBoundingBox());
-
-      if(!ctx.segment.isEmpty<true, true>()) {
-        if(trace(ctx, model, model->getBspTree().getRoot())) {
-          ctx.model = model;
-          ctx.segment.setMin(oldSegment.getMin());
-          return true;
-        }
-      }
-
-      ctx.segment = oldSegment;
-      return false;
-    }
-
-    /** Traces the ray through the given CoreObject. 
-     * Clips in case of a valid intersection. */
-    static bool trace(TraceContext& ctx, const CoreObject* object) {
-      Ray oldRay = ctx.ray;
-
-      ctx.ray.setOrigin(transform(oldRay.getOrigin(), object->getWorldToLocalTransform()));
-      ctx.ray.setDirection((transform(Vector3f(oldRay.getOrigin() + oldRay.getDirection()), object->getWorldToLocalTransform()) - ctx.ray.getOrigin()).normalized()); /* TODO: separate matrix? */
-      bool traceResult = trace(ctx, object->getModel());
-      ctx.ray = oldRay;
-
-      if(traceResult)
-        ctx.object = object;
-
-      return traceResult;
-    }
-
-    static bool shadow(TraceContext& ctx) {
-      ctx.segment.setMin(SMART_TRACEUPPER_SEGMENTSTART_EPS);
-
-      for(int i = 0; i < ctx.scene->getObjectCount(); ++i)
-        if(trace(ctx, ctx.scene->getObject(i)))
-          return true;
-
-      return false;
-    }
-
-    /** Top-level tracing routine. Traces the given ray through the given scene. */
-    static void trace(TraceContext& ctx) {
-      ctx.segment = Segment(SMART_TRACEUPPER_SEGMENTSTART_EPS, std::numeric_limits<float>::max());
-
-      assert(abs(ctx.ray.getDirection().squaredNorm() - 1.0f) < 1.0e-5);
-
-      //clip(ctx.segment, ctx.ray, ctx.scene->getBoundingBox());
-
-      /*if(ctx.segment.isEmpty<true, true>()) {
-        ctx.scene->getEnvShader()->envShade(ctx);
-        return;
-      }*/
-
-      /* TODO - Upper Level BSP */
-      bool intersectionFound = false;
-      if(ctx.depth < 16) {
-        for(int i = 0; i < ctx.scene->getObjectCount(); ++i)
-          if(trace(ctx, ctx.scene->getObject(i)))
-            intersectionFound = true;
-      }
-
-      if(!intersectionFound) {
-        ctx.scene->getEnvShader()->envShade(ctx);
-        return;
-      }
-
-      ctx.model->getTriangleShader(ctx.triangleId)->surfShade(ctx);
-    }
-   
-  };
-
-  inline Radiance TraceContext::trace(const Vector3f& position, const Vector3f& direction, float k) const {
-    /* TODO check k & depth. */
-    TraceContext ctx;
-    ctx.setScene(scene);
-    ctx.setDepth(depth + 1);
-
-    ///*
-    // ctx.ray.setOrigin(transform(position, object->getLocalToWorldTransform()));
-    // ctx.ray.setDirection((transform(Vector3f(position + direction), object->getLocalToWorldTransform()) - ctx.ray.getOrigin()).normalized());
-    //*/
-
-    ctx.ray = Ray(position, direction);
-
-    Tracer::trace(ctx);
-    return ctx.getRadiance() * k;
-  }
-
-  inline Radiance TraceContext::illuminate(int lightIndex, const Vector3f& position, Vector3f& direction, float& distance) const {
-    Radiance result;
-    scene->getLightShaderByIndex(lightIndex)->illuminate(position, direction, distance, result);
-
-    // /* TODO reimplement trace. */
-    return result;
-  }
-
-  inline bool TraceContext::shadow(const Vector3f& position, const Vector3f& direction, float distance) const {
-    TraceContext ctx;
-    ctx.setScene(scene);
-    ctx.setDepth(0);
-    ctx.ray = Ray(position, direction);
-    ctx.segment = Segment(0, distance);
-
-    return Tracer::shadow(ctx);
-  }
-
-
-
-} // namespace smart
-
-#endif // __SMART_TRACER_H__
+#ifndef __SMART_TRACER_H__
+#define __SMART_TRACER_H__
+
+#include "common.h"
+#include "TraceContext.h"
+#include "IntersectionTests.h"
+
+namespace smart {
+// -------------------------------------------------------------------------- //
+// Tracer
+// -------------------------------------------------------------------------- //
+  class Tracer {
+  public:
+    /** Traces the ray through the given triangle (given as TriAccel structure). 
+     *
+     * In case there was no intersection, returns false without modifying any 
+     * of the parameters. 
+     *
+     * If there was an intersection, then returns true, clipping the segment and
+     * storing barycentric coordinates. Note that triangle id is unknown at this
+     * step, therefore it should be set by a callee. */
+    static bool trace(TraceContext& ctx, const TriAccel& triAccel) {
+      if(intersect(ctx.ray, ctx.segment, triAccel, ctx.barycentricCoord, SMART_TRACETRIACCEL_EPS)) {
+        ctx.tAlongRay = ctx.segment.getMax(); // TODO remove.
+        return true;
+      } else
+        return false;
+    }
+
+#ifdef SMART_USE_TRIACCEL4
+    /** Traces the ray through the four triangles of the given TriAccel4 block.
+     *
+     * @returns lane index of the hit triangle, or -1 if there was no
+     *   intersection. In the latter case none of the parameters are modified. */
+    static int trace(TraceContext& ctx, const TriAccel4& triAccel4) {
+      int lane = intersect(ctx.ray, ctx.segment, triAccel4, ctx.barycentricCoord, SMART_TRACETRIACCEL_EPS);
+      if(lane >= 0)
+        ctx.tAlongRay = ctx.segment.getMax();
+      return lane;
+    }
+#endif
+
+    struct StackElement {
+      StackElement(const BspNode* node, float segmentEnd): 
+        node(node), segmentEnd(segmentEnd) {}
+
+      const BspNode* node;
+      float segmentEnd;
+    };
+
+    template<class StaticStack>
+    static FORCEINLINE void trace(TraceContext& ctx, StaticStack& nodeStack, const BspNode*& nextNode, const BspNode* frontChild, const BspNode* backChild, float d) {
+      const float eps = SMART_TRACEBSPNODE_SEGMENTCONTAINS_EPS;
+      if(d < ctx.segment.getMin() - eps - eps * d) {
+        /* Case one, cull front side. */
+        nextNode = backChild;
+      } else if(ctx.segment.getMax() + eps + eps * d < d) {
+        /* Case two, cull back side. */
+        nextNode = frontChild;
+      } else {
+        /* Case three - traverse both sides in turn. 
+         * Push the back one into the stack. */
+        nodeStack.push_back(StackElement(backChild, ctx.segment.getMax()));
+
+        /* Then issue traversal of the front one. */
+        nextNode = frontChild;
+        ctx.segment.setMax(d);
+      }
+    }
+
+    /** Performs a single traversal step through the given inner node, 
+     * replacing it with the next node to visit. */
+    template<class StaticStack>
+    static FORCEINLINE void traverseInner(TraceContext& ctx, StaticStack& nodeStack, const BspNode*& node) {
+      const int dim = node->getSplitDim();
+      if(abs(ctx.ray.getDirection(dim)) > SMART_TRACEBSPNODE_DIRECTIONGEZERO_EPS) {
+        /* Calculate distance along the ray to the splitting plane. */
+        const float d = (node->getSplitCoord() - ctx.ray.getOrigin(dim)) * ctx.ray.getInvDirection(dim);
+
+        /* Trace children in order. */
+        const int sign = ctx.ray.getDirectionSign(dim);
+        trace(ctx, nodeStack, node, node->getLeftChild() + sign, node->getLeftChild() + (sign ^ 1), d);
+      } else {
+        /* Intersection impossible. */
+        const float d = (ctx.ray.getOrigin(dim) < node->getSplitCoord()) ?
+          std::numeric_limits<float>::max() : -std::numeric_limits<float>::max();
+        trace(ctx, nodeStack, node, node->getLeftChild(), node->getLeftChild() + 1, d);
+      }
+    }
+
+    /** Pops the next node to visit from the traversal stack, moving the
+     * segment past the current cell. 
+     *
+     * @returns false if the stack is empty. */
+    template<class StaticStack>
+    static FORCEINLINE bool popNode(TraceContext& ctx, StaticStack& nodeStack, const BspNode*& node) {
+      if(nodeStack.size() == 0)
+        return false;
+
+      node = nodeStack.back().node;
+      ctx.segment.setMin(ctx.segment.getMax());
+      ctx.segment.setMax(nodeStack.back().segmentEnd);
+      nodeStack.pop_back();
+      return true;
+    }
+
+
+    /** Traces the ray through the given BSP subtree. 
+     * Clips in case of a valid intersection. */
+    static bool trace(TraceContext& ctx, const ShadedModel* model, const BspNode* root) {
+      if(model->getBspTree().isLazy())
+        return traceBspNodes<true>(ctx, model, root);
+      else
+        return traceBspNodes<false>(ctx, model, root);
+    }
+
+    /** Traces the ray through the given BSP subtree, see trace.
+     *
+     * @param lazy whether the tree may contain deferred nodes. Eagerly built
+     *   trees never do, so their traversal doesn't check for them. */
+    template<bool lazy>
+    static FORCEINLINE bool traceBspNodes(TraceContext& ctx, const ShadedModel* model, const BspNode* root) {
+      arx::StaticFastArray<StackElement, SMART_MAX_BSPTREE_DEPTH> nodeStack;
+     
+      const BspNode* node = root;
+
+      while(true) {
+        /* First deal with leaf nodes. */
+        if(lazy && node->isDeferredAcquire()) {
+          BspTree::expand(node);
+        } else if(node->isLeaf()) {
+          NodeTriangleIdList list = node->getTriangleIndexList();
+          bool success = false;
+#ifdef SMART_USE_TRIACCEL4
+          const TriAccel4* blocks = model->getTriAccel4s(list);
+          for(int i = 0; i < TriAccel4::getBlockCount(list.size()); ++i) {
+            int lane = trace(ctx, blocks[i]);
+            if(lane >= 0) {
+              ctx.triangleId = list[i * TriAccel4::SIZE + lane];
+              success = true;
+            }
+          }
+#else
+          for(int i = 0; i < list.size(); ++i) {
+            if(trace(ctx, model->getTriAccel(list[i]))) {
+              ctx.triangleId = list[i];
+              success = true;
+            }
+          }
+#endif
+          if(success)
+            return true;
+          else if(!popNode(ctx, nodeStack, node))
+            return false;
+        } else
+          traverseInner(ctx, nodeStack, node);
+      }
+    }
+
+    /** Checks whether the ray segment is occluded by anything in the given
+     * BSP subtree. Stops at the first valid hit, and does not clip the
+     * segment. Note that the segment is used as traversal state and is 
+     * garbage on return. */
+    static bool occluded(TraceContext& ctx, const ShadedModel* model, const BspNode* root) {
+      if(model->getBspTree().isLazy())
+        return occludedBspNodes<true>(ctx, model, root);
+      else
+        return occludedBspNodes<false>(ctx, model, root);
+    }
+
+    /** Checks whether the ray segment is occluded by anything in the given
+     * BSP subtree, see occluded and traceBspNodes. */
+    template<bool lazy>
+    static FORCEINLINE bool occludedBspNodes(TraceContext& ctx, const ShadedModel* model, const BspNode* root) {
+      arx::StaticFastArray<StackElement, SMART_MAX_BSPTREE_DEPTH> nodeStack;
+     
+      const BspNode* node = root;
+
+      while(true) {
+        if(lazy && node->isDeferredAcquire()) {
+          BspTree::expand(node);
+        } else if(node->isLeaf()) {
+          /* Any hit will do, so there is no need to look for the nearest 
+           * one. */
+          NodeTriangleIdList list = node->getTriangleIndexList();
+#ifdef SMART_USE_TRIACCEL4
+          const TriAccel4* blocks = model->getTriAccel4s(list);
+          for(int i = 0; i < TriAccel4::getBlockCount(list.size()); ++i)
+            if(occludes(ctx.ray, ctx.segment, blocks[i], SMART_TRACETRIACCEL_EPS))
+              return true;
+#else
+          for(int i = 0; i < list.size(); ++i)
+            if(occludes(ctx.ray, ctx.segment, model->getTriAccel(list[i]), SMART_TRACETRIACCEL_EPS))
+              return true;
+#endif
+          if(!popNode(ctx, nodeStack, node))
+            return false;
+        } else {
+          /* Order still matters - near occluders are more likely to be 
+           * found first. */
+          traverseInner(ctx, nodeStack, node);
+        }
+      }
+    }
+
+    /** Traces the the ray through the given ShadedModel. 
+     * Clips in case of a valid intersection. */
+    static bool trace(TraceContext& ctx, const ShadedModel* model) {
+      Segment oldSegment = ctx.segment;
+      clip(ctx.segment, ctx.ray, model->getBoundingBox());
+
+      if(!ctx.segment.isEmpty<true, true>()) {
+        if(trace(ctx, model, model->getBspTree().getRoot())) {
+          ctx.model = model;
+          ctx.segment.setMin(oldSegment.getMin());
+          return true;
+        }
+      }
+
+      ctx.segment = oldSegment;
+      return false;
+    }
+
+    /** Traces the ray through the given CoreObject. 
+     * Clips in case of a valid intersection. */
+    static bool trace(TraceContext& ctx, const CoreObject* object) {
+      Ray oldRay = ctx.ray;
+
+      /* Direction is not normalized, so distances along the ray stay the
+       * same in object space. */
+      ctx.ray = Ray(object->transformPointToLocal(oldRay.getOrigin()), object->transformDirectionToLocal(oldRay.getDirection()));
+      bool traceResult = trace(ctx, object->getModel());
+      ctx.ray = oldRay;
+
+      if(traceResult)
+        ctx.object = object;
+
+      return traceResult;
+    }
+
+    /** Checks whether the ray segment is occluded by the given ShadedModel.
+     * Never modifies the segment. */
+    static bool occluded(TraceContext& ctx, const ShadedModel* model) {
+      Segment oldSegment = ctx.segment;
+      clip(ctx.segment, ctx.ray, model->getBoundingBox());
+
+      bool result = !ctx.segment.isEmpty<true, true>() && occluded(ctx, model, model->getBspTree().getRoot());
+
+      ctx.segment = oldSegment;
+      return result;
+    }
+
+    /** Checks whether the ray segment is occluded by the given CoreObject.
+     * Never modifies the segment. */
+    static bool occluded(TraceContext& ctx, const CoreObject* object) {
+      Ray oldRay = ctx.ray;
+
+      /* Direction is not normalized, so distances along the ray stay the
+       * same in object space. */
+      ctx.ray = Ray(object->transformPointToLocal(oldRay.getOrigin()), object->transformDirectionToLocal(oldRay.getDirection()));
+      bool result = occluded(ctx, object->getModel());
+      ctx.ray = oldRay;
+
+      return result;
+    }
+
+    /** Entry of an object into the ray segment, used for front to back 
+     * ordering of objects. */
+    struct ObjectEntry {
+      ObjectEntry() {}
+
+      ObjectEntry(float distance, int index): 
+        distance(distance), index(index) {}
+
+      bool operator<(const ObjectEntry& other) const {
+        return distance < other.distance;
+      }
+
+      float distance;
+      int index;
+    };
+
+    /** Traces the ray through the scene objects with the given indices.
+     * Objects are culled by their world space bounding boxes, and traced in
+     * order of their entry distance along the ray, so that the ones lying
+     * beyond the nearest hit are never traced. Clips in case of a valid 
+     * intersection. 
+     *
+     * Lists that are longer than SMART_TOPLEVEL_LINEAR_OBJECT_COUNT are 
+     * traced in the given order. */
+    template<class IndexArray>
+    static bool traceObjects(TraceContext& ctx, const IndexArray& indices) {
+      const ShadedScene* scene = ctx.scene;
+      const bool sorted = indices.size() <= SMART_TOPLEVEL_LINEAR_OBJECT_COUNT;
+
+      ObjectEntry entries[SMART_TOPLEVEL_LINEAR_OBJECT_COUNT];
+      int entryCount = 0;
+      bool success = false;
+      for(int i = 0; i < indices.size(); ++i) {
+        Segment segment = ctx.segment;
+        clip(segment, ctx.ray, scene->getObject(indices[i])->getBoundingBox());
+        if(segment.isEmpty<true, true>())
+          continue;
+
+        if(sorted) {
+          /* Insertion sort, lists are short. */
+          int k = entryCount++;
+          for(; k > 0 && segment.getMin() < entries[k - 1].distance; k--)
+            entries[k] = entries[k - 1];
+          entries[k] = ObjectEntry(segment.getMin(), indices[i]);
+        } else if(trace(ctx, scene->getObject(indices[i])))
+          success = true;
+      }
+
+      for(int i = 0; i < entryCount; ++i) {
+        /* Everything else starts beyond the nearest hit. */
+        if(entries[i].distance > ctx.segment.getMax())
+          break;
+
+        if(trace(ctx, scene->getObject(entries[i].index)))
+          success = true;
+      }
+
+      return success;
+    }
+
+    /** Checks whether the ray segment is occluded by any of the scene 
+     * objects with the given indices. Stops at the first occluder. Never 
+     * modifies the segment. */
+    template<class IndexArray>
+    static bool occludedObjects(TraceContext& ctx, const IndexArray& indices) {
+      const ShadedScene* scene = ctx.scene;
+      for(int i = 0; i < indices.size(); ++i) {
+        Segment segment = ctx.segment;
+        clip(segment, ctx.ray, scene->getObject(indices[i])->getBoundingBox());
+        if(!segment.isEmpty<true, true>() && occluded(ctx, scene->getObject(indices[i])))
+          return true;
+      }
+      return false;
+    }
+
+    /** Traces the ray through the scene, visiting the objects front to back
+     * and stopping as soon as nothing nearer than the found hit is left.
+     * Small scenes are traced linearly, bigger ones - with the top-level 
+     * BSP tree. Clips in case of a valid intersection. */
+    static bool traceScene(TraceContext& ctx) {
+      const ShadedScene* scene = ctx.scene;
+      if(scene->getObjectCount() == 0)
+        return false;
+
+      Segment oldSegment = ctx.segment;
+      clip(ctx.segment, ctx.ray, scene->getBoundingBox());
+
+      if(!ctx.segment.isEmpty<true, true>()) {
+        if(scene->getObjectCount() <= SMART_TOPLEVEL_LINEAR_OBJECT_COUNT) {
+          if(traceObjects(ctx, FakeArray<int>(scene->getObjectCount()))) {
+            ctx.segment.setMin(oldSegment.getMin());
+            return true;
+          }
+        } else {
+          arx::StaticFastArray<StackElement, SMART_MAX_BSPTREE_DEPTH> nodeStack;
+
+          const BspNode* node = scene->getBspTree().getRoot();
+          while(true) {
+            if(node->isLeaf()) {
+              /* Segment is limited to the current cell, so the nearest hit
+               * found here is the nearest one overall. */
+              if(traceObjects(ctx, node->getTriangleIndexList())) {
+                ctx.segment.setMin(oldSegment.getMin());
+                return true;
+              } else if(!popNode(ctx, nodeStack, node))
+                break;
+            } else
+              traverseInner(ctx, nodeStack, node);
+          }
+        }
+      }
+
+      ctx.segment = oldSegment;
+      return false;
+    }
+
+    /** Checks whether the ray segment is occluded by anything in the scene.
+     * Never modifies the segment. */
+    static bool occludedScene(TraceContext& ctx) {
+      const ShadedScene* scene = ctx.scene;
+      if(scene->getObjectCount() == 0)
+        return false;
+
+      Segment oldSegment = ctx.segment;
+      clip(ctx.segment, ctx.ray, scene->getBoundingBox());
+
+      bool result = false;
+      if(!ctx.segment.isEmpty<true, true>()) {
+        if(scene->getObjectCount() <= SMART_TOPLEVEL_LINEAR_OBJECT_COUNT) {
+          result = occludedObjects(ctx, FakeArray<int>(scene->getObjectCount()));
+        } else {
+          arx::StaticFastArray<StackElement, SMART_MAX_BSPTREE_DEPTH> nodeStack;
+
+          const BspNode* node = scene->getBspTree().getRoot();
+          while(true) {
+            if(node->isLeaf()) {
+              result = occludedObjects(ctx, node->getTriangleIndexList());
+              if(result || !popNode(ctx, nodeStack, node))
+                break;
+            } else
+              traverseInner(ctx, nodeStack, node);
+          }
+        }
+      }
+
+      ctx.segment = oldSegment;
+      return result;
+    }
+
+    /** Shadow ray tracing routine. Unlike trace, stops at the first 
+     * occluder found, and does not store any hit information in the 
+     * context. 
+     *
+     * @returns true if the ray segment is occluded, false otherwise. */
+    static bool shadow(TraceContext& ctx) {
+      ctx.segment.setMin(SMART_TRACEUPPER_SEGMENTSTART_EPS);
+
+      return occludedScene(ctx);
+    }
+
+    /** Finds the nearest intersection of the ray with the scene, without
+     * shading it.
+     *
+     * @returns true if an intersection was found, false otherwise. */
+    static bool traceNearest(TraceContext& ctx) {
+      ctx.segment = Segment(SMART_TRACEUPPER_SEGMENTSTART_EPS, std::numeric_limits<float>::max());
+
+      assert(abs(ctx.ray.getDirection().squaredNorm() - 1.0f) < 1.0e-5);
+
+      if(ctx.depth >= 16)
+        return false;
+
+      return traceScene(ctx);
+    }
+
+    /** Shades the result of intersection search. 
+     *
+     * @param intersectionFound whether the nearest intersection was found. */
+    static void shade(TraceContext& ctx, bool intersectionFound) {
+      if(!intersectionFound) {
+        ctx.scene->getEnvShader()->envShade(ctx);
+        return;
+      }
+
+      ctx.model->getTriangleShader(ctx.triangleId)->surfShade(ctx);
+    }
+
+    /** Top-level tracing routine. Traces the given ray through the given scene. */
+    static void trace(TraceContext& ctx) {
+      shade(ctx, traceNearest(ctx));
+    }
+   
+  };
+
+  inline Radiance TraceContext::trace(const Vector3f& position, const Vector3f& direction, float k) const {
+    /* TODO check k & depth. */
+    TraceContext ctx;
+    ctx.setScene(scene);
+    ctx.setDepth(depth + 1);
+
+    ///*
+    // ctx.ray.setOrigin(transform(position, object->getLocalToWorldTransform()));
+    // ctx.ray.setDirection((transform(Vector3f(position + direction), object->getLocalToWorldTransform()) - ctx.ray.getOrigin()).normalized());
+    //*/
+
+    ctx.ray = Ray(position, direction);
+
+    Tracer::trace(ctx);
+    return ctx.getRadiance() * k;
+  }
+
+  inline Radiance TraceContext::illuminate(int lightIndex, const Vector3f& position, Vector3f& direction, float& distance) const {
+    Radiance result;
+    scene->getLightShaderByIndex(lightIndex)->illuminate(position, direction, distance, result);
+
+    // /* TODO reimplement trace. */
+    return result;
+  }
+
+  inline bool TraceContext::shadow(const Vector3f& position, const Vector3f& direction, float distance) const {
+    TraceContext ctx;
+    ctx.setScene(scene);
+    ctx.setDepth(0);
+    ctx.ray = Ray(position, direction);
+    ctx.segment = Segment(0, distance);
+
+    return Tracer::shadow(ctx);
+  }
+
+
+
+} // namespace smart
+
+#endif // __SMART_TRACER_H__
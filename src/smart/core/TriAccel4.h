@@ -0,0 +1,85 @@
+#ifndef __SMART_TRIACCEL4_H__
+#define __SMART_TRIACCEL4_H__
+
+#include "common.h"
+#include "TriAccel.h"
+#include "Utility.h"
+
+#ifdef SMART_USE_SSE
+
+namespace smart {
+// -------------------------------------------------------------------------- //
+// TriAccel4
+// -------------------------------------------------------------------------- //
+  /** Block of four TriAccel structures stored in structure-of-arrays layout,
+   * so that a single ray can be tested against all of them at once with SSE.
+   *
+   * Projection axes of different triangles generally differ, so instead of
+   * per-triangle k, u and v indices, all the plane and barycentric equations
+   * are stored permuted back into the xyz space, with zero coefficients for
+   * the unused axes. Intersection test then does not depend on k at all.
+   *
+   * Unused lanes of the last block of a leaf are marked invalid. */
+  ALIGN(16) class TriAccel4 {
+  public:
+    enum {
+      SIZE = 4
+    };
+
+    /** @returns number of blocks needed to store the given number of
+     * triangles. */
+    static int getBlockCount(int triangleCount) {
+      return (triangleCount + SIZE - 1) / SIZE;
+    }
+
+    /** Constructor. Constructs a block with all lanes invalid. */
+    TriAccel4() {
+      for(int lane = 0; lane < SIZE; lane++) {
+        for(int i = 0; i < 3; i++)
+          n[i][lane] = b[i][lane] = c[i][lane] = 0.0f;
+        nD[lane] = bD[lane] = cD[lane] = 0.0f;
+      }
+      validMask = 0;
+    }
+
+    /** Stores the given TriAccel in the given lane of this block. */
+    void set(int lane, const TriAccel& a) {
+      assert(lane >= 0 && lane < SIZE);
+
+      int k = a.k;
+      int u = fastModulo3(a.k + 1);
+      int v = fastModulo3(a.k + 2);
+
+      n[k][lane] = 1.0f;
+      n[u][lane] = a.nU;
+      n[v][lane] = a.nV;
+      nD[lane] = a.nD;
+
+      b[k][lane] = 0.0f;
+      b[u][lane] = a.bnU;
+      b[v][lane] = a.bnV;
+      bD[lane] = a.bD;
+
+      c[k][lane] = 0.0f;
+      c[u][lane] = a.cnU;
+      c[v][lane] = a.cnV;
+      cD[lane] = a.cD;
+
+      validMask |= 1 << lane;
+    }
+
+  public:
+    ALIGN(16) float n[3][SIZE];  /**< Plane normals, n[k] == 1. */
+    ALIGN(16) float nD[SIZE];    /**< n.dot(A). */
+    ALIGN(16) float b[3][SIZE];  /**< Second (beta) barycentric coordinate equation, b[k] == 0. */
+    ALIGN(16) float bD[SIZE];
+    ALIGN(16) float c[3][SIZE];  /**< Third (gamma) barycentric coordinate equation, c[k] == 0. */
+    ALIGN(16) float cD[SIZE];
+    int validMask;               /**< Lane mask of valid triangles in this block. */
+  };
+
+} // namespace smart
+
+#endif // SMART_USE_SSE
+
+#endif // __SMART_TRIACCEL4_H__
@@ -1,89 +1,184 @@
-#ifndef __SMART_CONFIG_H__
-#define __SMART_CONFIG_H__
-
-#include <arx/config.h>
-
-#define SMART_USE_SSE2
-
-#ifndef SMART_CACHELINE
-#  define SMART_CACHELINE 64
-#endif
-
-/** @def SMART_TRACETRIACCEL_EPS
- * Epsilon value used for point-in-segment containment test in ray-triangle
- * intersection routine. */
-#ifndef SMART_TRACETRIACCEL_EPS
-#  define SMART_TRACETRIACCEL_EPS 1.0e-6f
-#endif
-
-/** @def SMART_TRACEBSPNODE_SEGMENTCONTAINS_EPS
- * Epsilon value used for point-in-segment containment test in bsp tree
- * traversal routine. */
-#ifndef SMART_TRACEBSPNODE_SEGMENTCONTAINS_EPS
-#  define SMART_TRACEBSPNODE_SEGMENTCONTAINS_EPS 1.0e-6f
-#endif
-
-/** @def SMART_TRACEBSPNODE_DIRECTIONGEZERO_EPS
- * Epsilon value for greater-than-zero check in bsp tree traversal routine. */
-#ifndef SMART_TRACEBSPNODE_DIRECTIONGEZERO_EPS
-#  define SMART_TRACEBSPNODE_DIRECTIONGEZERO_EPS 1.0e-6f
-#endif
-
-/** @def SMART_TRACEUPPER_SEGMENTSTART_EPS
- * Initial minimal value of a ray segment.
- * Must be larger than SMART_TRACETRIACCEL_EPS to
- * prevent infinite recursion. */
-#ifndef SMART_TRACEUPPER_SEGMENTSTART_EPS
-#  define SMART_TRACEUPPER_SEGMENTSTART_EPS 1.0e-4f
-#endif
-
-/** @def SMART_BSPSAH_SAMEPOS_EPS
- * Epsilon value used for equality testing in BSP SAH construction routine.
- * TODO: less than SMART_TRACETRIACCEL_EPS ? */
-#ifndef SMART_BSPSAH_SAMEPOS_EPS
-#  define SMART_BSPSAH_SAMEPOS_EPS 1.0e-6f
-#endif
-
-/** @def SMART_CLIPTRIANGLEBOX_EPS
- * Epsilon value used in box-triangle clipping routine. */
-#ifndef SMART_CLIPTRIANGLEBOX_EPS
-#  define SMART_CLIPTRIANGLEBOX_EPS 1.0e-5f
-#endif
-
-/**
- * 
- */
-#ifndef SMART_NOT_A_TRIANGLE_EPS
-#  define SMART_NOT_A_TRIANGLE_EPS 1.0e-6
-#endif
-
-/** @def SMART_DEFAULT_TILE_SIZE
- * Default tile size used during tiled rendering. */
-#ifndef SMART_DEFAULT_TILE_SIZE
-#  define SMART_DEFAULT_TILE_SIZE 32
-#endif
-
-/** @def SMART_MAX_BSPTREE_DEPTH
- * Maximal depth of a BSP tree, i.e. maximal length of non-leaf node chain. */
-#ifndef SMART_MAX_BSPTREE_DEPTH
-#  define SMART_MAX_BSPTREE_DEPTH 64
-#endif
-
-/** @def SMART_USE_SSE
- * Use SSE intrinsics */
-
-/** @def SMART_USE_SSE2
- * Use SSE2 intrinsics. */
-
-/** @def SMART_USE_SSE3
- * Use SSE3 intrinsics. */
-
-#if defined(SMART_USE_SSE3) && !defined(SMART_USE_SSE2)
-#  define SMART_USE_SSE2
-#endif
-
-#if defined(SMART_USE_SSE2) && !defined(SMART_USE_SSE)
-#  define SMART_USE_SSE
-#endif
-
+#ifndef __SMART_CONFIG_H__
+#define __SMART_CONFIG_H__
+
+#include <arx/config.h>
+
+#define SMART_USE_SSE2
+
+#ifndef SMART_CACHELINE
+#  define SMART_CACHELINE 64
+#endif
+
+/** @def SMART_TRACETRIACCEL_EPS
+ * Epsilon value used for point-in-segment containment test in ray-triangle
+ * intersection routine. */
+#ifndef SMART_TRACETRIACCEL_EPS
+#  define SMART_TRACETRIACCEL_EPS 1.0e-6f
+#endif
+
+/** @def SMART_TRACEBSPNODE_SEGMENTCONTAINS_EPS
+ * Epsilon value used for point-in-segment containment test in bsp tree
+ * traversal routine. */
+#ifndef SMART_TRACEBSPNODE_SEGMENTCONTAINS_EPS
+#  define SMART_TRACEBSPNODE_SEGMENTCONTAINS_EPS 1.0e-6f
+#endif
+
+/** @def SMART_TRACEBSPNODE_DIRECTIONGEZERO_EPS
+ * Epsilon value for greater-than-zero check in bsp tree traversal routine. */
+#ifndef SMART_TRACEBSPNODE_DIRECTIONGEZERO_EPS
+#  define SMART_TRACEBSPNODE_DIRECTIONGEZERO_EPS 1.0e-6f
+#endif
+
+/** @def SMART_TRACEUPPER_SEGMENTSTART_EPS
+ * Initial minimal value of a ray segment.
+ * Must be larger than SMART_TRACETRIACCEL_EPS to
+ * prevent infinite recursion. */
+#ifndef SMART_TRACEUPPER_SEGMENTSTART_EPS
+#  define SMART_TRACEUPPER_SEGMENTSTART_EPS 1.0e-4f
+#endif
+
+/** @def SMART_BSPSAH_SAMEPOS_EPS
+ * Epsilon value used for equality testing in BSP SAH construction routine.
+ * TODO: less than SMART_TRACETRIACCEL_EPS ? */
+#ifndef SMART_BSPSAH_SAMEPOS_EPS
+#  define SMART_BSPSAH_SAMEPOS_EPS 1.0e-6f
+#endif
+
+/** @def SMART_CLIPTRIANGLEBOX_EPS
+ * Epsilon value used in box-triangle clipping routine. */
+#ifndef SMART_CLIPTRIANGLEBOX_EPS
+#  define SMART_CLIPTRIANGLEBOX_EPS 1.0e-5f
+#endif
+
+/**
+ * 
+ */
+#ifndef SMART_NOT_A_TRIANGLE_EPS
+#  define SMART_NOT_A_TRIANGLE_EPS 1.0e-6
+#endif
+
+/** @def SMART_DEFAULT_TILE_SIZE
+ * Default tile size used during tiled rendering. */
+#ifndef SMART_DEFAULT_TILE_SIZE
+#  define SMART_DEFAULT_TILE_SIZE 32
+#endif
+
+/** @def SMART_COST_TILER_SPLIT_FACTOR
+ * Tiles that took more than this many times the mean tile render time in 
+ * the previous frame are split by the cost-aware tiler. */
+#ifndef SMART_COST_TILER_SPLIT_FACTOR
+#  define SMART_COST_TILER_SPLIT_FACTOR 4.0f
+#endif
+
+/** @def SMART_WORKER_COUNT
+ * Default number of rendering threads. Zero means one thread for each 
+ * hardware thread. */
+#ifndef SMART_WORKER_COUNT
+#  define SMART_WORKER_COUNT 0
+#endif
+
+/** @def SMART_EVENT_SPIN_COUNT
+ * Number of iterations a thread waiting on an event spins for before going
+ * to sleep. */
+#ifndef SMART_EVENT_SPIN_COUNT
+#  define SMART_EVENT_SPIN_COUNT 1000
+#endif
+
+/** @def SMART_RAY_BUNDLE_SIZE
+ * Side length of a square bundle of primary rays traced together with 
+ * interval arithmetic culling, in pixels. Must be even. */
+#ifndef SMART_RAY_BUNDLE_SIZE
+#  define SMART_RAY_BUNDLE_SIZE 8
+#endif
+
+/** @def SMART_TOPLEVEL_LINEAR_OBJECT_COUNT
+ * Scenes with at most this many objects are traced without the top-level
+ * BSP tree, by testing objects in order of their entry distance along the
+ * ray. It is also the maximal number of objects in a top-level BSP tree 
+ * leaf that are sorted this way. */
+#ifndef SMART_TOPLEVEL_LINEAR_OBJECT_COUNT
+#  define SMART_TOPLEVEL_LINEAR_OBJECT_COUNT 16
+#endif
+
+/** @def SMART_MAX_BSPTREE_DEPTH
+ * Maximal depth of a BSP tree, i.e. maximal length of non-leaf node chain. 
+ * Traversal stacks are sized by it, so it also bounds the per-model 
+ * BspBuildParams::maxDepth. */
+#ifndef SMART_MAX_BSPTREE_DEPTH
+#  define SMART_MAX_BSPTREE_DEPTH 64
+#endif
+
+/** @def SMART_BSPSAH_PARALLEL_MIN_EVENTS
+ * Minimal number of events in a subtree for it to be constructed as a 
+ * separate task on the worker pool during SAH BSP tree construction. */
+#ifndef SMART_BSPSAH_PARALLEL_MIN_EVENTS
+#  define SMART_BSPSAH_PARALLEL_MIN_EVENTS (6 * 32768)
+#endif
+
+/** @def SMART_BSPSAH_BIN_COUNT
+ * Number of bins per axis used in binned SAH BSP tree construction. */
+#ifndef SMART_BSPSAH_BIN_COUNT
+#  define SMART_BSPSAH_BIN_COUNT 32
+#endif
+
+/** @def SMART_BSPTREE_REFIT_LEAF_GROWTH
+ * When a BSP tree is refitted, leaves that now hold more than this many 
+ * times objects they were built with are split further. */
+#ifndef SMART_BSPTREE_REFIT_LEAF_GROWTH
+#  define SMART_BSPTREE_REFIT_LEAF_GROWTH 2
+#endif
+
+/** @def SMART_BSPTREE_LAZY_SUBTREE_SIZE
+ * Maximal number of objects in a subtree that is deferred until a ray first
+ * reaches it, see BSP_BUILD_LAZY_BINNED_SAH. */
+#ifndef SMART_BSPTREE_LAZY_SUBTREE_SIZE
+#  define SMART_BSPTREE_LAZY_SUBTREE_SIZE 4096
+#endif
+
+/** @def SMART_BSPTREE_AUTO_LEAF_SIZE
+ * Default maximal number of objects in a BSP tree that is built as a single 
+ * leaf when construction algorithm is picked automatically. */
+#ifndef SMART_BSPTREE_AUTO_LEAF_SIZE
+#  define SMART_BSPTREE_AUTO_LEAF_SIZE 8
+#endif
+
+/** @def SMART_BSPTREE_AUTO_BINNED_SIZE
+ * Default maximal number of objects in a BSP tree that is built with binned
+ * SAH when construction algorithm is picked automatically. Bigger trees are 
+ * built with exact SAH. */
+#ifndef SMART_BSPTREE_AUTO_BINNED_SIZE
+#  define SMART_BSPTREE_AUTO_BINNED_SIZE 16384
+#endif
+
+/** @def SMART_USE_SSE
+ * Use SSE intrinsics */
+
+/** @def SMART_USE_SSE2
+ * Use SSE2 intrinsics. */
+
+/** @def SMART_USE_SSE3
+ * Use SSE3 intrinsics. */
+
+#if defined(SMART_USE_SSE3) && !defined(SMART_USE_SSE2)
+#  define SMART_USE_SSE2
+#endif
+
+#if defined(SMART_USE_SSE2) && !defined(SMART_USE_SSE)
+#  define SMART_USE_SSE
+#endif
+
+/** @def SMART_USE_WATERTIGHT_INTERSECTION
+ * Use watertight ray-triangle intersection test (Woop, Benthin, Wald, 
+ * "Watertight Ray/Triangle Intersection") instead of Wald's projection 
+ * test with epsilons. It neither misses nor double-counts hits on shared 
+ * edges, at the cost of larger TriAccel structures and no TriAccel4 
+ * blocks. */
+
+/** @def SMART_USE_TRIACCEL4
+ * Defined if leaf triangles are intersected in TriAccel4 blocks. Not to be
+ * defined manually. */
+#if defined(SMART_USE_SSE) && !defined(SMART_USE_WATERTIGHT_INTERSECTION)
+#  define SMART_USE_TRIACCEL4
+#endif
+
 #endif
\ No newline at end of file
@@ -1,53 +1,684 @@
-#ifndef __SMART_TEST_H__
-#define __SMART_TEST_H__
-
-#include "../Smart.h"
-#include <cassert>
-
-namespace smart {
-
-  void test_BspNode_getSplitDimension() {
-    for(int i = 0; i <= 2; i++) {
-      BspNode n = BspNode(BspNode::INNER(), i, 0.0f, NULL);
-      assert(n.getDim<0>() == i);
-      assert(n.getDim<1>() == (i + 1) % 3);
-      assert(n.getDim<2>() == (i + 2) % 3);
-    }
-  }
-
-  void test_Engine_intersects_BoundingBox_Triangle() {
-    typedef Vector3f V;
-
-    assert(Engine::intersects(BoundingBox(V(0,0,0), V(1,1,1)), Triangle(V(2,0,0), V(0,2,0), V(0,0,2))));
-    assert(Engine::intersects(BoundingBox(V(0,0,0), V(1,1,1)), Triangle(V(3,0,0), V(0,3,0), V(0,0,3))));
-
-    assert(Engine::intersects(BoundingBox(V(0,0,0), V(1,1,1)), Triangle(V(3,0,0), V(0,3,0), V(0,0,2.9f))));
-    assert(Engine::intersects(BoundingBox(V(0,0,0), V(1,1,1)), Triangle(V(3,0,0), V(0,2.9f,0), V(0,0,3))));
-    assert(Engine::intersects(BoundingBox(V(0,0,0), V(1,1,1)), Triangle(V(2.9f,0,0), V(0,3,0), V(0,0,3))));
-    assert(!Engine::intersects(BoundingBox(V(0,0,0), V(1,1,1)), Triangle(V(3,0,0), V(0,3,0), V(0,0,3.1f))));
-    assert(!Engine::intersects(BoundingBox(V(0,0,0), V(1,1,1)), Triangle(V(3,0,0), V(0,3.1f,0), V(0,0,3))));
-    assert(!Engine::intersects(BoundingBox(V(0,0,0), V(1,1,1)), Triangle(V(3.1f,0,0), V(0,3,0), V(0,0,3))));
-
-    assert(Engine::intersects(BoundingBox(V(-1,-1,-1), V(0,0,0)), Triangle(V(-3,0,0), V(0,-3,0), V(0,0,-2.9f))));
-    assert(Engine::intersects(BoundingBox(V(-1,-1,-1), V(0,0,0)), Triangle(V(-3,0,0), V(0,-2.9f,0), V(0,0,-3))));
-    assert(Engine::intersects(BoundingBox(V(-1,-1,-1), V(0,0,0)), Triangle(V(-2.9f,0,0), V(0,-3,0), V(0,0,-3))));
-    assert(!Engine::intersects(BoundingBox(V(-1,-1,-1), V(0,0,0)), Triangle(V(-3,0,0), V(0,-3,0), V(0,0,-3.1f))));
-    assert(!Engine::intersects(BoundingBox(V(-1,-1,-1), V(0,0,0)), Triangle(V(-3,0,0), V(0,-3.1f,0), V(0,0,-3))));
-    assert(!Engine::intersects(BoundingBox(V(-1,-1,-1), V(0,0,0)), Triangle(V(-3.1f,0,0), V(0,-3,0), V(0,0,-3))));
-
-    assert(Engine::intersects(BoundingBox(V(-1,-1,-1), V(1,1,1)), Triangle(V(-100,-100,0), V(100,0,0), V(0,100,0))));
-    assert(Engine::intersects(BoundingBox(V(-1,-1,-1), V(1,1,1)), Triangle(V(-100,-100,1), V(100,0,1), V(0,100,1))));
-    assert(Engine::intersects(BoundingBox(V(-1,-1,-1), V(1,1,1)), Triangle(V(-100,-100,-1), V(100,0,-1), V(0,100,-1))));
-    assert(!Engine::intersects(BoundingBox(V(-1,-1,-1), V(1,1,1)), Triangle(V(-100,-100,2), V(100,0,2), V(0,100,2))));
-
-    assert(Engine::intersects(BoundingBox(V(-1,-1,-1), V(1,1,1)), Triangle(V(1,1,1), V(1,1,2), V(1,2,1))));
-  }
-
-  void testSmart() {
-    test_BspNode_getSplitDimension();
-    test_Engine_intersects_BoundingBox_Triangle();
-  }
-
-} // namespace smart
-
-#endif // __SMART_TEST_H__
+#ifndef __SMART_TEST_H__
+#define __SMART_TEST_H__
+
+#include "../core/SmartCore.h"
+#include "../core/Timer.h"
+#include "../core/Event.h"
+#include "../core/Task.h"
+#include "../core/RenderTiler.h"
+#include <arx/Thread.h>
+#include <cassert>
+#include <cfloat>
+#include <cstdio>
+#include <vector>
+
+namespace smart {
+// -------------------------------------------------------------------------- //
+// Test helpers
+// -------------------------------------------------------------------------- //
+  namespace detail {
+    /** Triangle given by its three vertices, as accepted by intersects. */
+    class TestTriangle {
+    public:
+      TestTriangle(const Vector3f& v0, const Vector3f& v1, const Vector3f& v2) {
+        mVertices[0] = v0;
+        mVertices[1] = v1;
+        mVertices[2] = v2;
+      }
+
+      const Vector3f& operator[] (int index) const {
+        return mVertices[index];
+      }
+
+    private:
+      Vector3f mVertices[3];
+    };
+
+    /** Deterministic pseudo-random generator, so that test scenes are the
+     * same on every platform.
+     *
+     * @returns random number in [0, 1). */
+    inline float testRandom(unsigned& seed) {
+      seed = seed * 1664525u + 1013904223u;
+      return (seed >> 8) / 16777216.0f;
+    }
+
+    /** Surface shader that returns the hit position as radiance. */
+    class TestPositionShader {
+    public:
+      void shade(TraceContext& ctx) const {
+        ctx.setRadiance(Radiance(ctx.getPosition()));
+      }
+
+      bool transparency(TraceContext& ctx) const {
+        return false;
+      }
+
+      void registerParams(const ShaderRegistrator& r) const {}
+    };
+
+    /** Environment shader that returns a radiance no hit can produce. */
+    class TestMissShader {
+    public:
+      void shade(TraceContext& ctx) const {
+        ctx.setRadiance(Radiance(-1000, -1000, -1000));
+      }
+
+      void registerParams(const ShaderRegistrator& r) const {}
+    };
+
+    /** Pinhole camera looking at the [-1, 1]^3 cube from the negative z. */
+    class TestCameraShader {
+    public:
+      void initPrimaryRay(float x, float y, TraceContext& ctx) const {
+        Vector3f origin(0.3f, 0.2f, -4.0f);
+        ctx.setRay(Ray(origin, (Vector3f(2 * x - 1, 2 * y - 1, 0) - origin).normalized()));
+      }
+
+      void registerParams(const ShaderRegistrator& r) const {}
+    };
+
+    /** Fills the given model with random small triangles inside
+     * the [-1, 1]^3 cube. */
+    inline void fillTestModel(ShadedModel* model, int shaderId, int triangleCount, unsigned seed) {
+      for(int i = 0; i < triangleCount; i++) {
+        Vector3f center(2 * testRandom(seed) - 1, 2 * testRandom(seed) - 1, 2 * testRandom(seed) - 1);
+        Vector3f v[3];
+        for(int j = 0; j < 3; j++)
+          v[j] = center + 0.2f * Vector3f(testRandom(seed) - 0.5f, testRandom(seed) - 0.5f, testRandom(seed) - 0.5f);
+        if((v[1] - v[0]).cross(v[2] - v[0]).norm() < 1.0e-4f)
+          continue;
+
+        int id[3];
+        for(int j = 0; j < 3; j++)
+          id[j] = model->newVertex(v[j], Vector3f(0, 0, 1), Vector3f(0, 0, 0), NULL);
+        model->newTriangle(id[0], id[1], id[2], shaderId, NULL);
+      }
+    }
+
+    /** Moves every vertex of a model filled with fillTestModel by a fixed
+     * non-degenerate linear map. */
+    inline void warpTestModel(ShadedModel* model) {
+      for(int i = 0; i < 3 * model->getTriangleCount(); i++) {
+        const Vector3f& v = model->getCoord(i);
+        model->setCoord(i, Vector3f(v[0] + 0.4f * v[1], 1.3f * v[1], v[2] - 0.3f * v[0]));
+      }
+    }
+
+    /** @returns identifier of a new surface shader that makes the radiance
+     * of a ray equal to the position of its hit. */
+    inline int newTestSurfaceShader(SmartCore& core) {
+      return core.newShader(core.newShaderClass<TestPositionShader>());
+    }
+
+    /** Creates a compiled scene with an object for each of the given models.
+     * A single object is placed as is, several objects are laid out on 
+     * a grid. */
+    inline ShadedScene* newTestScene(SmartCore& core, ShadedModel* const* models, int objectCount) {
+      ShadedScene* scene = core.newScene();
+      for(int i = 0; i < objectCount; i++) {
+        Matrix4f transform = Matrix4f::Identity();
+        if(objectCount > 1) {
+          transform(0, 3) = 2.5f * (i % 5) - 5.0f;
+          transform(1, 3) = 2.5f * (i / 5) - 5.0f;
+        }
+        scene->newObject(models[i], transform);
+      }
+      scene->useCameraShader(core.newShader(core.newShaderClass<TestCameraShader>()));
+      scene->useEnvShader(core.newShader(core.newShaderClass<TestMissShader>()));
+      scene->compile();
+      return scene;
+    }
+
+    /** Creates a compiled scene of objectCount objects, each with its own
+     * model of triangleCount random triangles. */
+    inline ShadedScene* newTestScene(SmartCore& core, int triangleCount, int objectCount, unsigned seed) {
+      int surfaceShaderId = newTestSurfaceShader(core);
+
+      arx::FastArray<ShadedModel*> models;
+      for(int i = 0; i < objectCount; i++) {
+        models.push_back(core.newModel());
+        fillTestModel(models[i], surfaceShaderId, triangleCount, seed + i);
+      }
+
+      ShadedScene* scene = newTestScene(core, &models[0], objectCount);
+      for(int i = 0; i < objectCount; i++)
+        core.releaseModel(models[i]);
+      return scene;
+    }
+
+    /** Prepares a context for tracing a primary ray through the given point
+     * of the image plane. */
+    inline void initTestContext(const ShadedScene* scene, float x, float y, TraceContext& ctx) {
+      ctx.setScene(scene);
+      ctx.setDepth(0);
+      scene->getCameraShader()->initPrimaryRay(x, y, ctx);
+    }
+
+    inline bool sameRadiance(const Radiance& a, const Radiance& b) {
+      return (a.getData() - b.getData()).cwise().abs().maxCoeff() < 1.0e-3f;
+    }
+
+    /** Thread function that answers each signal of one event with a signal
+     * of another one, counting the rounds. */
+    class TestEventEcho {
+    public:
+      TestEventEcho(Event* ping, Event* pong, AtomicInt* counter, int rounds):
+        mPing(ping), mPong(pong), mCounter(counter), mRounds(rounds) {}
+
+      void operator()() {
+        for(int i = 0; i < mRounds; i++) {
+          mPing->wait();
+          mCounter->increment();
+          mPong->set();
+        }
+      }
+
+    private:
+      Event* mPing;
+      Event* mPong;
+      AtomicInt* mCounter;
+      int mRounds;
+    };
+
+    /** Task runner that runs each task on a thread of its own. Note that 
+     * more tasks than getWorkerCount may run at the same time. */
+    class TestTaskRunner: public AbstractTaskRunner {
+    public:
+      TestTaskRunner(int workerCount): mWorkerCount(workerCount) {}
+
+      ~TestTaskRunner() {
+        for(int i = 0; i < mThreads.size(); i++)
+          delete mThreads[i];
+      }
+
+      virtual void addTask(AbstractTask* task) {
+        mThreads.push_back(new arx::thread(ThreadFunc(task)));
+      }
+
+      virtual int getWorkerCount() const {
+        return mWorkerCount;
+      }
+
+    private:
+      class ThreadFunc {
+      public:
+        ThreadFunc(AbstractTask* task): mTask(task) {}
+
+        void operator()() {
+          mTask->run();
+          delete mTask;
+        }
+
+      private:
+        AbstractTask* mTask;
+      };
+
+      arx::FastArray<arx::thread*> mThreads;
+      int mWorkerCount;
+    };
+
+    /** Task that increments a counter. */
+    class TestCountingTask: public AbstractTask {
+    public:
+      TestCountingTask(AtomicInt* counter, TaskGroup* group): mCounter(counter), mGroup(group) {}
+
+      virtual void run() {
+        mCounter->increment();
+        mGroup->taskDone();
+      }
+
+    private:
+      AtomicInt* mCounter;
+      TaskGroup* mGroup;
+    };
+
+    /** Prepares the given tiler for the given image and checks that its 
+     * tiles cover every pixel exactly once.
+     *
+     * @returns number of tiles. */
+    template<class Tiler>
+    int checkTestTilerCoverage(Tiler& tiler, arx::Image3f& image, int renderersCount) {
+      int tileCount = tiler.nextTask(NULL, image, renderersCount);
+
+      std::vector<int> coverage(image.getWidth() * image.getHeight(), 0);
+      for(int i = 0; i < tileCount; i++) {
+        ImageTile tile = tiler.getTile(i);
+        assert(tile.getWidth() > 0 && tile.getHeight() > 0);
+        assert(tile.getX() >= 0 && tile.getX() + tile.getWidth() <= image.getWidth());
+        assert(tile.getY() >= 0 && tile.getY() + tile.getHeight() <= image.getHeight());
+        for(int y = tile.getY(); y < tile.getY() + tile.getHeight(); y++)
+          for(int x = tile.getX(); x < tile.getX() + tile.getWidth(); x++)
+            coverage[y * image.getWidth() + x]++;
+      }
+
+      for(unsigned i = 0; i < coverage.size(); i++)
+        assert(coverage[i] == 1);
+      return tileCount;
+    }
+
+  } // namespace detail
+
+
+// -------------------------------------------------------------------------- //
+// Tests
+// -------------------------------------------------------------------------- //
+  void test_BspNode_getSplitDimension() {
+    for(int i = 0; i <= 2; i++) {
+      BspNode n = BspNode(BspNode::INNER(), i, 0.0f, NULL);
+      assert(n.getDim<0>() == i);
+      assert(n.getDim<1>() == (i + 1) % 3);
+      assert(n.getDim<2>() == (i + 2) % 3);
+    }
+  }
+
+  void test_intersects_BoundingBox_Triangle() {
+    typedef Vector3f V;
+    typedef detail::TestTriangle T;
+
+    assert(smart::intersects(BoundingBox(V(0,0,0), V(1,1,1)), T(V(2,0,0), V(0,2,0), V(0,0,2))));
+    assert(smart::intersects(BoundingBox(V(0,0,0), V(1,1,1)), T(V(3,0,0), V(0,3,0), V(0,0,3))));
+
+    assert(smart::intersects(BoundingBox(V(0,0,0), V(1,1,1)), T(V(3,0,0), V(0,3,0), V(0,0,2.9f))));
+    assert(smart::intersects(BoundingBox(V(0,0,0), V(1,1,1)), T(V(3,0,0), V(0,2.9f,0), V(0,0,3))));
+    assert(smart::intersects(BoundingBox(V(0,0,0), V(1,1,1)), T(V(2.9f,0,0), V(0,3,0), V(0,0,3))));
+    assert(!smart::intersects(BoundingBox(V(0,0,0), V(1,1,1)), T(V(3,0,0), V(0,3,0), V(0,0,3.1f))));
+    assert(!smart::intersects(BoundingBox(V(0,0,0), V(1,1,1)), T(V(3,0,0), V(0,3.1f,0), V(0,0,3))));
+    assert(!smart::intersects(BoundingBox(V(0,0,0), V(1,1,1)), T(V(3.1f,0,0), V(0,3,0), V(0,0,3))));
+
+    assert(smart::intersects(BoundingBox(V(-1,-1,-1), V(0,0,0)), T(V(-3,0,0), V(0,-3,0), V(0,0,-2.9f))));
+    assert(smart::intersects(BoundingBox(V(-1,-1,-1), V(0,0,0)), T(V(-3,0,0), V(0,-2.9f,0), V(0,0,-3))));
+    assert(smart::intersects(BoundingBox(V(-1,-1,-1), V(0,0,0)), T(V(-2.9f,0,0), V(0,-3,0), V(0,0,-3))));
+    assert(!smart::intersects(BoundingBox(V(-1,-1,-1), V(0,0,0)), T(V(-3,0,0), V(0,-3,0), V(0,0,-3.1f))));
+    assert(!smart::intersects(BoundingBox(V(-1,-1,-1), V(0,0,0)), T(V(-3,0,0), V(0,-3.1f,0), V(0,0,-3))));
+    assert(!smart::intersects(BoundingBox(V(-1,-1,-1), V(0,0,0)), T(V(-3.1f,0,0), V(0,-3,0), V(0,0,-3))));
+
+    assert(smart::intersects(BoundingBox(V(-1,-1,-1), V(1,1,1)), T(V(-100,-100,0), V(100,0,0), V(0,100,0))));
+    assert(smart::intersects(BoundingBox(V(-1,-1,-1), V(1,1,1)), T(V(-100,-100,1), V(100,0,1), V(0,100,1))));
+    assert(smart::intersects(BoundingBox(V(-1,-1,-1), V(1,1,1)), T(V(-100,-100,-1), V(100,0,-1), V(0,100,-1))));
+    assert(!smart::intersects(BoundingBox(V(-1,-1,-1), V(1,1,1)), T(V(-100,-100,2), V(100,0,2), V(0,100,2))));
+
+    assert(smart::intersects(BoundingBox(V(-1,-1,-1), V(1,1,1)), T(V(1,1,1), V(1,1,2), V(1,2,1))));
+  }
+
+#ifdef SMART_USE_WATERTIGHT_INTERSECTION
+  /** Checks that rays through the shared edge of two triangles hit at least
+   * one of them, both single and in packets, and that away from edges the 
+   * watertight test agrees with Wald's test. */
+  void test_testHitWatertight() {
+    typedef Vector3f V;
+    typedef detail::TestTriangle T;
+
+    TriAccel lower(T(V(0, 0, 0), V(1, 0, 0), V(1, 1, 0)));
+    TriAccel upper(T(V(0, 0, 0), V(1, 1, 0), V(0, 1, 0)));
+    Segment segment(0, FLT_MAX);
+    float t, beta, gamma;
+
+    unsigned seed = 5;
+    for(int i = 0; i < 10000; i++) {
+      float s = detail::testRandom(seed);
+      V origin(detail::testRandom(seed) * 4 - 2, detail::testRandom(seed) * 4 - 2, -1 - detail::testRandom(seed));
+      Ray ray(origin, (V(s, s, 0) - origin).normalized());
+      assert(detail::testHitWatertight(ray, segment, lower, t, beta, gamma, 0.0f) || 
+             detail::testHitWatertight(ray, segment, upper, t, beta, gamma, 0.0f));
+    }
+
+#ifdef SMART_USE_SSE
+    /* Packets must give exactly the same hits as single rays, including the
+     * rays whose edge functions are zero in single precision. Rays go mostly
+     * along z, so that packets use the same ray space as single rays. */
+    for(int i = 0; i < 2500; i++) {
+      RayPacket packet;
+      for(int j = 0; j < RayPacket::SIZE; j++) {
+        float s = detail::testRandom(seed);
+        V origin(s + detail::testRandom(seed) - 0.5f, s + detail::testRandom(seed) - 0.5f, -1 - detail::testRandom(seed));
+        packet.setRay(j, origin, (V(s, s, 0) - origin).normalized());
+      }
+      packet.updateShear();
+
+      int hitMasks[2];
+      const TriAccel* triAccels[2] = {&lower, &upper};
+      for(int k = 0; k < 2; k++) {
+        __m128 segmentMax = _mm_set1_ps(FLT_MAX);
+        __m128 packetBeta = _mm_setzero_ps();
+        __m128 packetGamma = _mm_setzero_ps();
+        hitMasks[k] = detail::intersectWatertight(packet, _mm_setzero_ps(), segmentMax, *triAccels[k], packetBeta, packetGamma, RayPacket::ALL, 0.0f);
+        for(int j = 0; j < RayPacket::SIZE; j++)
+          assert(((hitMasks[k] >> j) & 1) == detail::testHitWatertight(packet.getRay(j), segment, *triAccels[k], t, beta, gamma, 0.0f));
+      }
+      assert((hitMasks[0] | hitMasks[1]) == RayPacket::ALL);
+    }
+#endif
+
+    for(int i = 0; i < 10000; i++) {
+      V target(detail::testRandom(seed), detail::testRandom(seed), 0);
+      if(abs(target[0] - target[1]) < 1.0e-3f)
+        continue;
+
+      V origin(detail::testRandom(seed) * 4 - 2, detail::testRandom(seed) * 4 - 2, -1 - detail::testRandom(seed));
+      Ray ray(origin, (target - origin).normalized());
+      const TriAccel& hit = target[0] > target[1] ? lower : upper;
+      const TriAccel& miss = target[0] > target[1] ? upper : lower;
+
+      float tWald, betaWald, gammaWald;
+      assert(detail::testHitWald(ray, segment, hit, tWald, betaWald, gammaWald, SMART_TRACETRIACCEL_EPS));
+      assert(detail::testHitWatertight(ray, segment, hit, t, beta, gamma, 0.0f));
+      assert(abs(t - tWald) < 1.0e-4f * tWald);
+      assert(!detail::testHitWatertight(ray, segment, miss, t, beta, gamma, 0.0f));
+    }
+  }
+#endif
+
+#ifdef SMART_USE_SSE
+  /** Checks that 2x2 packets give the same hits as single rays, both for
+   * a single object and for a scene large enough to use the top-level tree. */
+  void test_PacketTracer_matchesTracer() {
+    const int objectCounts[] = {1, 2 * SMART_TOPLEVEL_LINEAR_OBJECT_COUNT};
+    const int size = 64;
+
+    for(int k = 0; k < 2; k++) {
+      SmartCore core(1);
+      ShadedScene* scene = detail::newTestScene(core, 300, objectCounts[k], 17);
+
+      for(int y = 0; y < size; y += 2) {
+        for(int x = 0; x < size; x += 2) {
+          TraceContext packet[RayPacket::SIZE];
+          for(int i = 0; i < RayPacket::SIZE; i++)
+            detail::initTestContext(scene, (x + (i & 1)) / (float) size, (y + (i >> 1)) / (float) size, packet[i]);
+          PacketTracer::trace(packet);
+
+          for(int i = 0; i < RayPacket::SIZE; i++) {
+            TraceContext single;
+            detail::initTestContext(scene, (x + (i & 1)) / (float) size, (y + (i >> 1)) / (float) size, single);
+            Tracer::trace(single);
+            assert(detail::sameRadiance(packet[i].getRadiance(), single.getRadiance()));
+          }
+        }
+      }
+
+      core.releaseScene(scene);
+    }
+  }
+
+  /** Checks that ray bundles give the same hits as single rays, for a 
+   * single object, for a scene that is traced linearly, and for a scene 
+   * large enough to use the top-level tree. */
+  void test_BundleTracer_matchesTracer() {
+    const int objectCounts[] = {1, SMART_TOPLEVEL_LINEAR_OBJECT_COUNT - 1, 2 * SMART_TOPLEVEL_LINEAR_OBJECT_COUNT};
+    const int size = 64;
+
+    for(int k = 0; k < 3; k++) {
+      SmartCore core(1);
+      ShadedScene* scene = detail::newTestScene(core, 300, objectCounts[k], 29);
+
+      for(int y = 0; y < size; y += RayBundle::SIDE) {
+        for(int x = 0; x < size; x += RayBundle::SIDE) {
+          TraceContext bundle[RayBundle::SIZE];
+          for(int i = 0; i < RayBundle::SIZE; i++)
+            detail::initTestContext(scene, (x + RayBundle::getRayX(i)) / (float) size, (y + RayBundle::getRayY(i)) / (float) size, bundle[i]);
+          BundleTracer::trace(bundle);
+
+          for(int i = 0; i < RayBundle::SIZE; i++) {
+            TraceContext single;
+            detail::initTestContext(scene, (x + RayBundle::getRayX(i)) / (float) size, (y + RayBundle::getRayY(i)) / (float) size, single);
+            Tracer::trace(single);
+            assert(detail::sameRadiance(bundle[i].getRadiance(), single.getRadiance()));
+          }
+        }
+      }
+
+      core.releaseScene(scene);
+    }
+  }
+#endif
+
+  /** Checks that a refitted model gives the same hits as a model compiled
+   * from scratch at the new vertex positions. Model is refitted twice, so 
+   * that refit of a refitted tree is covered too. */
+  void test_ShadedModel_refit() {
+    const int size = 64;
+
+    SmartCore core(1);
+    int shaderId = detail::newTestSurfaceShader(core);
+
+    ShadedModel* refitted = core.newModel();
+    detail::fillTestModel(refitted, shaderId, 500, 41);
+    ShadedScene* refittedScene = detail::newTestScene(core, &refitted, 1);
+
+    ShadedModel* fresh = core.newModel();
+    detail::fillTestModel(fresh, shaderId, 500, 41);
+    detail::warpTestModel(fresh);
+    detail::warpTestModel(fresh);
+    ShadedScene* freshScene = detail::newTestScene(core, &fresh, 1);
+
+    for(int i = 0; i < 2; i++) {
+      detail::warpTestModel(refitted);
+      refittedScene->refitGeometry();
+    }
+
+    for(int y = 0; y < size; y++) {
+      for(int x = 0; x < size; x++) {
+        TraceContext a, b;
+        detail::initTestContext(refittedScene, x / (float) size, y / (float) size, a);
+        detail::initTestContext(freshScene, x / (float) size, y / (float) size, b);
+        Tracer::trace(a);
+        Tracer::trace(b);
+        assert(detail::sameRadiance(a.getRadiance(), b.getRadiance()));
+      }
+    }
+
+    core.releaseModel(refitted);
+    core.releaseModel(fresh);
+    core.releaseScene(refittedScene);
+    core.releaseScene(freshScene);
+  }
+
+  /** Checks that a model loaded from its cache file traces like a freshly
+   * built one, and that a corrupt cache file is rebuilt instead of used. */
+  void test_CoreModel_cache() {
+    const int size = 64;
+    const char* cacheFile = "smart_test_cache.bin";
+    std::remove(cacheFile);
+
+    SmartCore core(1);
+    int shaderId = detail::newTestSurfaceShader(core);
+
+    /* First model is built without a cache, second one writes the cache 
+     * file, third one loads it, and the last one gets a corrupt file. */
+    ShadedModel* models[4];
+    ShadedScene* scenes[4];
+    for(int i = 0; i < 4; i++) {
+      models[i] = core.newModel();
+      detail::fillTestModel(models[i], shaderId, 500, 43);
+      if(i > 0)
+        models[i]->setCacheFile(cacheFile);
+    }
+    for(int i = 0; i < 3; i++)
+      scenes[i] = detail::newTestScene(core, &models[i], 1);
+
+    /* Tree image is at the end of the file. */
+    FILE* file = fopen(cacheFile, "r+b");
+    assert(file != NULL);
+    fseek(file, 0, SEEK_END);
+    long fileSize = ftell(file);
+    fseek(file, fileSize / 2, SEEK_SET);
+    for(long i = fileSize / 2; i < fileSize; i++)
+      fputc(0xA5, file);
+    fclose(file);
+    scenes[3] = detail::newTestScene(core, &models[3], 1);
+
+    for(int i = 1; i < 4; i++) {
+      for(int y = 0; y < size; y++) {
+        for(int x = 0; x < size; x++) {
+          TraceContext a, b;
+          detail::initTestContext(scenes[0], x / (float) size, y / (float) size, a);
+          detail::initTestContext(scenes[i], x / (float) size, y / (float) size, b);
+          Tracer::trace(a);
+          Tracer::trace(b);
+          assert(detail::sameRadiance(a.getRadiance(), b.getRadiance()));
+        }
+      }
+    }
+
+    for(int i = 0; i < 4; i++) {
+      core.releaseModel(models[i]);
+      core.releaseScene(scenes[i]);
+    }
+    std::remove(cacheFile);
+  }
+
+  /** Checks that a signal sent before anybody waits is kept, and plays 
+   * ping-pong with another thread, so that both the spinning and the 
+   * sleeping paths of wait meet concurrent sets. */
+  void test_Event() {
+    const int rounds = 10000;
+
+    Event ping, pong;
+    ping.set();
+    ping.wait();
+
+    AtomicInt counter;
+    arx::thread* thread = new arx::thread(detail::TestEventEcho(&ping, &pong, &counter, rounds));
+    for(int i = 0; i < rounds; i++) {
+      ping.set();
+      pong.wait();
+      assert(counter.load() == i + 1);
+    }
+    delete thread;
+  }
+
+  /** Checks that TaskGroup::wait returns only once all the spawned tasks 
+   * are done, and right away if there are none. */
+  void test_TaskGroup() {
+    const int rounds = 100;
+    const int taskCount = 8;
+
+    detail::TestTaskRunner runner(taskCount);
+    {
+      TaskGroup group(&runner);
+      group.wait();
+    }
+
+    for(int i = 0; i < rounds; i++) {
+      AtomicInt counter;
+      TaskGroup group(&runner);
+      for(int j = 0; j < taskCount; j++)
+        group.spawn(new detail::TestCountingTask(&counter, &group));
+      group.wait();
+      assert(counter.load() == taskCount);
+    }
+  }
+
+  /** Checks that every tiler covers every pixel exactly once, for an image
+   * whose size is not a multiple of the tile size, and that CostTiler does 
+   * so with the history of the previous frame too. */
+  void test_RenderTiler_coverage() {
+    const int tileSize = 32;
+    arx::Image3f image(333, 217);
+
+    for(int renderersCount = 1; renderersCount <= 5; renderersCount += 2) {
+      LinearTiler linear(tileSize);
+      detail::checkTestTilerCoverage(linear, image, renderersCount);
+
+      MortonTiler morton(tileSize);
+      detail::checkTestTilerCoverage(morton, image, renderersCount);
+
+      HilbertTiler hilbert(tileSize);
+      detail::checkTestTilerCoverage(hilbert, image, renderersCount);
+
+      /* Make the top left corner expensive enough to be split, and give the
+       * rest of the image a spread of costs, so that tiles land in several
+       * cost buckets. */
+      TileCostMap costs;
+      CostTiler cost(&costs, tileSize);
+      int tileCount = detail::checkTestTilerCoverage(cost, image, renderersCount);
+
+      std::vector<float> tileTimes(tileCount);
+      for(int i = 0; i < tileCount; i++) {
+        ImageTile tile = cost.getTile(i);
+        if(tile.getX() < 2 * tileSize && tile.getY() < 2 * tileSize)
+          tileTimes[i] = 10.0f;
+        else
+          tileTimes[i] = 0.001f * (1 << (i % 10));
+      }
+      cost.taskFinished(&tileTimes[0]);
+
+      int splitTileCount = detail::checkTestTilerCoverage(cost, image, renderersCount);
+      assert(splitTileCount > tileCount);
+    }
+  }
+
+  void testSmart() {
+#ifdef SMART_USE_WATERTIGHT_INTERSECTION
+    test_testHitWatertight();
+#endif
+    test_Event();
+    test_TaskGroup();
+    test_RenderTiler_coverage();
+    test_BspNode_getSplitDimension();
+    test_intersects_BoundingBox_Triangle();
+    test_ShadedModel_refit();
+    test_CoreModel_cache();
+#ifdef SMART_USE_SSE
+    test_PacketTracer_matchesTracer();
+    test_BundleTracer_matchesTracer();
+#endif
+  }
+
+#ifdef SMART_USE_WATERTIGHT_INTERSECTION
+  /** Measures the cost of the watertight triangle test against Wald's
+   * projection test on the same random rays and triangles, and prints
+   * the time per test. */
+  void benchmark_testHitWatertight() {
+    const int triangleCount = 1024;
+    const int rayCount = 4096;
+
+    arx::FastArray<TriAccel> triAccels;
+    unsigned seed = 7;
+    while((int) triAccels.size() < triangleCount) {
+      Vector3f v[3];
+      for(int j = 0; j < 3; j++)
+        v[j] = Vector3f(detail::testRandom(seed), detail::testRandom(seed), detail::testRandom(seed));
+      if((v[1] - v[0]).cross(v[2] - v[0]).norm() > 1.0e-2f)
+        triAccels.push_back(TriAccel(detail::TestTriangle(v[0], v[1], v[2])));
+    }
+
+    arx::FastArray<Ray> rays;
+    for(int i = 0; i < rayCount; i++) {
+      Vector3f origin(detail::testRandom(seed) - 0.5f, detail::testRandom(seed) - 0.5f, -2.0f);
+      Vector3f target(detail::testRandom(seed), detail::testRandom(seed), detail::testRandom(seed));
+      rays.push_back(Ray(origin, (target - origin).normalized()));
+    }
+
+    Segment segment(0, FLT_MAX);
+    float t, beta, gamma;
+    int hits[2] = {0, 0};
+    double seconds[2];
+    for(int k = 0; k < 2; k++) {
+      Timer timer;
+      for(int i = 0; i < rayCount; i++) {
+        for(int j = 0; j < triangleCount; j++) {
+          if(k == 0)
+            hits[k] += detail::testHitWald(rays[i], segment, triAccels[j], t, beta, gamma, SMART_TRACETRIACCEL_EPS);
+          else
+            hits[k] += detail::testHitWatertight(rays[i], segment, triAccels[j], t, beta, gamma, SMART_TRACETRIACCEL_EPS);
+        }
+      }
+      seconds[k] = timer.getElapsed();
+    }
+
+    const double tests = (double) rayCount * triangleCount;
+    printf("Wald:       %.2f ns/test, %d hits\n", seconds[0] / tests * 1.0e9, hits[0]);
+    printf("Watertight: %.2f ns/test, %d hits\n", seconds[1] / tests * 1.0e9, hits[1]);
+  }
+#endif
+
+  void benchmarkSmart() {
+#ifdef SMART_USE_WATERTIGHT_INTERSECTION
+    benchmark_testHitWatertight();
+#endif
+  }
+
+} // namespace smart
+
+#endif // __SMART_TEST_H__
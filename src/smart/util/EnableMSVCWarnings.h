@@ -1,9 +1,9 @@
-#ifndef __SMART_ENABLEMSVCWARNINGS_H__
-#define __SMART_ENABLEMSVCWARNINGS_H__
-
-/* Clean up. */
-#ifdef ARX_MSVC
-#  pragma pop_macro("_SCL_SECURE_NO_DEPRECATE")
-#endif
-
-#endif // __SMART_ENABLEMSVCWARNINGS_H__
+#ifndef __SMART_ENABLEMSVCWARNINGS_H__
+#define __SMART_ENABLEMSVCWARNINGS_H__
+
+/* Clean up. */
+#ifdef ARX_MSVC
+#  pragma pop_macro("_SCL_SECURE_NO_DEPRECATE")
+#endif
+
+#endif // __SMART_ENABLEMSVCWARNINGS_H__